@@ -0,0 +1,239 @@
+#include "Autopilot.h"
+#include <algorithm>
+#include <cstdlib>
+
+static const int KEYS[4] = { 'w', 's', 'a', 'd' };     // UP, DOWN, LEFT, RIGHT
+static const int DX[4] = { 0, 0, -1, 1 };
+static const int DY[4] = { -1, 1, 0, 0 };
+static const Direction OPPOSITE[4] = { DOWN, UP, RIGHT, LEFT };
+
+// Ticks to wait before searching again when the apple could not be reached
+#define AUTOPILOT_RETRY_TICKS 8
+
+Autopilot::Autopilot() : rows(0), cols(0), bodyMark(0), searchMark(0), fillMark(0), pathTarget(-1), retryTick(0) {
+    resetStats();
+}
+
+void Autopilot::reset() {
+    path.clear();
+    pathTarget = -1;
+    retryTick = 0;
+}
+
+// Buffers are sized once per board; stamps restart only when they wrap
+void Autopilot::prepare(const SnakeCore& game) {
+    if (rows == game.map.getRows() && cols == game.map.getCols() && bodyMark != UINT32_MAX && searchMark != UINT32_MAX && fillMark != UINT32_MAX) {
+        return;
+    }
+    rows = game.map.getRows();
+    cols = game.map.getCols();
+    size_t cells = (size_t)rows * cols;
+    bodyStamp.assign(cells, 0);
+    freeAt.assign(cells, 0);
+    searchStamp.assign(cells, 0);
+    cost.assign(cells, 0);
+    parent.assign(cells, -1);
+    closedStamp.assign(cells, 0);
+    fillStamp.assign(cells, 0);
+    open.reserve(cells);
+    fillQueue.reserve(cells);
+    bodyMark = searchMark = fillMark = 0;
+    reset();
+}
+
+void Autopilot::markBody(const SnakeCore& game) {
+    bodyMark++;
+    const auto& snake = game.getSnake();
+    int length = (int)snake.size();
+    int k = 0;
+    for (const SnakePoint& pt : snake) {
+        int cell = pt.y * cols + pt.x;
+        // Segments can overlap while invincible; the one nearer the head leaves last
+        if (bodyStamp[cell] != bodyMark) {
+            bodyStamp[cell] = bodyMark;
+            freeAt[cell] = length - k + 1;
+        }
+        k++;
+    }
+}
+
+bool Autopilot::isPassable(const SnakeCore& game, int cell, int tick) const {
+    if (game.map.getMap()[cell] == 1) return false;
+    return bodyStamp[cell] != bodyMark || tick >= freeAt[cell];
+}
+
+// A* from the head to the apple, one step per tick; fills `path` (next step at the back)
+bool Autopilot::search(const SnakeCore& game, int start, int goal) {
+    searchCount++;
+    searchMark++;
+    path.clear();
+    open.clear();
+
+    auto heuristic = [&](int cell) { return std::abs(cell % cols - goal % cols) + std::abs(cell / cols - goal / cols); };
+    // Lower f first; on equal f the node nearer the goal, so open boards do not flood the bounding box
+    auto later = [](const OpenNode& a, const OpenNode& b) { return a.f > b.f || (a.f == b.f && a.h > b.h); };
+
+    searchStamp[start] = searchMark;
+    cost[start] = 0;
+    parent[start] = -1;
+    open.push_back({ heuristic(start), heuristic(start), start });
+
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), later);
+        int cell = open.back().cell;
+        open.pop_back();
+        if (closedStamp[cell] == searchMark) continue;
+        closedStamp[cell] = searchMark;
+        expandedCount++;
+
+        if (cell == goal) {
+            for (int c = goal; c != start; c = parent[c]) {
+                path.push_back(c);
+            }
+            return true;
+        }
+
+        int x = cell % cols;
+        int y = cell / cols;
+        int tick = cost[cell] + 1;
+        for (int d = 0; d < 4; ++d) {
+            if (cell == start && OPPOSITE[d] == game.getDirection()) continue; // changeDirection ignores it
+            int nx = x + DX[d];
+            int ny = y + DY[d];
+            if (nx < 0 || ny < 0 || nx >= cols || ny >= rows) continue;
+            int next = ny * cols + nx;
+            if (closedStamp[next] == searchMark || !isPassable(game, next, tick)) continue;
+            if (searchStamp[next] == searchMark && cost[next] <= tick) continue;
+            searchStamp[next] = searchMark;
+            cost[next] = tick;
+            parent[next] = cell;
+            int h = heuristic(next);
+            open.push_back({ tick + h, h, next });
+            std::push_heap(open.begin(), open.end(), later);
+        }
+    }
+    return false;
+}
+
+// Cells the snake can still reach after stepping on `start`, counting up to `limit`
+int Autopilot::reachableArea(const SnakeCore& game, int start, int limit) {
+    fillMark++;
+    fillQueue.clear();
+    fillQueue.push_back(std::make_pair(start, 1));
+    fillStamp[start] = fillMark;
+    for (size_t i = 0; i < fillQueue.size() && (int)fillQueue.size() < limit; ++i) {
+        int cell = fillQueue[i].first;
+        int tick = fillQueue[i].second + 1;
+        int x = cell % cols;
+        int y = cell / cols;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + DX[d];
+            int ny = y + DY[d];
+            if (nx < 0 || ny < 0 || nx >= cols || ny >= rows) continue;
+            int next = ny * cols + nx;
+            if (fillStamp[next] == fillMark || !isPassable(game, next, tick)) continue;
+            fillStamp[next] = fillMark;
+            fillQueue.push_back(std::make_pair(next, tick));
+        }
+    }
+    return (int)fillQueue.size();
+}
+
+// No usable path: the move with the most room, then the one nearest the apple
+int Autopilot::chooseStep(const SnakeCore& game) {
+    SnakePoint head = game.getSnake().front();
+    SnakePoint apple = game.getApple();
+    int length = (int)game.getSnake().size();
+    int best = -1, bestArea = 0, bestDistance = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (OPPOSITE[d] == game.getDirection()) continue;
+        int x = head.x + DX[d];
+        int y = head.y + DY[d];
+        if (x < 0 || y < 0 || x >= cols || y >= rows) continue;
+        int cell = y * cols + x;
+        if (!isPassable(game, cell, 1)) continue;
+        int area = reachableArea(game, cell, length);
+        int distance = apple.x < 0 ? 0 : std::abs(x - apple.x) + std::abs(y - apple.y);
+        if (best == -1 || area > bestArea || (area == bestArea && distance < bestDistance)) {
+            best = d;
+            bestArea = area;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+int Autopilot::plan(const SnakeCore& game) {
+    auto started = std::chrono::steady_clock::now();
+    prepare(game);
+    markBody(game);
+
+    SnakePoint head = game.getSnake().front();
+    SnakePoint apple = game.getApple();
+    int headCell = head.y * cols + head.x;
+    int appleCell = apple.x < 0 ? -1 : apple.y * cols + apple.x;
+    int length = (int)game.getSnake().size();
+
+    // Keep following the last path while it still leads to the apple from here
+    bool onPath = !path.empty() && pathTarget == appleCell && appleCell != -1;
+    if (onPath) {
+        int next = path.back();
+        int dx = next % cols - head.x;
+        int dy = next / cols - head.y;
+        onPath = std::abs(dx) + std::abs(dy) == 1 && isPassable(game, next, 1);
+    }
+    if (!onPath && appleCell != -1 && game.getTickCount() >= retryTick) {
+        onPath = search(game, headCell, appleCell);
+        pathTarget = onPath ? appleCell : -1;
+        if (!onPath) retryTick = game.getTickCount() + AUTOPILOT_RETRY_TICKS;
+    }
+
+    int step = -1;
+    if (onPath && reachableArea(game, path.back(), length) >= length) {
+        int next = path.back();
+        path.pop_back();
+        int dx = next % cols - head.x;
+        int dy = next / cols - head.y;
+        step = dx < 0 ? LEFT : dx > 0 ? RIGHT : dy < 0 ? UP : DOWN;
+    }
+    else {
+        path.clear(); // The path runs into a dead end; find it again once there is room
+        pathTarget = -1;
+        step = chooseStep(game);
+    }
+
+    lastUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+    totalUs += lastUs;
+    maxUs = std::max(maxUs, lastUs);
+    planCount++;
+
+    if (step == -1 || step == game.getDirection()) return -1;
+    return KEYS[step];
+}
+
+Autopilot::PlanStats Autopilot::getStats() const {
+    PlanStats stats;
+    stats.ticks = planCount;
+    stats.searches = searchCount;
+    stats.expanded = expandedCount;
+    stats.meanUs = planCount > 0 ? totalUs / planCount : 0.0;
+    stats.maxUs = maxUs;
+    stats.lastUs = lastUs;
+    return stats;
+}
+
+void Autopilot::resetStats() {
+    planCount = 0;
+    searchCount = 0;
+    expandedCount = 0;
+    totalUs = 0.0;
+    maxUs = 0.0;
+    lastUs = 0.0;
+}
+
+void Autopilot::printStats(std::ostream& out) const {
+    PlanStats stats = getStats();
+    out << "Autopilot: " << stats.ticks << " ticks planned"
+        << "  mean " << stats.meanUs << " us, max " << stats.maxUs << " us"
+        << "  searches " << stats.searches << " (" << (stats.searches > 0 ? stats.expanded / stats.searches : 0) << " cells each)" << std::endl;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "SnakeCore.h"
+
+// Plans the snake's moves and answers with a key for changeDirection.
+//
+// An A* search from the head to the apple over the map obstacles and the body
+// gives a path that is followed tick after tick; it is only searched again
+// when the apple moves, the snake leaves the path or the next step is no longer
+// safe. Body cells count as passable from the tick the tail will have left
+// them. Every step is checked with a flood fill (bounded by the snake length)
+// so the snake does not turn into a pocket too small for it.
+// All search buffers are allocated once per board size and reset with stamps,
+// never cleared, so a tick costs the snake length, not the board size.
+class Autopilot
+{
+public:
+    struct PlanStats {
+        int64_t ticks;
+        int64_t searches;       // A* runs (the rest followed the cached path)
+        int64_t expanded;       // cells taken off the A* open list, all searches
+        double meanUs;
+        double maxUs;
+        double lastUs;
+    };
+
+private:
+    int rows;
+    int cols;
+
+    // Per cell, valid when the matching stamp is current
+    std::vector<uint32_t> bodyStamp;
+    std::vector<int> freeAt;            // ticks until the body leaves the cell (+1: the tail moves after the collision check)
+    std::vector<uint32_t> searchStamp;
+    std::vector<int> cost;              // A* g: steps from the head
+    std::vector<int> parent;
+    std::vector<uint32_t> closedStamp;
+    std::vector<uint32_t> fillStamp;
+    struct OpenNode { int f, h, cell; };
+    std::vector<OpenNode> open;                 // A* open list, a binary heap
+    std::vector<std::pair<int, int>> fillQueue; // (cell, ticks from now)
+    uint32_t bodyMark, searchMark, fillMark;
+
+    std::vector<int> path;          // cells from the next step to the apple, back to front
+    int pathTarget;                 // apple cell the path leads to
+    int64_t retryTick;              // no path to the apple: when to search again
+
+    int64_t planCount;
+    int64_t searchCount;
+    int64_t expandedCount;
+    double totalUs;
+    double maxUs;
+    double lastUs;
+
+    void prepare(const SnakeCore& game);
+    void markBody(const SnakeCore& game);
+    bool isPassable(const SnakeCore& game, int cell, int tick) const;
+    bool search(const SnakeCore& game, int start, int goal);
+    int reachableArea(const SnakeCore& game, int start, int limit);
+    int chooseStep(const SnakeCore& game);
+
+public:
+    Autopilot();
+
+    // Key to press before the next update ('w', 'a', 's', 'd'), or -1 to keep going
+    int plan(const SnakeCore& game);
+    void reset();   // forget the cached path (new game)
+
+    PlanStats getStats() const;
+    void resetStats();
+    void printStats(std::ostream& out) const;
+};
@@ -0,0 +1,454 @@
+// Microbenchmarks for the engine's hot paths (Snake_Bench project).
+//
+//   snake_bench [--sizes 30x20,100x100] [--lengths 1,32] [--densities 0,0.1]
+//               [--filter name] [--min-time seconds] [--json]
+//
+// Every benchmark runs for each board size x obstacle density (and snake length
+// where the length matters) and prints one line per case: CSV with a header by
+// default, JSON lines with --json. Times are per operation, from a batch that
+// ran for at least --min-time seconds.
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Glob.h"
+#include "Map.h"
+#include "MapDraw.h"
+#include "MapEditor.h"
+#include "MapRegions.h"
+#include "MultiSnakeCore.h"
+#include "Snake.h"
+#include "SnakeCore.h"
+#include "SnakeRenderer.h"
+#include "StateStream.h"
+#include "Tournament.h"
+
+#define BENCH_MAP_TEXT "bench_map.txt"
+#define BENCH_MAP_BINARY "bench_map.smap"
+#define MAX_PLANNED_TICKS 4096
+
+typedef std::chrono::steady_clock BenchClock;
+
+struct BenchCase {
+    int cols;
+    int rows;
+    int length;
+    double density;
+};
+
+struct BenchOptions {
+    std::vector<std::pair<int, int>> sizes = { { 30, 20 }, { 100, 100 }, { 1000, 1000 } };
+    std::vector<int> lengths = { 1, 32, 512 };
+    std::vector<double> densities = { 0.0, 0.1, 0.3 };
+    std::string filter;
+    double minSeconds = 0.1;
+    bool json = false;
+};
+
+// Exposes the protected pieces of SnakeCore that are benchmarked on their own
+class BenchCore : public SnakeCore {
+public:
+    BenchCore(const Map& map, uint64_t seed) : SnakeCore(map, seed) {}
+    bool collides(SnakePoint pt) { return isCollision(pt); }
+    void newApple() { placeApple(); }
+};
+
+// Swallows Map::save's console message, which would end up in the results
+struct NullBuffer : std::streambuf {
+    int overflow(int c) override { return c; }
+};
+static NullBuffer nullBuffer;
+
+static double seconds(BenchClock::time_point since) {
+    return std::chrono::duration<double>(BenchClock::now() - since).count();
+}
+
+// run(n) does n operations and returns the seconds they took (setup excluded).
+// n doubles until one batch takes minSeconds; returns ns per operation.
+template <typename Run>
+static double measure(const BenchOptions& options, Run run, int64_t& iterations) {
+    for (iterations = 1; ; iterations *= 2) {
+        double taken = run(iterations);
+        if (taken >= options.minSeconds || iterations >= ((int64_t)1 << 32)) {
+            return taken * 1e9 / (double)iterations;
+        }
+    }
+}
+
+static void report(const BenchOptions& options, const std::string& name, const BenchCase& c, int64_t iterations, double nsPerOp) {
+    if (options.json) {
+        std::printf("{\"benchmark\":\"%s\",\"cols\":%d,\"rows\":%d,\"length\":%d,\"density\":%.3f,\"iterations\":%lld,\"ns_per_op\":%.2f}\n",
+            name.c_str(), c.cols, c.rows, c.length, c.density, (long long)iterations, nsPerOp);
+    }
+    else {
+        std::printf("%s,%d,%d,%d,%.3f,%lld,%.2f\n", name.c_str(), c.cols, c.rows, c.length, c.density, (long long)iterations, nsPerOp);
+    }
+    std::fflush(stdout);
+}
+
+static bool selected(const BenchOptions& options, const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Snake laid out boustrophedon from the top-left corner, tail first
+static std::vector<SnakePoint> snakePath(const BenchCase& c) {
+    std::vector<SnakePoint> path;
+    for (int i = 0; i < c.length; ++i) {
+        int row = i / c.cols;
+        int col = row % 2 == 0 ? i % c.cols : c.cols - 1 - i % c.cols;
+        path.push_back(SnakePoint(col, row));
+    }
+    return path;
+}
+
+// Random obstacles at the case's density, with the rows of the snake (and one below) kept clear
+static Map makeMap(const BenchCase& c) {
+    Map map(c.rows, c.cols, BENCH_MAP_TEXT);
+    GameRng rng((uint64_t)c.cols * 7919 + c.rows * 104729 + (uint64_t)(c.density * 1000));
+    int clearRows = (c.length + c.cols - 1) / c.cols + 1;
+    uint32_t threshold = (uint32_t)(c.density * 1000000);
+    for (int y = clearRows; y < c.rows; ++y) {
+        for (int x = 0; x < c.cols; ++x) {
+            if (rng.nextBelow(1000000) < threshold) map.setObstacle(x, y);
+        }
+    }
+    return map;
+}
+
+// Puts the laid out snake into the game, heading away from its neck
+static void layOutSnake(BenchCore& game, const std::vector<SnakePoint>& path) {
+    SnakeSnapshot state;
+    game.snapshot(state);
+    state.body.assign(path.rbegin(), path.rend());
+    state.numHearts = MAX_HARTS;
+    state.gameScore = path.size() - 1;
+    state.dir = RIGHT;
+    if (path.size() > 1) {
+        SnakePoint head = path[path.size() - 1], neck = path[path.size() - 2];
+        state.dir = head.x > neck.x ? RIGHT : head.x < neck.x ? LEFT : DOWN;
+    }
+    game.restore(state);
+    game.newApple(); // The old apple may be under the body now
+}
+
+// Keys the greedy bot presses from the current state until the snake would lose a heart
+static std::vector<int> planKeys(BenchCore& game) {
+    SnakeSnapshot start;
+    game.snapshot(start);
+    std::vector<int> keys;
+    while ((int)keys.size() < MAX_PLANNED_TICKS) {
+        int key = Tournament::greedyBot(game);
+        if (key != -1) game.changeDirection(key);
+        game.update();
+        if (game.isGameOver() || game.getHearts() < MAX_HARTS) break;
+        keys.push_back(key);
+    }
+    game.restore(start);
+    return keys;
+}
+
+// Plays the planned ticks over and over from the snapshot; onTick(game) is timed, the rest is not
+template <typename Game, typename OnTick>
+static double replayTicks(Game& game, const SnakeSnapshot& start, const std::vector<int>& keys, int64_t n, OnTick onTick) {
+    double taken = 0;
+    for (int64_t done = 0; done < n; ) {
+        game.restore(start);
+        int64_t chunk = std::min<int64_t>((int64_t)keys.size(), n - done);
+        auto started = BenchClock::now();
+        for (int64_t i = 0; i < chunk; ++i) {
+            onTick(game, keys[(size_t)i]);
+        }
+        taken += seconds(started);
+        done += chunk;
+    }
+    return taken;
+}
+
+static void benchGame(const BenchOptions& options, const BenchCase& c, const Map& map) {
+    BenchCore game(map, 1);
+    game.newGame(1);
+    layOutSnake(game, snakePath(c));
+    SnakeSnapshot start;
+    game.snapshot(start);
+    std::vector<int> keys = planKeys(game);
+    int64_t iterations;
+
+    if (!keys.empty() && selected(options, "core_update")) {
+        double ns = measure(options, [&](int64_t n) {
+            return replayTicks(game, start, keys, n, [](BenchCore& g, int key) {
+                if (key != -1) g.changeDirection(key);
+                g.update();
+            });
+        }, iterations);
+        report(options, "core_update", c, iterations, ns);
+    }
+
+    if (!keys.empty() && selected(options, "stream_update")) {
+        // core_update with the state stream encoder attached, as SnakeGame runs it; the stream
+        // starts over once it holds a megabyte (every restore of the snapshot is a keyframe)
+        StateStreamEncoder stream;
+        double ns = measure(options, [&](int64_t n) {
+            return replayTicks(game, start, keys, n, [&](BenchCore& g, int key) {
+                if (key != -1) g.changeDirection(key);
+                g.update();
+                if (stream.getBytes().size() > (1 << 20)) stream.begin(g);
+                stream.encode(g);
+            });
+        }, iterations);
+        report(options, "stream_update", c, iterations, ns);
+    }
+
+    if (!keys.empty() && selected(options, "game_update")) {
+        // SnakeGame loads its map from the globals; it runs on the default per-update clock like the core
+        mapWidth = c.cols;
+        mapHeight = c.rows;
+        mapFileName = BENCH_MAP_TEXT;
+        SnakeGame snakeGame;
+        snakeGame.setTickSource(nullptr, 0);
+        int ticksPerSecond = 10;
+        double ns = measure(options, [&](int64_t n) {
+            return replayTicks(snakeGame, start, keys, n, [&](SnakeGame& g, int key) {
+                if (key != -1) g.changeDirection(key);
+                g.update(ticksPerSecond);
+            });
+        }, iterations);
+        report(options, "game_update", c, iterations, ns);
+    }
+
+    if (selected(options, "multi_update")) {
+        // A full board of bots, as in --multi with no players; the bots' moves are part of the tick
+        MultiSnakeCore multi(map, MAX_SNAKES, 1);
+        double ns = measure(options, [&](int64_t n) {
+            double taken = 0;
+            for (int64_t done = 0; done < n; ) {
+                if (multi.isGameOver()) multi.newGame(1);
+                auto started = BenchClock::now();
+                for (; done < n && !multi.isGameOver(); ++done) {
+                    for (int i = 0; i < MAX_SNAKES; ++i) {
+                        int key = greedyMultiBot(multi, i);
+                        if (key != -1) multi.changeDirection(i, key);
+                    }
+                    multi.update();
+                }
+                taken += seconds(started);
+            }
+            return taken;
+        }, iterations);
+        report(options, "multi_update", c, iterations, ns);
+    }
+
+    if (selected(options, "is_collision")) {
+        std::vector<SnakePoint> points;
+        GameRng rng(7);
+        for (int i = 0; i < 4096; ++i) {
+            points.push_back(SnakePoint((int)rng.nextBelow(c.cols + 2) - 1, (int)rng.nextBelow(c.rows + 2) - 1));
+        }
+        volatile int hits = 0;
+        double ns = measure(options, [&](int64_t n) {
+            auto started = BenchClock::now();
+            int count = 0;
+            for (int64_t i = 0; i < n; ++i) {
+                count += game.collides(points[(size_t)i & 4095]);
+            }
+            hits = count;
+            return seconds(started);
+        }, iterations);
+        report(options, "is_collision", c, iterations, ns);
+    }
+
+    if (selected(options, "place_apple")) {
+        double ns = measure(options, [&](int64_t n) {
+            game.restore(start);
+            auto started = BenchClock::now();
+            for (int64_t i = 0; i < n; ++i) {
+                game.newApple();
+            }
+            return seconds(started);
+        }, iterations);
+        report(options, "place_apple", c, iterations, ns);
+    }
+
+    int viewCols = std::min(c.cols, MAX_VIEW_COLS);
+    int viewRows = std::min(c.rows, MAX_VIEW_ROWS);
+    cv::Mat frame(viewRows * CELL_SIZE, viewCols * CELL_SIZE, CV_8UC3, cv::Scalar(0, 0, 0));
+
+    if (!keys.empty() && selected(options, "render")) {
+        // Steady state: one incremental frame per tick, the update itself not timed
+        SnakeRenderer renderer(CELL_SIZE);
+        double ns = measure(options, [&](int64_t n) {
+            double taken = 0;
+            replayTicks(game, start, keys, n, [&](BenchCore& g, int key) {
+                if (key != -1) g.changeDirection(key);
+                g.update();
+                auto started = BenchClock::now();
+                renderer.render(g, frame);
+                taken += seconds(started);
+            });
+            return taken;
+        }, iterations);
+        report(options, "render", c, iterations, ns);
+
+        ns = measure(options, [&](int64_t n) {
+            auto started = BenchClock::now();
+            for (int64_t i = 0; i < n; ++i) {
+                renderer.invalidate();
+                renderer.render(game, frame);
+            }
+            return seconds(started);
+        }, iterations);
+        report(options, "render_full", c, iterations, ns);
+    }
+}
+
+static void benchMap(const BenchOptions& options, const BenchCase& c, Map& map) {
+    int64_t iterations;
+    int viewCols = std::min(c.cols, MAX_VIEW_COLS);
+    int viewRows = std::min(c.rows, MAX_VIEW_ROWS);
+
+    if (selected(options, "draw_map")) {
+        cv::Mat frame(viewRows * CELL_SIZE, viewCols * CELL_SIZE, CV_8UC3, cv::Scalar(0, 0, 0));
+        double ns = measure(options, [&](int64_t n) {
+            auto started = BenchClock::now();
+            for (int64_t i = 0; i < n; ++i) {
+                drawMap(map, frame, cv::Scalar(0, 0, 255), CELL_SIZE, cv::Rect(0, 0, viewCols, viewRows));
+            }
+            return seconds(started);
+        }, iterations);
+        report(options, "draw_map", c, iterations, ns);
+    }
+
+    if (selected(options, "editor_stroke")) {
+        // A short brush stroke per iteration, drawn and erased in turn, then the frame it changes
+        cv::Mat canvas(std::min(c.rows, MAX_VIEW_ROWS) * CELL_SIZE + MAP_EDITOR_STATUS_HEIGHT, std::min(c.cols, MAX_VIEW_COLS) * CELL_SIZE, CV_8UC3);
+        Map editedMap = map;
+        MapEditor editor(editedMap, CELL_SIZE);
+        editor.render(canvas);
+        int span = std::min(canvas.cols, canvas.rows - MAP_EDITOR_STATUS_HEIGHT) / 2;
+        double ns = measure(options, [&](int64_t n) {
+            auto started = BenchClock::now();
+            for (int64_t i = 0; i < n; ++i) {
+                int down = (i & 1) ? cv::EVENT_RBUTTONDOWN : cv::EVENT_LBUTTONDOWN;
+                int up = (i & 1) ? cv::EVENT_RBUTTONUP : cv::EVENT_LBUTTONUP;
+                editor.handleMouse(down, 0, 0);
+                editor.handleMouse(cv::EVENT_MOUSEMOVE, span, span);
+                editor.handleMouse(up, span, span);
+                editor.render(canvas);
+            }
+            return seconds(started);
+        }, iterations);
+        report(options, "editor_stroke", c, iterations, ns);
+    }
+
+    if (selected(options, "map_regions")) {
+        MapRegions regions;
+        double ns = measure(options, [&](int64_t n) {
+            auto started = BenchClock::now();
+            for (int64_t i = 0; i < n; ++i) regions.analyze(map);
+            return seconds(started);
+        }, iterations);
+        report(options, "map_regions", c, iterations, ns);
+    }
+
+    const char* files[] = { BENCH_MAP_TEXT, BENCH_MAP_BINARY };
+    const char* names[] = { "text", "binary" };
+    for (int f = 0; f < 2; ++f) {
+        Map copy = map;
+        copy.setMapFile(files[f]);
+        std::string saveName = std::string("map_save_") + names[f];
+        std::string loadName = std::string("map_load_") + names[f];
+
+        std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+        std::streambuf* errors = std::cerr.rdbuf(&nullBuffer); // pocket warnings
+        double saveNs = 0;
+        int64_t saveIterations = 0;
+        if (selected(options, saveName)) {
+            saveNs = measure(options, [&](int64_t n) {
+                auto started = BenchClock::now();
+                for (int64_t i = 0; i < n; ++i) copy.save();
+                return seconds(started);
+            }, saveIterations);
+        }
+        else {
+            copy.save(); // The load benchmark needs the file
+        }
+        std::cout.rdbuf(console);
+        std::cerr.rdbuf(errors);
+        if (saveIterations > 0) report(options, saveName, c, saveIterations, saveNs);
+
+        if (selected(options, loadName)) {
+            double ns = measure(options, [&](int64_t n) {
+                auto started = BenchClock::now();
+                for (int64_t i = 0; i < n; ++i) copy.load();
+                return seconds(started);
+            }, iterations);
+            report(options, loadName, c, iterations, ns);
+        }
+    }
+}
+
+template <typename T, typename Parse>
+static std::vector<T> parseList(const std::string& text, Parse parse) {
+    std::vector<T> values;
+    std::stringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (!item.empty()) values.push_back(parse(item));
+    }
+    return values;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--json") {
+            options.json = true;
+            continue;
+        }
+        if (i + 1 >= argc) break;
+        std::string value = argv[++i];
+        if (option == "--sizes") {
+            options.sizes = parseList<std::pair<int, int>>(value, [](const std::string& s) {
+                std::pair<int, int> size(0, 0);
+                sscanf(s.c_str(), "%dx%d", &size.first, &size.second);
+                return size;
+            });
+        }
+        else if (option == "--lengths") options.lengths = parseList<int>(value, [](const std::string& s) { return atoi(s.c_str()); });
+        else if (option == "--densities") options.densities = parseList<double>(value, [](const std::string& s) { return atof(s.c_str()); });
+        else if (option == "--filter") options.filter = value;
+        else if (option == "--min-time") options.minSeconds = atof(value.c_str());
+    }
+
+    if (!options.json) {
+        std::printf("benchmark,cols,rows,length,density,iterations,ns_per_op\n");
+    }
+    for (const auto& size : options.sizes) {
+        for (double density : options.densities) {
+            BenchCase c = { size.first, size.second, 0, density };
+            if (c.cols < 2 || c.rows < 2) continue;
+            Map map = makeMap(c);
+            windowWidth = std::min(c.cols, MAX_VIEW_COLS) * CELL_SIZE;
+            windowHeight = std::min(c.rows, MAX_VIEW_ROWS) * CELL_SIZE;
+            benchMap(options, c, map);
+
+            for (int length : options.lengths) {
+                c.length = std::max(1, std::min(length, c.rows * c.cols / 2));
+                Map gameMap = makeMap(c);    // SnakeGame loads it from the file
+                std::streambuf* console = std::cout.rdbuf(&nullBuffer);
+                std::streambuf* errors = std::cerr.rdbuf(&nullBuffer); // pocket warnings
+                gameMap.save();
+                std::cout.rdbuf(console);
+                std::cerr.rdbuf(errors);
+                benchGame(options, c, gameMap);
+            }
+        }
+    }
+    std::remove(BENCH_MAP_TEXT);
+    std::remove(BENCH_MAP_BINARY);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "BinaryMap.h"
+#include "Map.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : data(nullptr), size(0)
+#ifdef _WIN32
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#else
+    , fd(-1)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const unsigned char*>(view);
+    size = (size_t)fileSize.QuadPart;
+#else
+    int handle = ::open(path.c_str(), O_RDONLY);
+    if (handle < 0) return false;
+    struct stat info;
+    if (fstat(handle, &info) != 0 || info.st_size == 0) {
+        ::close(handle);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    if (view == MAP_FAILED) {
+        ::close(handle);
+        return false;
+    }
+    fd = handle;
+    data = static_cast<const unsigned char*>(view);
+    size = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (data == nullptr) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(data), size);
+    ::close(fd);
+    fd = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool BinaryMapView::open(const std::string& path) {
+    header = nullptr;
+    bits = nullptr;
+    if (!file.open(path)) return false;
+    if (file.getSize() < sizeof(BinaryMapHeader)) return false;
+
+    const BinaryMapHeader* h = reinterpret_cast<const BinaryMapHeader*>(file.getData());
+    if (std::memcmp(h->magic, SMAP_MAGIC, 4) != 0 || h->version != SMAP_VERSION || h->headerSize < sizeof(BinaryMapHeader)) {
+        std::cerr << "Not a valid map file: " << path << std::endl;
+        return false;
+    }
+    if (h->rows > MAX_BOARD_SIDE || h->cols > MAX_BOARD_SIDE || !isValidBoardSize((int)h->rows, (int)h->cols)) {
+        std::cerr << "Map size must be 1 to " << MAX_BOARD_SIDE << " cells on a side: " << path << std::endl;
+        return false;
+    }
+    if (h->bytesPerRow < (h->cols + 7) / 8 || file.getSize() < h->headerSize + (size_t)h->rows * h->bytesPerRow) {
+        std::cerr << "Truncated map file: " << path << std::endl;
+        return false;
+    }
+    header = h;
+    bits = file.getData() + h->headerSize;
+    return true;
+}
+
+// Eight cells per input byte: each byte of bits expands to one little-endian uint64 of 0/1 bytes
+static const uint64_t* unpackTable() {
+    static uint64_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (int b = 0; b < 256; ++b) {
+            uint64_t cells = 0;
+            for (int bit = 0; bit < 8; ++bit) {
+                if (b & (1 << bit)) cells |= (uint64_t)1 << (bit * 8);
+            }
+            table[b] = cells;
+        }
+        ready = true;
+    }
+    return table;
+}
+
+void BinaryMapView::unpackRow(int y, unsigned char* out) const {
+    static const uint64_t* table = unpackTable();
+    const unsigned char* row = bits + (size_t)y * header->bytesPerRow;
+    int cols = getCols();
+    int fullBytes = cols / 8;
+    for (int i = 0; i < fullBytes; ++i) {
+        std::memcpy(out + i * 8, &table[row[i]], 8);
+    }
+    for (int x = fullBytes * 8; x < cols; ++x) {
+        out[x] = (row[x >> 3] >> (x & 7)) & 1;
+    }
+}
+
+bool isBinaryMapFile(const std::string& path) {
+    const std::string extension = SMAP_EXTENSION;
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool saveBinaryMap(const Map& map, const std::string& path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to save the map!" << std::endl;
+        return false;
+    }
+
+    BinaryMapHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SMAP_MAGIC, 4);
+    header.version = SMAP_VERSION;
+    header.headerSize = sizeof(BinaryMapHeader);
+    header.rows = (uint32_t)map.getRows();
+    header.cols = (uint32_t)map.getCols();
+    header.bytesPerRow = (uint32_t)((map.getCols() + 7) / 8);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const std::vector<unsigned char>& cells = map.getMap();
+    std::vector<unsigned char> row(header.bytesPerRow);
+    for (int y = 0; y < map.getRows(); ++y) {
+        std::fill(row.begin(), row.end(), 0);
+        const unsigned char* src = &cells[(size_t)y * map.getCols()];
+        for (int x = 0; x < map.getCols(); ++x) {
+            if (src[x] == 1) row[x >> 3] |= (unsigned char)(1 << (x & 7));
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return (bool)file;
+}
+
+// map.txt has no header: one line per row, one number per cell
+static bool readTextMapSize(const std::string& path, int& rows, int& cols) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    rows = 0;
+    cols = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        int count = 0, value;
+        while (tokens >> value) count++;
+        if (count == 0) continue;
+        if (cols == 0) cols = count;
+        rows++;
+    }
+    return isValidBoardSize(rows, cols);
+}
+
+bool convertTextMapToBinary(const std::string& textPath, const std::string& binaryPath) {
+    int rows, cols;
+    if (!readTextMapSize(textPath, rows, cols)) {
+        std::cerr << "Cannot read map " << textPath << std::endl;
+        return false;
+    }
+    Map map(rows, cols, textPath);
+    if (!map.load()) return false;
+    map.setMapFile(binaryPath);
+    return map.save();
+}
+
+bool convertBinaryMapToText(const std::string& binaryPath, const std::string& textPath) {
+    Map map(0, 0, binaryPath);
+    if (!map.load()) return false;
+    map.setMapFile(textPath);
+    return map.save();
+}
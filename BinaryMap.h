@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Map;
+
+// Binary map format (.smap), little-endian:
+//   32-byte header: "SNKM", version, header size, rows, cols, bytes per row, flags, reserved
+//   rows * bytesPerRow bytes of obstacle bits, row-major, bit (x % 8) of byte x / 8 is cell x
+// The obstacle bits are usable straight from a memory mapping, with no parse step.
+#define SMAP_MAGIC "SNKM"
+#define SMAP_VERSION 1
+#define SMAP_EXTENSION ".smap"
+
+#pragma pack(push, 1)
+struct BinaryMapHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t bytesPerRow;
+    uint32_t flags;
+    uint64_t reserved;
+};
+#pragma pack(pop)
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    const unsigned char* getData() const { return data; }
+    size_t getSize() const { return size; }
+};
+
+// Obstacle grid read directly from a mapped .smap file
+class BinaryMapView {
+private:
+    MappedFile file;
+    const BinaryMapHeader* header;
+    const unsigned char* bits;
+
+public:
+    BinaryMapView() : header(nullptr), bits(nullptr) {}
+
+    // Maps the file and checks the header; false if it is not a valid .smap
+    bool open(const std::string& path);
+
+    int getRows() const { return header ? (int)header->rows : 0; }
+    int getCols() const { return header ? (int)header->cols : 0; }
+
+    bool isObstacle(int x, int y) const {
+        if (x < 0 || y < 0 || x >= getCols() || y >= getRows()) return false;
+        return (bits[(size_t)y * header->bytesPerRow + (x >> 3)] >> (x & 7)) & 1;
+    }
+
+    // Expand one row of bits into one byte per cell (0 / 1)
+    void unpackRow(int y, unsigned char* out) const;
+};
+
+bool isBinaryMapFile(const std::string& path);
+bool saveBinaryMap(const Map& map, const std::string& path);
+
+// Converters between map.txt (whitespace-separated 0/1 per cell, one line per row) and .smap
+bool convertTextMapToBinary(const std::string& textPath, const std::string& binaryPath);
+bool convertBinaryMapToText(const std::string& binaryPath, const std::string& textPath);
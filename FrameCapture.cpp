@@ -0,0 +1,253 @@
+#include "FrameCapture.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <vector>
+#include "FramePool.h"
+#include "GameLoop.h"
+#include "Replay.h"
+#include "Snake.h"
+
+static std::string lowerExtension(const std::string& fileName) {
+    size_t dot = fileName.find_last_of('.');
+    if (dot == std::string::npos) return "";
+    std::string extension = fileName.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return extension;
+}
+
+CaptureFormat captureFormatFor(const std::string& target) {
+    std::string extension = lowerExtension(target);
+    if (extension == ".y4m") return CAPTURE_Y4M;
+    if (extension == ".bgr" || extension == ".raw") return CAPTURE_RAW;
+    if (extension == ".png") return CAPTURE_PNG;
+    return CAPTURE_VIDEO;
+}
+
+std::string captureFileName(const std::string& extension) {
+    time_t now = time(0);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+    return CAPTURE_FILE_PREFIX + stamp + extension;
+}
+
+FrameCapture::FrameCapture() : format(CAPTURE_Y4M), fps(0), lastSlot(-1), stopping(false), active(false), submitted(0), written(0), dropped(0), failed(0) {}
+
+FrameCapture::~FrameCapture() {
+    close();
+}
+
+bool FrameCapture::openWriter() {
+    if (format == CAPTURE_VIDEO) {
+        std::string extension = lowerExtension(target);
+        int fourcc = extension == ".mp4" ? cv::VideoWriter::fourcc('m', 'p', '4', 'v') : cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        if (video.open(target, fourcc, fps, size, true)) return true;
+        // No codec for this container in this OpenCV build: keep the frames as Y4M
+        std::cerr << "No video codec for " << target << ", writing YUV4MPEG2 instead" << std::endl;
+        size_t dot = target.find_last_of('.');
+        target = (dot == std::string::npos ? target : target.substr(0, dot)) + ".y4m";
+        format = CAPTURE_Y4M;
+    }
+
+    if (format == CAPTURE_PNG) {
+        pngPrefix = target.substr(0, target.size() - 4) + "_";
+        return true;
+    }
+
+    file.open(target, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    if (format == CAPTURE_Y4M) {
+        // 4:2:0 needs even sizes; an odd last row or column is left out
+        size.width &= ~1;
+        size.height &= ~1;
+        int rate = std::max(1, (int)(fps * 1000 + 0.5));
+        file << "YUV4MPEG2 W" << size.width << " H" << size.height << " F" << rate << ":1000 Ip A1:1 C420jpeg\n";
+    }
+    else {
+        std::cout << "Raw capture " << target << ": " << size.width << "x" << size.height << " bgr24 at " << fps << " fps" << std::endl;
+    }
+    return file.good();
+}
+
+bool FrameCapture::open(const std::string& target, cv::Size size, double fps) {
+    close();
+    this->target = target;
+    this->format = captureFormatFor(target);
+    this->size = size;
+    this->fps = fps;
+    if (!openWriter()) {
+        std::cerr << "Could not open " << target << " for capture" << std::endl;
+        return false;
+    }
+
+    submitted = 0;
+    written = 0;
+    dropped = 0;
+    failed = 0;
+    lastSlot = -1;
+    stopping = false;
+    active = true;
+    encoder = std::thread(&FrameCapture::encode, this);
+    return true;
+}
+
+void FrameCapture::close() {
+    if (!active) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    encoder.join();
+    active = false;
+
+    file.close();
+    video.release();
+}
+
+bool FrameCapture::submit(const cv::Mat& frame, bool wait) {
+    return queueFrame(frame, 1, wait);
+}
+
+bool FrameCapture::submitAt(const cv::Mat& frame, int64_t timeNs) {
+    int64_t slot = (int64_t)((double)timeNs * fps / FixedStepClock::TIME_FREQUENCY);
+    int64_t repeats = lastSlot < 0 ? 1 : slot - lastSlot;
+    if (repeats <= 0) return true; // another frame already stands for this slot
+    if (!queueFrame(frame, repeats, false)) return false;
+    lastSlot = slot;
+    return true;
+}
+
+bool FrameCapture::queueFrame(const cv::Mat& frame, int64_t repeats, bool wait) {
+    submitted++;
+    QueuedFrame queued = { frame, repeats };
+    while (!queue.push(queued)) {
+        if (!wait) {
+            dropped++;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    { std::lock_guard<std::mutex> lock(wakeMutex); }   // the encoder is either waiting or will see the frame
+    wake.notify_all();
+    return true;
+}
+
+bool FrameCapture::writeFrame(const cv::Mat& frame) {
+    switch (format) {
+    case CAPTURE_VIDEO:
+        video.write(frame);
+        return true;
+
+    case CAPTURE_PNG: {
+        char number[16];
+        snprintf(number, sizeof(number), "%06lld", (long long)written.load());
+        return cv::imwrite(pngPrefix + number + ".png", frame);
+    }
+
+    case CAPTURE_Y4M: {
+        cv::Mat even = frame(cv::Rect(0, 0, size.width, size.height));
+        yuv.create(size.height * 3 / 2, size.width, CV_8UC1);
+        cv::cvtColor(even, yuv, cv::COLOR_BGR2YUV_I420);
+        file << "FRAME\n";
+        file.write((const char*)yuv.data, (std::streamsize)yuv.total());
+        return file.good();
+    }
+
+    case CAPTURE_RAW:
+        for (int row = 0; row < frame.rows; ++row) {
+            file.write((const char*)frame.ptr(row), (std::streamsize)frame.cols * 3);
+        }
+        return file.good();
+    }
+    return false;
+}
+
+void FrameCapture::encode() {
+    QueuedFrame queued;
+    while (true) {
+        bool finishing;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+            finishing = stopping;
+        }
+        while (queue.pop(queued)) {
+            for (int64_t i = 0; i < queued.repeats; ++i) {
+                if (writeFrame(queued.frame)) written++;
+                else failed++;
+            }
+            queued.frame.release(); // back to the pool
+        }
+        if (finishing) break;
+    }
+}
+
+FrameCapture::CaptureStats FrameCapture::getStats() const {
+    CaptureStats stats;
+    stats.submitted = submitted.load();
+    stats.written = written.load();
+    stats.dropped = dropped.load();
+    stats.failed = failed.load();
+    return stats;
+}
+
+void FrameCapture::printStats(std::ostream& out) const {
+    CaptureStats stats = getStats();
+    out << "Capture " << target << ": " << stats.written << " frames written, "
+        << stats.dropped << " dropped (encoder behind)";
+    if (stats.failed > 0) out << ", " << stats.failed << " failed";
+    out << std::endl;
+}
+
+bool renderReplayToFile(const std::string& replayFile, const std::string& target, std::ostream& out) {
+    ReplayRecording recording;
+    if (!recording.load(replayFile)) {
+        out << replayFile << ": not a recording" << std::endl;
+        return false;
+    }
+    Map map(recording.getRows(), recording.getCols(), recording.getMapFile());
+    map.load();
+
+    // Same view and HUD layout as the game window
+    cv::Size size(std::min(map.getCols(), MAX_VIEW_COLS) * CELL_SIZE, std::min(map.getRows(), MAX_VIEW_ROWS) * CELL_SIZE);
+    windowWidth = size.width;
+    windowHeight = size.height;
+
+    // One frame per tick, at the tick rate the game started with
+    double fps = 10.0;
+    for (const ReplayEvent& event : recording.getEvents()) {
+        if (event.type == REPLAY_STEP && event.value > 0) {
+            fps = (double)FixedStepClock::TIME_FREQUENCY / event.value;
+            break;
+        }
+    }
+
+    FrameCapture capture;
+    if (!capture.open(target, size, fps)) return false;
+
+    // Enough frames for a full encoder queue, the one being encoded and the one being drawn
+    FramePool pool;
+    pool.reset(CAPTURE_QUEUE_FRAMES + 2, size);
+    SnakeRenderer renderer(CELL_SIZE);
+    cv::Mat frame;
+
+    auto start = std::chrono::steady_clock::now();
+    ReplayResult result = replayGame(recording, map, [&](SnakeCore& game) {
+        while (!pool.acquire(frame)) std::this_thread::yield();
+        SnakeGame::renderState(renderer, game, frame, -1);
+        capture.submit(frame, true);
+    });
+    frame.release();
+    capture.close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    capture.printStats(out);
+    out << result.ticks << " ticks in " << std::fixed << std::setprecision(2) << seconds << " s ("
+        << std::setprecision(1) << (seconds > 0 ? result.ticks / seconds / fps : 0.0) << "x real time)";
+    if (!result.passed()) out << ", replay diverged at tick " << result.firstMismatch;
+    out << std::endl;
+    return result.passed();
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "SpscQueue.h"
+
+#define CAPTURE_QUEUE_FRAMES 8      // frames waiting for the encoder before new ones are dropped
+const std::string CAPTURE_FILE_PREFIX = "capture_";
+
+// How the target name is written: by extension (.y4m, .bgr/.raw, .png, or a video container)
+enum CaptureFormat { CAPTURE_Y4M, CAPTURE_RAW, CAPTURE_PNG, CAPTURE_VIDEO };
+
+CaptureFormat captureFormatFor(const std::string& target);
+
+// Writes frames to disk on its own encoder thread.
+// submit() only queues a reference to the frame (see FramePool), so the caller
+// must not draw into it again before the pool hands it back. When the encoder
+// falls behind and the queue is full, live capture drops the frame and counts it
+// instead of waiting; headless capture can wait instead.
+// The output has a constant frame rate. Headless capture writes a frame per tick;
+// live capture stamps frames with the simulation time, and each is written as often
+// as it fills frame slots of the video, so the clip plays at game speed whether the
+// renderer kept up with the ticks or not.
+//   .y4m          YUV4MPEG2, 4:2:0 (plays in ffplay/mpv, feeds ffmpeg)
+//   .bgr / .raw   raw BGR24 frames back to back (size printed on open)
+//   .png          numbered PNG files: "clip.png" -> clip_000000.png, ...
+//   other         cv::VideoWriter (.avi MJPG, .mp4 mp4v, ...); Y4M next to it if no codec is available
+class FrameCapture
+{
+public:
+    struct CaptureStats {
+        int64_t submitted;
+        int64_t written;
+        int64_t dropped;
+        int64_t failed;         // frames the writer could not write
+    };
+
+private:
+    CaptureFormat format;
+    std::string target;
+    cv::Size size;
+    double fps;
+
+    std::ofstream file;         // Y4M / raw
+    cv::VideoWriter video;
+    cv::Mat yuv;                // conversion buffer for Y4M
+    std::string pngPrefix;
+
+    struct QueuedFrame {
+        cv::Mat frame;
+        int64_t repeats;        // frame slots of the video it fills
+    };
+    SpscQueue<QueuedFrame, CAPTURE_QUEUE_FRAMES> queue;
+    int64_t lastSlot;           // producer side: slot of the last queued frame, -1 = none yet
+    std::thread encoder;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping;
+    bool active;
+
+    std::atomic<int64_t> submitted;
+    std::atomic<int64_t> written;
+    std::atomic<int64_t> dropped;
+    std::atomic<int64_t> failed;
+
+    bool openWriter();
+    bool queueFrame(const cv::Mat& frame, int64_t repeats, bool wait);
+    bool writeFrame(const cv::Mat& frame);
+    void encode();
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Starts the encoder for frames of `size` shown at `fps`; false if the target cannot be written
+    bool open(const std::string& target, cv::Size size, double fps);
+    // Writes what is queued, then closes the file
+    void close();
+    bool isOpen() const { return active; }
+    const std::string& getTarget() const { return target; }
+
+    // Producer side (one thread): false when the frame was dropped. With wait, blocks until there is room.
+    bool submit(const cv::Mat& frame, bool wait = false);
+    // Live frame at simulation time timeNs (FixedStepClock time): fills the video slots since the
+    // last frame, or none when it falls in the same slot. A dropped frame's slots go to the next one.
+    bool submitAt(const cv::Mat& frame, int64_t timeNs);
+
+    CaptureStats getStats() const;
+    void printStats(std::ostream& out) const;
+};
+
+// File name for a capture started now: capture_YYYYMMDD_HHMMSS + extension
+std::string captureFileName(const std::string& extension);
+
+// Headless: plays a recorded game and writes one frame per tick, as fast as encoding allows
+bool renderReplayToFile(const std::string& replayFile, const std::string& target, std::ostream& out);
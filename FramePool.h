@@ -0,0 +1,44 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Frames allocated once and handed between threads by cv::Mat reference, never copied.
+// A frame is free again when the pool holds the only reference to it, so
+// whoever got it (the window, the encoder queue) releases it just by dropping
+// its cv::Mat. Only one thread may acquire; any thread may hold and drop frames.
+class FramePool
+{
+private:
+    std::vector<cv::Mat> frames;
+    size_t next;
+
+public:
+    FramePool() : next(0) {}
+
+    // `count` black frames of the given size; keeps the current ones if nothing changed
+    void reset(size_t count, cv::Size size) {
+        if (frames.size() == count && !frames.empty() && frames[0].size() == size) return;
+        frames.clear();
+        for (size_t i = 0; i < count; ++i) {
+            frames.push_back(cv::Mat::zeros(size, CV_8UC3));
+        }
+        next = 0;
+    }
+
+    // A frame nobody else references, round robin; false when all are in use
+    bool acquire(cv::Mat& frame) {
+        frame.release();
+        for (size_t tried = 0; tried < frames.size(); ++tried) {
+            cv::Mat& candidate = frames[next];
+            next = (next + 1) % frames.size();
+            // Atomic read: other threads drop their references with CV_XADD
+            if (CV_XADD(&candidate.u->refcount, 0) == 1) {
+                frame = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return frames.size(); }
+};
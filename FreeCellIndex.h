@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Set of free board cells (by row-major index): one bit per cell plus a member
+// count per block of 4096 cells. Insert and remove are O(1); at(i) returns the
+// i-th member in row-major order by skipping whole blocks, then whole words.
+// Which cell a random index picks therefore only depends on the set, not on the
+// order of the edits that built it, so a restored snapshot places apples
+// exactly like the original game.
+class FreeCellIndex {
+private:
+    static const int WORDS_PER_BLOCK = 64;
+
+    std::vector<uint64_t> bits;
+    std::vector<int> blockCount;
+    int count;
+
+    static int popCount(uint64_t word) {
+#ifdef _MSC_VER
+        return (int)__popcnt64(word);
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    static int lowestBit(uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return (int)index;
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    void countBlocks() {
+        blockCount.assign((bits.size() + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK, 0);
+        count = 0;
+        for (size_t w = 0; w < bits.size(); ++w) {
+            int members = popCount(bits[w]);
+            blockCount[w / WORDS_PER_BLOCK] += members;
+            count += members;
+        }
+    }
+
+public:
+    FreeCellIndex() : count(0) {}
+
+    // Empty set over `cellCount` cells
+    void reset(int cellCount) {
+        bits.assign((cellCount + 63) / 64, 0);
+        countBlocks();
+    }
+
+    // Set over `cellCount` cells holding every cell with isFree(cell)
+    template <typename IsFree>
+    void assign(int cellCount, IsFree isFree) {
+        bits.assign((cellCount + 63) / 64, 0);
+        for (int cell = 0; cell < cellCount; ++cell) {
+            if (isFree(cell)) bits[cell >> 6] |= 1ULL << (cell & 63);
+        }
+        countBlocks();
+    }
+
+    bool contains(int cell) const { return (bits[cell >> 6] >> (cell & 63)) & 1; }
+
+    void insert(int cell) {
+        if (contains(cell)) return;
+        bits[cell >> 6] |= 1ULL << (cell & 63);
+        blockCount[cell >> 12]++;
+        count++;
+    }
+
+    void remove(int cell) {
+        if (!contains(cell)) return;
+        bits[cell >> 6] &= ~(1ULL << (cell & 63));
+        blockCount[cell >> 12]--;
+        count--;
+    }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // The i-th free cell in row-major order, 0 <= i < size()
+    int at(int i) const {
+        int block = 0;
+        while (blockCount[block] <= i) i -= blockCount[block++];
+        int word = block * WORDS_PER_BLOCK;
+        for (int members; (members = popCount(bits[word])) <= i; ++word) i -= members;
+
+        uint64_t w = bits[word];
+        for (; i > 0; --i) w &= w - 1;  // drop the lower members
+        return word * 64 + lowestBit(w);
+    }
+};
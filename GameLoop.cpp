@@ -0,0 +1,91 @@
+#include "GameLoop.h"
+#include <algorithm>
+#include <cmath>
+
+FixedStepClock::FixedStepClock(int ticksPerSecond) : accumulatorNs(0), simTimeNs(0), running(false) {
+    setTicksPerSecond(ticksPerSecond);
+    resetJitter();
+}
+
+void FixedStepClock::setTicksPerSecond(int ticksPerSecond) {
+    this->ticksPerSecond = std::max(1, ticksPerSecond);
+    stepNs = TIME_FREQUENCY / this->ticksPerSecond;
+}
+
+void FixedStepClock::start() {
+    if (running) return;
+    running = true;
+    accumulatorNs = 0;
+    lastAdvance = Clock::now();
+    lastTick = Clock::time_point();
+}
+
+int FixedStepClock::advance() {
+    if (!running) return 0;
+    Clock::time_point now = Clock::now();
+    accumulatorNs += std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastAdvance).count();
+    lastAdvance = now;
+
+    int64_t due = accumulatorNs / stepNs;
+    if (due > MAX_CATCH_UP_TICKS) {
+        droppedTicks += due - MAX_CATCH_UP_TICKS;
+        accumulatorNs -= (due - MAX_CATCH_UP_TICKS) * stepNs;
+        due = MAX_CATCH_UP_TICKS;
+    }
+    return (int)due;
+}
+
+void FixedStepClock::tick() {
+    Clock::time_point now = Clock::now();
+    // The tick was due when the accumulator crossed stepNs; what is left past that is lateness
+    double latenessMs = (accumulatorNs - stepNs) / 1e6;
+    accumulatorNs -= stepNs;
+    simTimeNs += stepNs;
+
+    ticks++;
+    latenessSumMs += latenessMs;
+    latenessMaxMs = std::max(latenessMaxMs, latenessMs);
+    if (lastTick != Clock::time_point()) {
+        double intervalMs = std::chrono::duration<double, std::milli>(now - lastTick).count();
+        intervalSumMs += intervalMs;
+        intervalSquareSumMs += intervalMs * intervalMs;
+        intervals++;
+    }
+    lastTick = now;
+}
+
+int FixedStepClock::msUntilNextTick() const {
+    int64_t leftNs = stepNs - accumulatorNs - std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - lastAdvance).count();
+    if (leftNs <= 0) return 1; // waitKey(0) would block forever
+    return (int)std::max<int64_t>(1, leftNs / 1000000);
+}
+
+FixedStepClock::JitterStats FixedStepClock::getJitter() const {
+    JitterStats stats;
+    stats.ticks = ticks;
+    stats.droppedTicks = droppedTicks;
+    stats.meanLatenessMs = ticks > 0 ? latenessSumMs / ticks : 0.0;
+    stats.maxLatenessMs = latenessMaxMs;
+    stats.meanIntervalMs = intervals > 0 ? intervalSumMs / intervals : 0.0;
+    double variance = intervals > 0 ? intervalSquareSumMs / intervals - stats.meanIntervalMs * stats.meanIntervalMs : 0.0;
+    stats.intervalStdDevMs = std::sqrt(std::max(0.0, variance));
+    return stats;
+}
+
+void FixedStepClock::resetJitter() {
+    ticks = 0;
+    droppedTicks = 0;
+    latenessSumMs = 0.0;
+    latenessMaxMs = 0.0;
+    intervalSumMs = 0.0;
+    intervalSquareSumMs = 0.0;
+    intervals = 0;
+}
+
+void FixedStepClock::printJitter(std::ostream& out) const {
+    JitterStats stats = getJitter();
+    out << "Ticks: " << stats.ticks << " at " << ticksPerSecond << "/s"
+        << "  lateness mean " << stats.meanLatenessMs << " ms, max " << stats.maxLatenessMs << " ms"
+        << "  interval " << stats.meanIntervalMs << " +/- " << stats.intervalStdDevMs << " ms"
+        << "  dropped " << stats.droppedTicks << std::endl;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+// Fixed-timestep simulation clock for the game loop.
+// Wall time is accumulated and paid out in whole ticks of 1 / ticksPerSecond,
+// so the simulation runs at the same rate however long rendering, imshow or
+// input polling take. It also keeps the simulation time (for the game's timers)
+// and how late each tick ran compared to its ideal schedule.
+class FixedStepClock
+{
+public:
+    static const int64_t TIME_FREQUENCY = 1000000000;  // simulation time unit: ns
+    static const int MAX_CATCH_UP_TICKS = 5;            // beyond this, a stall is dropped rather than replayed
+
+    struct JitterStats {
+        int64_t ticks;
+        int64_t droppedTicks;
+        double meanLatenessMs;
+        double maxLatenessMs;
+        double meanIntervalMs;
+        double intervalStdDevMs;
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    int ticksPerSecond;
+    int64_t stepNs;
+    int64_t accumulatorNs;
+    int64_t simTimeNs;
+    Clock::time_point lastAdvance;
+    Clock::time_point lastTick;
+    bool running;
+
+    // Jitter accumulators
+    int64_t ticks;
+    int64_t droppedTicks;
+    double latenessSumMs;
+    double latenessMaxMs;
+    double intervalSumMs;
+    double intervalSquareSumMs;
+    int64_t intervals;
+
+public:
+    FixedStepClock(int ticksPerSecond);
+
+    void setTicksPerSecond(int ticksPerSecond);
+    int getTicksPerSecond() const { return ticksPerSecond; }
+
+    // Start (or resume after a pause/menu) without replaying the time spent away
+    void start();
+    void stop() { running = false; }
+    bool isRunning() const { return running; }
+
+    // Number of ticks due now; call tick() once for each of them
+    int advance();
+    void tick();
+
+    // How long the loop can wait for input before the next tick is due
+    int msUntilNextTick() const;
+
+    int64_t getSimTime() const { return simTimeNs; }
+
+    JitterStats getJitter() const;
+    void resetJitter();
+    void printJitter(std::ostream& out) const;
+};
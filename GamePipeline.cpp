@@ -0,0 +1,148 @@
+#include "GamePipeline.h"
+#include "Profiler.h"
+#include <chrono>
+
+GamePipeline::GamePipeline(SnakeGame& game, FixedStepClock& clock, int& ticksPerSecond, FrameProfiler& profiler)
+    : game(game), clock(clock), ticksPerSecond(ticksPerSecond), profiler(profiler), mirror(game.map, 0), renderer(CELL_SIZE),
+    capture(nullptr), carriedAll(false), stopSim(false), stopRender(false), running(false), finished(false)
+{
+    carriedCells.reserve(MAX_DIRTY_CELLS * 2);
+    for (int i = 0; i < 3; ++i) {
+        states.slotAt(i).dirtyCells.reserve(MAX_DIRTY_CELLS * 2);
+    }
+}
+
+GamePipeline::~GamePipeline() {
+    stop();
+}
+
+void GamePipeline::start(cv::Size frameSize) {
+    if (running) return;
+
+    // The map may have been edited or reloaded since the last run
+    mirror.map = game.map;
+    mirror.resetGame();
+    renderer.invalidate();
+    // Three in the triple buffer, one on screen, one being drawn, and the capture queue
+    framePool.reset(5 + (capture ? CAPTURE_QUEUE_FRAMES + 1 : 0), frameSize);
+    if (spareFrame.size() != frameSize) spareFrame = cv::Mat::zeros(frameSize, CV_8UC3);
+    int stale;
+    while (keys.pop(stale)) {}
+
+    stopSim = false;
+    stopRender = false;
+    finished.store(false);
+    running = true;
+    simThread = std::thread(&GamePipeline::simulate, this);
+    renderThread = std::thread(&GamePipeline::renderFrames, this);
+}
+
+// The simulation stops first, so the renderer still draws the last state it published
+void GamePipeline::stop() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopSim = true;
+    }
+    wake.notify_all();
+    simThread.join();
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopRender = true;
+    }
+    wake.notify_all();
+    renderThread.join();
+    running = false;
+}
+
+void GamePipeline::simulate() {
+    clock.start();
+    publishState(true); // resumed or new game: the board is not on screen yet
+
+    while (!game.isGameOver()) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (wake.wait_for(lock, std::chrono::milliseconds(clock.msUntilNextTick()), [this]() { return stopSim; })) break;
+        }
+
+        // Into the game's turn queue: each tick below takes at most one of them
+        int key;
+        while (keys.pop(key)) game.queueKey(key);
+
+        // As many fixed ticks as the elapsed time pays for
+        clock.setTicksPerSecond(ticksPerSecond);
+        int dueTicks = clock.advance();
+        if (dueTicks == 0) continue;
+        {
+            ProfileScope scope(profiler, PHASE_UPDATE);
+            for (int i = 0; i < dueTicks && !game.isGameOver(); i++) {
+                clock.tick();
+                game.update(ticksPerSecond);
+            }
+        }
+        publishState(false);
+    }
+
+    clock.stop();
+    finished.store(game.isGameOver(), std::memory_order_release);
+}
+
+void GamePipeline::publishState(bool redrawAll) {
+    FrameState& state = states.writeSlot();
+
+    // Dirty cells count from the last state the renderer took: while the previous one
+    // is still untaken (and will now be skipped), its cells are carried over
+    if (states.isFresh()) {
+        state.dirtyCells.assign(carriedCells.begin(), carriedCells.end());
+        state.allDirty = carriedAll;
+    }
+    else {
+        state.dirtyCells.clear();
+        state.allDirty = false;
+    }
+    const std::vector<int>& changed = game.getDirtyCells();
+    state.dirtyCells.insert(state.dirtyCells.end(), changed.begin(), changed.end());
+    state.allDirty = state.allDirty || redrawAll || game.isAllDirty() || state.dirtyCells.size() > MAX_DIRTY_CELLS;
+    if (state.allDirty) state.dirtyCells.clear();
+    game.clearDirtyCells();
+
+    game.snapshot(state.game);
+    state.autopilotUs = game.isAutopilot() ? (int)game.getAutopilot().getStats().lastUs : -1;
+    state.simTime = clock.getSimTime();
+    carriedCells.assign(state.dirtyCells.begin(), state.dirtyCells.end());
+    carriedAll = state.allDirty;
+
+    states.publish();
+    { std::lock_guard<std::mutex> lock(wakeMutex); } // the renderer is either waiting or will see the new state
+    wake.notify_all();
+}
+
+void GamePipeline::renderFrames() {
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this]() { return stopRender || states.isFresh(); });
+            stopping = stopRender;
+        }
+        if (!states.take()) {
+            if (stopping) break;
+            continue;
+        }
+
+        ProfileScope scope(profiler, PHASE_RENDER);
+        const FrameState& state = states.readSlot();
+        mirror.restore(state.game);
+        mirror.setDirtyCells(state.dirtyCells, state.allDirty);
+
+        cv::Mat& frame = frames.writeSlot();
+        if (!framePool.acquire(frame)) {
+            // Every frame is still held elsewhere: keep the renderer in step, show nothing new
+            SnakeGame::renderState(renderer, mirror, spareFrame, state.autopilotUs);
+            continue;
+        }
+        SnakeGame::renderState(renderer, mirror, frame, state.autopilotUs);
+        if (capture) capture->submitAt(frame, state.simTime);
+        frames.publish();
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Snake.h"
+#include "SnakeRenderer.h"
+#include "GameLoop.h"
+#include "TripleBuffer.h"
+#include "FramePool.h"
+#include "FrameCapture.h"
+#include "SpscQueue.h"
+
+class FrameProfiler;
+
+// What the simulation hands to the renderer after each batch of ticks
+struct FrameState {
+    SnakeSnapshot game;
+    std::vector<int> dirtyCells;    // cells changed since the state the renderer last took
+    bool allDirty;
+    int autopilotUs;                // planner time of the last tick, -1 = autopilot off
+    int64_t simTime;                // simulation clock at this state: places captured frames in time
+};
+
+// Game play on three threads.
+// The simulation thread owns the game while running: it moves the keys from a
+// lock-free queue into the game's turn queue (one turn per tick), runs the
+// fixed-step ticks and publishes a snapshot through a triple buffer. The render
+// thread restores the newest snapshot into a copy of the game and rasterizes it
+// into a reusable frame from a pool, published the same way (and queued for the
+// capture encoder, if one is set). The main thread only pumps input and shows
+// the newest frame, so a slow frame delays the next picture, never the next tick.
+// The main thread may touch the game, the clock and ticksPerSecond only while
+// the pipeline is stopped (menus, pause, game over).
+class GamePipeline
+{
+private:
+    static const size_t MAX_DIRTY_CELLS = 64;   // more changes than this redraw the whole view
+
+    SnakeGame& game;
+    FixedStepClock& clock;
+    int& ticksPerSecond;
+    FrameProfiler& profiler;
+
+    SnakeCore mirror;           // the render thread's copy of the game
+    SnakeRenderer renderer;
+    TripleBuffer<FrameState> states;
+    FramePool framePool;
+    TripleBuffer<cv::Mat> frames;   // references to pool frames
+    cv::Mat spareFrame;             // drawn into when the pool is exhausted
+    FrameCapture* capture;
+    SpscQueue<int, 64> keys;
+    std::vector<int> carriedCells;  // dirty cells of the last published state, while it is not taken
+    bool carriedAll;
+
+    std::thread simThread;
+    std::thread renderThread;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopSim;
+    bool stopRender;
+    bool running;
+    std::atomic<bool> finished;
+
+    void simulate();
+    void renderFrames();
+    void publishState(bool redrawAll);
+
+public:
+    GamePipeline(SnakeGame& game, FixedStepClock& clock, int& ticksPerSecond, FrameProfiler& profiler);
+    ~GamePipeline();
+
+    // Start (or resume) play with frames of the given size; stop() waits for both threads
+    void start(cv::Size frameSize);
+    void stop();
+    bool isRunning() const { return running; }
+    // The game ended; the pipeline can be stopped and its last frame taken
+    bool isGameOver() const { return finished.load(std::memory_order_acquire); }
+
+    void pressKey(int key) { keys.push(key); }
+    // Also send every rendered frame to `capture` (nullptr = off); only while stopped
+    void setCapture(FrameCapture* capture) { this->capture = capture; }
+
+    // Newest frame the main thread has not shown yet; getFrame() stays valid until the next takeFrame()
+    bool takeFrame() { return frames.take(); }
+    const cv::Mat& getFrame() const { return frames.readSlot(); }
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// Small seedable PRNG (SplitMix64); every game owns one so runs are reproducible from the seed
+class GameRng {
+private:
+    uint64_t state;
+
+public:
+    GameRng(uint64_t seed = 0) : state(seed) {}
+
+    void seed(uint64_t seed) { state = seed; }
+    uint64_t getState() const { return state; }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform integer in [0, bound)
+    uint32_t nextBelow(uint32_t bound) {
+        return (uint32_t)(((next() >> 32) * (uint64_t)bound) >> 32);
+    }
+};
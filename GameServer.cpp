@@ -0,0 +1,461 @@
+#include "GameServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include "Replay.h"
+
+int64_t netClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool isMoveKey(int key) {
+    return key == 'w' || key == 'a' || key == 's' || key == 'd';
+}
+
+GameServer::Match::Match(int index, const Map& map, int snakes, int players, uint64_t seed)
+    : index(index), game(map, snakes, seed), seats(new Seat[players]), netOpen(true), netJoined(0),
+    running(false), joined(0), connected(0), nextSeed(seed + 1), startTick(0), message(sizeof(NetTick) + snakes * sizeof(NetSnakeState)),
+    games(0), inputs(0), slowClients(0), messages(0), bytes(0)
+{
+    for (int s = 0; s < players; ++s) {
+        Seat& seat = seats[s];
+        seat.netSocket = INVALID_SOCKET_HANDLE;
+        seat.netTaken = false;
+        seat.netGeneration = 0;
+        seat.netPollIndex = 0;
+        seat.socket = INVALID_SOCKET_HANDLE;
+        seat.connected = false;
+        seat.generation = 0;
+        seat.sendBuffer.resize(SEAT_SEND_BUFFER);
+        seat.sendStart = 0;
+        seat.sendEnd = 0;
+    }
+}
+
+GameServer::GameServer(const Map& map, const ServerConfig& config)
+    : map(map), config(config), mapHash(mapContentHash(map)), pool(config.threads), clock(config.ticksPerSecond),
+    listener(INVALID_SOCKET_HANDLE), stopping(false), started(false), nextMatch(0), joins(0), rejected(0), droppedInputs(0),
+    ticks(0), reportStream(nullptr), reportSeconds(0)
+{
+    this->config.snakesPerMatch = std::max(1, std::min(config.snakesPerMatch, MAX_SNAKES));
+    this->config.playersPerMatch = std::max(0, std::min(config.playersPerMatch, this->config.snakesPerMatch));
+    for (int m = 0; m < config.matches; ++m) {
+        // Seeds far apart so no two matches ever play the same game
+        uint64_t seed = config.seed + ((uint64_t)m << 32);
+        matches.emplace_back(new Match(m, map, this->config.snakesPerMatch, this->config.playersPerMatch, seed));
+    }
+}
+
+GameServer::~GameServer() {
+    stop();
+}
+
+bool GameServer::start() {
+    if (started) return true;
+    std::string error;
+    if (!initSockets()) {
+        std::cerr << "Sockets are not available" << std::endl;
+        return false;
+    }
+    listener = listenOn(config.endpoint, error);
+    if (listener == INVALID_SOCKET_HANDLE) {
+        std::cerr << "Cannot start the server: " << error << std::endl;
+        return false;
+    }
+    stopping = false;
+    started = true;
+    networkThread = std::thread(&GameServer::serveNetwork, this);
+    simulationThread = std::thread(&GameServer::simulate, this);
+    return true;
+}
+
+void GameServer::stop() {
+    if (!started) return;
+    stopping = true;
+    simulationThread.join();
+    networkThread.join();
+    started = false;
+
+    // Both threads are gone: every socket the network side still holds is closed here
+    for (auto& match : matches) {
+        for (int s = 0; s < config.playersPerMatch; ++s) {
+            Seat& seat = match->seats[s];
+            if (seat.netTaken) closeSocket(seat.netSocket);
+            seat.netTaken = false;
+            seat.connected = false;
+        }
+    }
+    closeSocket(listener, config.endpoint);
+    listener = INVALID_SOCKET_HANDLE;
+    if (reportStream) printStats(*reportStream);
+}
+
+// ---- Network thread ----
+
+void GameServer::serveNetwork() {
+    SocketPoller poller;
+    poller.add(listener);
+    polled.assign(1, std::make_pair(-1, -1));
+    char buffer[256];
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int ready = poller.wait(NETWORK_POLL_MS);
+
+        // Releases first: they free the seats for the clients accepted below
+        MatchEvent event;
+        for (auto& match : matches) {
+            while (match->toNetwork.pop(event)) {
+                handleRelease(poller, *match, event);
+            }
+        }
+        if (ready <= 0) continue;
+
+        // Backwards, as removing an entry moves the last one into its place
+        for (size_t i = poller.size(); i-- > 1; ) {
+            if (poller.isReady(i)) readClient(poller, i, buffer, (int)sizeof(buffer));
+        }
+        if (poller.isReady(0)) acceptClients(poller);
+    }
+}
+
+void GameServer::acceptClients(SocketPoller& poller) {
+    SocketHandle client;
+    while ((client = acceptClient(listener)) != INVALID_SOCKET_HANDLE) {
+        // First open match with a free seat, going round from where the last client went
+        Match* match = nullptr;
+        int seatIndex = -1;
+        for (size_t k = 0; k < matches.size() && !match; ++k) {
+            Match& candidate = *matches[(nextMatch + k) % matches.size()];
+            if (!candidate.netOpen) continue;
+            for (int s = 0; s < config.playersPerMatch; ++s) {
+                if (!candidate.seats[s].netTaken) {
+                    match = &candidate;
+                    seatIndex = s;
+                    break;
+                }
+            }
+        }
+        if (!match) {
+            rejected++;
+            closeSocket(client);
+            continue;
+        }
+        nextMatch = match->index;
+
+        Seat& seat = match->seats[seatIndex];
+        seat.netTaken = true;
+        seat.netSocket = client;
+        seat.netGeneration++;
+        seat.netPollIndex = poller.size();
+        poller.add(client);
+        polled.push_back(std::make_pair(match->index, seatIndex));
+        if (++match->netJoined == config.playersPerMatch) match->netOpen = false;
+        joins++;
+
+        MatchEvent join = { EVENT_JOIN, (uint8_t)seatIndex, seat.netGeneration, false, client };
+        pushEvent(match->toSimulation, join);
+    }
+}
+
+void GameServer::readClient(SocketPoller& poller, size_t index, char* buffer, int size) {
+    Match& match = *matches[polled[index].first];
+    int seatIndex = polled[index].second;
+    Seat& seat = match.seats[seatIndex];
+    int received = receiveSome(seat.netSocket, buffer, size);
+    if (received < 0) {
+        // Gone: the simulation may still be sending, so the socket stays open until it lets go
+        stopPolling(poller, seat);
+        MatchEvent leave = { EVENT_LEAVE, (uint8_t)seatIndex, seat.netGeneration, false, seat.netSocket };
+        pushEvent(match.toSimulation, leave);
+        return;
+    }
+    for (int i = 0; i < received; ++i) {
+        int key = tolower((unsigned char)buffer[i]);
+        if (!isMoveKey(key)) continue;
+        SeatInput input = { (uint8_t)key, seat.netGeneration };
+        if (!seat.inputs.push(input)) droppedInputs++;
+    }
+}
+
+// The queues are sized so that this never fails; if it does, the seat or match it is about is stuck
+void GameServer::pushEvent(SpscQueue<MatchEvent, MATCH_EVENT_QUEUE>& queue, const MatchEvent& event) {
+    if (!queue.push(event)) {
+        std::cerr << "Match event queue full, event " << (int)event.type << " for seat " << (int)event.seat << " lost" << std::endl;
+    }
+}
+
+void GameServer::stopPolling(SocketPoller& poller, Seat& seat) {
+    size_t index = seat.netPollIndex;
+    if (index == 0) return;
+    seat.netPollIndex = 0;
+    poller.remove(index);
+    polled[index] = polled.back();
+    polled.pop_back();
+    if (index < polled.size()) {
+        matches[polled[index].first]->seats[polled[index].second].netPollIndex = index;
+    }
+}
+
+void GameServer::handleRelease(SocketPoller& poller, Match& match, const MatchEvent& event) {
+    if (event.type == EVENT_MATCH_OVER) {
+        match.netJoined = 0;
+        match.netOpen = true;
+        return;
+    }
+    Seat& seat = match.seats[event.seat];
+    stopPolling(poller, seat);
+    closeSocket(seat.netSocket);
+    seat.netSocket = INVALID_SOCKET_HANDLE;
+    seat.netTaken = false;
+    if (event.lobby) {
+        // The match has not started: the seat is open again
+        match.netJoined--;
+        match.netOpen = true;
+    }
+}
+
+// ---- Simulation thread and its pool ----
+
+void GameServer::simulate() {
+    LatencyHistogram window;
+    int64_t reportedAt = netClockNs();
+    clock.start();
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int due = clock.advance();
+        if (due == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(clock.msUntilNextTick()));
+            continue;
+        }
+        for (int i = 0; i < due; ++i) {
+            clock.tick();
+            int64_t startedAt = netClockNs();
+            pool.parallelFor(matches.size(), [this](size_t m) { tickMatch(*matches[m]); });
+            int64_t tookNs = netClockNs() - startedAt;
+            tickTime.record(tookNs);
+            window.record(tookNs);
+            ticks++;
+        }
+
+        if (reportStream && reportSeconds > 0 && netClockNs() - reportedAt >= reportSeconds * 1000000000LL) {
+            int running = 0;
+            for (auto& match : matches) running += match->running ? 1 : 0;
+            *reportStream << std::fixed << std::setprecision(1) << "tick " << ticks << ": " << running << "/" << matches.size() << " matches running, tick time p50 "
+                << window.percentileUs(0.50) << " us  p99 " << window.percentileUs(0.99) << " us  max " << window.maxUs() << " us" << std::endl;
+            window.reset();
+            reportedAt = netClockNs();
+        }
+    }
+    clock.stop();
+}
+
+void GameServer::tickMatch(Match& match) {
+    MatchEvent event;
+    while (match.toSimulation.pop(event)) {
+        Seat& seat = match.seats[event.seat];
+        if (event.type == EVENT_JOIN) {
+            seat.socket = event.socket;
+            seat.generation = event.generation;
+            seat.connected = true;
+            seat.sendStart = 0;
+            seat.sendEnd = 0;
+            match.joined++;
+            match.connected++;
+            writeWelcome(match, event.seat);
+        }
+        else if (event.type == EVENT_LEAVE && seat.connected && seat.generation == event.generation) {
+            releaseSeat(match, event.seat);
+        }
+    }
+
+    if (!match.running) {
+        if (match.joined < config.playersPerMatch) {
+            for (int s = 0; s < config.playersPerMatch; ++s) {
+                if (match.seats[s].connected) flushSeat(match, s);
+            }
+            return;
+        }
+        startGame(match);
+        return;
+    }
+
+    // Key presses since the last tick, in order; snakes without a client follow the bot
+    for (int s = 0; s < config.playersPerMatch; ++s) {
+        Seat& seat = match.seats[s];
+        SeatInput input;
+        while (seat.inputs.pop(input)) {
+            if (!seat.connected || input.generation != seat.generation) continue;
+            match.game.changeDirection(s, input.key);
+            match.inputs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < config.snakesPerMatch; ++i) {
+        if (i < config.playersPerMatch && match.seats[i].connected) continue;
+        int key = greedyMultiBot(match.game, i);
+        if (key != -1) match.game.changeDirection(i, key);
+    }
+
+    match.game.update();
+    broadcastTick(match);
+
+    bool abandoned = config.playersPerMatch > 0 && match.connected == 0;
+    if (match.game.isGameOver() || abandoned) endGame(match);
+}
+
+void GameServer::startGame(Match& match) {
+    match.running = true;
+    match.startTick = match.game.getTickCount();
+    broadcastTick(match); // the starting board
+}
+
+void GameServer::endGame(Match& match) {
+    for (int s = 0; s < config.playersPerMatch; ++s) {
+        if (match.seats[s].connected) releaseSeat(match, s);
+    }
+    match.running = false;
+    match.joined = 0;
+    match.games.fetch_add(1, std::memory_order_relaxed);
+    match.game.newGame(match.nextSeed++);
+    if (config.playersPerMatch > 0) {
+        MatchEvent over = { EVENT_MATCH_OVER, 0, 0, false, INVALID_SOCKET_HANDLE };
+        pushEvent(match.toNetwork, over);
+    }
+}
+
+void GameServer::releaseSeat(Match& match, int seatIndex) {
+    Seat& seat = match.seats[seatIndex];
+    seat.connected = false;
+    flushSeat(match, seatIndex); // best effort: the last tick, if the client keeps up
+    match.connected--;
+    if (!match.running) match.joined--;
+    MatchEvent release = { EVENT_RELEASE, (uint8_t)seatIndex, seat.generation, !match.running, seat.socket };
+    pushEvent(match.toNetwork, release);
+}
+
+void GameServer::writeWelcome(Match& match, int seatIndex) {
+    NetWelcome welcome;
+    welcome.header.type = NET_WELCOME;
+    welcome.header.reserved = 0;
+    welcome.header.size = (uint16_t)sizeof(NetWelcome);
+    memcpy(welcome.magic, NET_MAGIC, 4);
+    welcome.version = NET_VERSION;
+    welcome.match = (uint16_t)match.index;
+    welcome.seat = (uint8_t)seatIndex;
+    welcome.snakeCount = (uint8_t)config.snakesPerMatch;
+    welcome.rows = (uint16_t)map.getRows();
+    welcome.cols = (uint16_t)map.getCols();
+    welcome.ticksPerSecond = (uint16_t)config.ticksPerSecond;
+    welcome.seed = match.game.getSeed();
+    welcome.mapHash = mapHash;
+    if (queueMessage(match, seatIndex, (const char*)&welcome, sizeof(welcome))) flushSeat(match, seatIndex);
+}
+
+// One message for the whole match, written into its preallocated buffer and copied to every seat
+void GameServer::broadcastTick(Match& match) {
+    const MultiSnakeCore& game = match.game;
+    NetTick tick;
+    tick.header.type = NET_TICK;
+    tick.header.reserved = 0;
+    tick.header.size = (uint16_t)match.message.size();
+    tick.tick = (uint32_t)(game.getTickCount() - match.startTick);
+    tick.apple[0] = (int16_t)game.getApple().x;
+    tick.apple[1] = (int16_t)game.getApple().y;
+    tick.specialApple[0] = (int16_t)game.getSpecialApple().x;
+    tick.specialApple[1] = (int16_t)game.getSpecialApple().y;
+    tick.pinkApple[0] = (int16_t)game.getPinkApple().x;
+    tick.pinkApple[1] = (int16_t)game.getPinkApple().y;
+    tick.snakeCount = (uint8_t)game.getSnakeCount();
+    tick.gameOver = game.isGameOver() ? 1 : 0;
+
+    char* states = match.message.data() + sizeof(NetTick);
+    for (int i = 0; i < game.getSnakeCount(); ++i) {
+        const SnakePlayer& player = game.getPlayer(i);
+        NetSnakeState state;
+        SnakePoint head = player.body.empty() ? SnakePoint(-1, -1) : player.body.front();
+        state.headX = (int16_t)head.x;
+        state.headY = (int16_t)head.y;
+        state.length = (uint32_t)player.body.size();
+        state.score = (uint32_t)player.score;
+        state.hearts = (uint8_t)std::max(player.hearts, 0);
+        state.flags = (player.alive ? NET_SNAKE_ALIVE : 0) | (player.invincible ? NET_SNAKE_INVINCIBLE : 0);
+        state.dir = (uint8_t)player.dir;
+        state.lastCollision = (uint8_t)player.lastCollision;
+        memcpy(states + i * sizeof(NetSnakeState), &state, sizeof(state));
+    }
+
+    for (int s = 0; s < config.playersPerMatch; ++s) {
+        if (!match.seats[s].connected) continue;
+        tick.sentAt = netClockNs();
+        memcpy(match.message.data(), &tick, sizeof(tick));
+        if (queueMessage(match, s, match.message.data(), match.message.size())) flushSeat(match, s);
+    }
+}
+
+// Appends to the seat's send buffer; a client that has fallen too far behind is let go
+bool GameServer::queueMessage(Match& match, int seatIndex, const char* data, size_t size) {
+    Seat& seat = match.seats[seatIndex];
+    if (seat.sendEnd + size > seat.sendBuffer.size() && seat.sendStart > 0) {
+        memmove(seat.sendBuffer.data(), seat.sendBuffer.data() + seat.sendStart, seat.sendEnd - seat.sendStart);
+        seat.sendEnd -= seat.sendStart;
+        seat.sendStart = 0;
+    }
+    if (seat.sendEnd + size > seat.sendBuffer.size()) {
+        match.slowClients.fetch_add(1, std::memory_order_relaxed);
+        releaseSeat(match, seatIndex);
+        return false;
+    }
+    memcpy(seat.sendBuffer.data() + seat.sendEnd, data, size);
+    seat.sendEnd += size;
+    match.messages.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Sends what the socket takes without blocking; false if the connection is gone
+bool GameServer::flushSeat(Match& match, int seatIndex) {
+    Seat& seat = match.seats[seatIndex];
+    while (seat.sendStart < seat.sendEnd) {
+        int sent = sendSome(seat.socket, seat.sendBuffer.data() + seat.sendStart, (int)(seat.sendEnd - seat.sendStart));
+        if (sent == 0) return true;
+        if (sent < 0) {
+            seat.sendStart = seat.sendEnd = 0;
+            if (seat.connected) releaseSeat(match, seatIndex);
+            return false;
+        }
+        seat.sendStart += sent;
+        match.bytes.fetch_add(sent, std::memory_order_relaxed);
+    }
+    seat.sendStart = seat.sendEnd = 0;
+    return true;
+}
+
+GameServer::ServerStats GameServer::getStats() const {
+    ServerStats stats;
+    stats.ticks = ticks;
+    stats.droppedTicks = clock.getJitter().droppedTicks;
+    stats.tickTime = tickTime;
+    stats.games = stats.slowClients = stats.inputs = stats.messages = stats.bytes = 0;
+    for (const auto& match : matches) {
+        stats.games += match->games.load();
+        stats.slowClients += match->slowClients.load();
+        stats.inputs += match->inputs.load();
+        stats.messages += match->messages.load();
+        stats.bytes += match->bytes.load();
+    }
+    stats.joins = joins.load();
+    stats.rejected = rejected.load();
+    stats.droppedInputs = droppedInputs.load();
+    return stats;
+}
+
+void GameServer::printStats(std::ostream& out) const {
+    ServerStats stats = getStats();
+    out << std::fixed << std::setprecision(1);
+    out << "Server: " << matches.size() << " matches of " << config.snakesPerMatch << " snakes (" << config.playersPerMatch << " seats), "
+        << stats.ticks << " ticks, " << stats.droppedTicks << " dropped, " << stats.games << " games" << std::endl;
+    out << "  tick time: mean " << stats.tickTime.meanUs() << " us  p50 " << stats.tickTime.percentileUs(0.50) << " us  p99 "
+        << stats.tickTime.percentileUs(0.99) << " us  max " << stats.tickTime.maxUs() << " us" << std::endl;
+    out << "  clients: " << stats.joins << " joined, " << stats.rejected << " rejected, " << stats.slowClients << " too slow; inputs: "
+        << stats.inputs << " applied, " << stats.droppedInputs << " dropped; sent " << stats.messages << " messages, " << stats.bytes << " bytes" << std::endl;
+    clock.printJitter(out);
+}
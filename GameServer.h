@@ -0,0 +1,231 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GameLoop.h"
+#include "Map.h"
+#include "MultiSnakeCore.h"
+#include "NetSocket.h"
+#include "LatencyHistogram.h"
+#include "SpscQueue.h"
+#include "WorkStealingPool.h"
+
+#define NET_MAGIC "SNKN"
+#define NET_VERSION 1
+#define SEAT_INPUT_QUEUE 64         // key presses a client can have waiting for the next tick
+#define SEAT_SEND_BUFFER 16384      // bytes a client may fall behind before it is dropped as too slow
+#define MATCH_EVENT_QUEUE 32        // > 2 events per seat: a seat is not reused before its release is seen
+#define NETWORK_POLL_MS 5           // how long a release can wait for the network thread
+
+// Wire format, little-endian. A client sends one byte per key press (w, a, s, d).
+// The server sends a NetWelcome when the client gets a seat; once every seat of the
+// match is taken, a NetTick for the starting board and then one after every tick,
+// each followed by a NetSnakeState per snake. A client sees every tick of its match,
+// so the bodies follow from the heads and lengths. After the tick with gameOver set,
+// the server closes the connection.
+enum NetMessageType { NET_WELCOME = 1, NET_TICK = 2 };
+enum NetSnakeFlags { NET_SNAKE_ALIVE = 1, NET_SNAKE_INVINCIBLE = 2 };
+
+#pragma pack(push, 1)
+struct NetMessageHeader {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t size;          // whole message, header included
+};
+
+struct NetWelcome {
+    NetMessageHeader header;
+    char magic[4];
+    uint16_t version;
+    uint16_t match;
+    uint8_t seat;           // the client's snake
+    uint8_t snakeCount;
+    uint16_t rows;
+    uint16_t cols;
+    uint16_t ticksPerSecond;
+    uint64_t seed;
+    uint64_t mapHash;       // mapContentHash of the server's map
+};
+
+struct NetTick {
+    NetMessageHeader header;
+    uint32_t tick;          // 0 = the board as the match starts
+    int64_t sentAt;         // steady clock, ns, when the message was written
+    int16_t apple[2];
+    int16_t specialApple[2];
+    int16_t pinkApple[2];
+    uint8_t snakeCount;
+    uint8_t gameOver;
+};
+
+struct NetSnakeState {
+    int16_t headX;
+    int16_t headY;
+    uint32_t length;        // 0 once the snake is out
+    uint32_t score;
+    uint8_t hearts;
+    uint8_t flags;          // NetSnakeFlags
+    uint8_t dir;
+    uint8_t lastCollision;  // DeathCause
+};
+#pragma pack(pop)
+
+struct ServerConfig {
+    std::string endpoint;   // see NetSocket.h
+    int matches;
+    int playersPerMatch;    // seats for clients; the other snakes are bots
+    int snakesPerMatch;
+    int ticksPerSecond;
+    int threads;            // simulation workers, 0 = one per core
+    uint64_t seed;
+
+    ServerConfig() : endpoint("7777"), matches(1), playersPerMatch(2), snakesPerMatch(4), ticksPerSecond(10), threads(0), seed(0) {}
+};
+
+// Steady clock in ns, as in NetTick::sentAt
+int64_t netClockNs();
+
+// Authoritative host for many MultiSnakeCore matches on one map, all ticked together at a fixed rate.
+//   network thread     accepts clients, gives each a free seat and reads its key presses into
+//                      the seat's SpscQueue; closes a socket once the simulation lets go of it
+//   simulation thread  every tick, one parallelFor over the matches: each drains its queues,
+//                      updates and writes its NetTick into the preallocated send buffer of
+//                      every seat, then sends without blocking
+// The two sides only talk through lock-free queues (key presses and joins/leaves in,
+// releases out), so neither waits on the other. Once the first games have sized their
+// buffers, a tick allocates nothing (WorkStealingPool::parallelFor included).
+// A match starts when all of its seats are taken; snakes without a client, or whose
+// client left, are played by greedyMultiBot. At game over (or when every client has left)
+// the clients are disconnected and the match waits for new players.
+class GameServer
+{
+public:
+    struct ServerStats {
+        int64_t ticks;
+        int64_t droppedTicks;       // ticks the clock skipped because the simulation fell behind
+        LatencyHistogram tickTime;  // resolving and broadcasting every match for one tick
+        int64_t games;
+        int64_t joins;
+        int64_t rejected;           // connections turned away: no free seat
+        int64_t slowClients;        // dropped for falling SEAT_SEND_BUFFER behind
+        int64_t inputs;
+        int64_t droppedInputs;      // a seat's queue was full
+        int64_t messages;
+        int64_t bytes;
+    };
+
+private:
+    struct SeatInput {
+        uint8_t key;
+        uint8_t generation;     // inputs of a previous client on the seat are ignored
+    };
+
+    enum MatchEventType { EVENT_JOIN, EVENT_LEAVE, EVENT_RELEASE, EVENT_MATCH_OVER };
+
+    struct MatchEvent {
+        uint8_t type;
+        uint8_t seat;
+        uint8_t generation;
+        bool lobby;             // EVENT_RELEASE before the match started: the seat can be taken again
+        SocketHandle socket;
+    };
+    // Each direction holds a join and a leave, or a release, per seat plus a match over
+    static_assert(MATCH_EVENT_QUEUE > 2 * MAX_SNAKES + 1, "MATCH_EVENT_QUEUE too small for MAX_SNAKES seats");
+
+    struct Seat {
+        SpscQueue<SeatInput, SEAT_INPUT_QUEUE> inputs;
+        // Network thread
+        SocketHandle netSocket;
+        bool netTaken;
+        uint8_t netGeneration;
+        size_t netPollIndex;    // 0 when not polled
+        // Simulation
+        SocketHandle socket;
+        bool connected;
+        uint8_t generation;
+        std::vector<char> sendBuffer;
+        size_t sendStart;
+        size_t sendEnd;
+    };
+
+    struct Match {
+        int index;
+        MultiSnakeCore game;
+        std::unique_ptr<Seat[]> seats;
+        SpscQueue<MatchEvent, MATCH_EVENT_QUEUE> toSimulation;
+        SpscQueue<MatchEvent, MATCH_EVENT_QUEUE> toNetwork;
+        // Network thread
+        bool netOpen;           // taking players for the next game
+        int netJoined;
+        // Simulation
+        bool running;
+        int joined;
+        int connected;
+        uint64_t nextSeed;
+        int64_t startTick;      // game tick count when the match started
+        std::vector<char> message;
+        std::atomic<int64_t> games, inputs, slowClients, messages, bytes;
+
+        Match(int index, const Map& map, int snakes, int players, uint64_t seed);
+    };
+
+    Map map;
+    ServerConfig config;
+    uint64_t mapHash;
+    std::vector<std::unique_ptr<Match>> matches;
+    WorkStealingPool pool;
+    FixedStepClock clock;
+    SocketHandle listener;
+    std::thread networkThread;
+    std::thread simulationThread;
+    std::atomic<bool> stopping;
+    bool started;
+
+    // Network thread
+    std::vector<std::pair<int, int>> polled;   // (match, seat) of each poller entry; entry 0 is the listener
+    size_t nextMatch;
+    std::atomic<int64_t> joins, rejected, droppedInputs;
+
+    // Simulation thread
+    int64_t ticks;
+    LatencyHistogram tickTime;
+    std::ostream* reportStream;
+    int reportSeconds;
+
+    void serveNetwork();
+    void acceptClients(SocketPoller& poller);
+    void readClient(SocketPoller& poller, size_t index, char* buffer, int size);
+    void stopPolling(SocketPoller& poller, Seat& seat);
+    void handleRelease(SocketPoller& poller, Match& match, const MatchEvent& event);
+    static void pushEvent(SpscQueue<MatchEvent, MATCH_EVENT_QUEUE>& queue, const MatchEvent& event);
+
+    void simulate();
+    void tickMatch(Match& match);
+    void startGame(Match& match);
+    void endGame(Match& match);
+    void releaseSeat(Match& match, int seat);
+    void writeWelcome(Match& match, int seat);
+    void broadcastTick(Match& match);
+    bool queueMessage(Match& match, int seat, const char* data, size_t size);
+    bool flushSeat(Match& match, int seat);
+
+public:
+    GameServer(const Map& map, const ServerConfig& config);
+    ~GameServer();
+
+    // Listens and starts both threads; false (with the reason on cerr) if the endpoint cannot be used
+    bool start();
+    // Stops both threads and disconnects every client
+    void stop();
+
+    // One line of tick times every `seconds` from the simulation thread, and the totals at stop()
+    void setReport(std::ostream* out, int seconds) { reportStream = out; reportSeconds = seconds; }
+
+    // Totals, once stopped
+    ServerStats getStats() const;
+    void printStats(std::ostream& out) const;
+};
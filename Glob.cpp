@@ -2,4 +2,8 @@
 
 
 int windowWidth = 800;
-int windowHeight = 400;
\ No newline at end of file
+int windowHeight = 400;
+
+int mapWidth = DEFAULT_MAP_WIDTH;
+int mapHeight = DEFAULT_MAP_HEIGHT;
+std::string mapFileName = "map.txt";
\ No newline at end of file
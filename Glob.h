@@ -1,10 +1,20 @@
 #pragma once
+#include <string>
 #define WIDTH 600
 #define HEIGHT 400
 
-#define MAP_WIDTH 30;
-#define MAP_HEIGHT 20;
+#define DEFAULT_MAP_WIDTH 30
+#define DEFAULT_MAP_HEIGHT 20
 #define CELL_SIZE 20
 
+// Largest part of the board shown at once; bigger boards scroll with the snake
+#define MAX_VIEW_COLS 60
+#define MAX_VIEW_ROWS 35
+
 extern int windowWidth;
-extern int windowHeight;
\ No newline at end of file
+extern int windowHeight;
+
+// Board size and file, set from the command line (a .smap file brings its own size)
+extern int mapWidth;
+extern int mapHeight;
+extern std::string mapFileName;
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::reset() {
+    buckets.fill(0);
+    total = 0;
+    maximum = 0;
+}
+
+// Bucket 4k + m holds durations in [2^k, 2^(k+1)) whose next two bits are m
+int LatencyHistogram::bucketOf(int64_t ns) {
+    if (ns < 4) return (int)std::max<int64_t>(ns, 0);
+    int msb = 63;
+    while (!((ns >> msb) & 1)) msb--;
+    return msb * 4 + (int)((ns >> (msb - 2)) & 3);
+}
+
+double LatencyHistogram::bucketUpperNs(int bucket) {
+    if (bucket < 4) return bucket + 1;
+    int msb = bucket / 4;
+    return std::ldexp(1.0 + (bucket % 4 + 1) / 4.0, msb);
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    buckets[bucketOf(ns)]++;
+    total += ns;
+    maximum = std::max(maximum, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int b = 0; b < BUCKETS; ++b) buckets[b] += other.buckets[b];
+    total += other.total;
+    maximum = std::max(maximum, other.maximum);
+}
+
+int64_t LatencyHistogram::getCount() const {
+    int64_t count = 0;
+    for (uint64_t c : buckets) count += (int64_t)c;
+    return count;
+}
+
+double LatencyHistogram::meanUs() const {
+    int64_t count = getCount();
+    return count > 0 ? total / 1000.0 / count : 0.0;
+}
+
+double LatencyHistogram::percentileUs(double fraction) const {
+    uint64_t count = (uint64_t)getCount();
+    if (count == 0) return 0.0;
+    uint64_t rank = (uint64_t)std::ceil(fraction * count);
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        if (seen + buckets[b] >= rank) {
+            // Linear within the bucket
+            double lower = bucketLowerNs(b);
+            double ns = lower + (bucketUpperNs(b) - lower) * (rank - seen) / buckets[b];
+            return std::min(ns, (double)maximum) / 1000.0;
+        }
+        seen += buckets[b];
+    }
+    return maximum / 1000.0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Durations in a fixed log-scale histogram: 4 buckets per power of two of
+// nanoseconds, interpolated for percentiles. Recording is a few array writes.
+class LatencyHistogram
+{
+public:
+    static const int BUCKETS = 256;
+
+private:
+    std::array<uint64_t, BUCKETS> buckets;
+    int64_t total;
+    int64_t maximum;
+
+public:
+    LatencyHistogram() { reset(); }
+
+    void record(int64_t ns);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    int64_t getCount() const;
+    double meanUs() const;
+    double percentileUs(double fraction) const;
+    double maxUs() const { return maximum / 1000.0; }
+
+    uint64_t getBucket(int bucket) const { return buckets[bucket]; }
+    static int bucketOf(int64_t ns);
+    static double bucketUpperNs(int bucket);
+    static double bucketLowerNs(int bucket) { return bucket == 0 ? 0.0 : bucketUpperNs(bucket - 1); }
+};
@@ -0,0 +1,186 @@
+#include "LoopbackClients.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+LoopbackClients::LoopbackClients(const std::string& endpoint, int count, uint64_t seed) : endpoint(endpoint), rng(seed), stopping(false) {
+    stats.connections = stats.welcomes = stats.ticks = stats.missedTicks = stats.matches = stats.keys = stats.protocolErrors = 0;
+    clients.resize(count);
+    for (Client& client : clients) {
+        client.socket = INVALID_SOCKET_HANDLE;
+        client.buffer.resize(LOOPBACK_RECEIVE_BUFFER);
+        client.used = 0;
+        client.seat = -1;
+        client.playing = false;
+        client.lastTick = 0;
+        client.lastKey = -1;
+        client.retryAt = 0;
+    }
+}
+
+LoopbackClients::~LoopbackClients() {
+    stop();
+}
+
+void LoopbackClients::start() {
+    stopping = false;
+    thread = std::thread(&LoopbackClients::run, this);
+}
+
+void LoopbackClients::stop() {
+    if (!thread.joinable()) return;
+    stopping = true;
+    thread.join();
+    int64_t now = netClockNs();
+    for (Client& client : clients) disconnect(client, now);
+}
+
+void LoopbackClients::run() {
+    const int POLL_MS = 2;
+    SocketPoller poller;
+    std::vector<int> polledClients;
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int64_t now = netClockNs();
+        poller.clear();
+        polledClients.clear();
+        for (int i = 0; i < (int)clients.size(); ++i) {
+            Client& client = clients[i];
+            if (client.socket == INVALID_SOCKET_HANDLE && now >= client.retryAt) connectClient(client, now);
+            if (client.socket == INVALID_SOCKET_HANDLE) continue;
+            poller.add(client.socket);
+            polledClients.push_back(i);
+        }
+
+        if (poller.size() == 0 || poller.wait(POLL_MS) <= 0) {
+            if (poller.size() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+            continue;
+        }
+        now = netClockNs();
+        for (size_t p = 0; p < poller.size(); ++p) {
+            if (!poller.isReady(p)) continue;
+            Client& client = clients[polledClients[p]];
+            if (!readMessages(client)) disconnect(client, now);
+        }
+    }
+}
+
+void LoopbackClients::connectClient(Client& client, int64_t now) {
+    client.socket = connectTo(endpoint);
+    if (client.socket == INVALID_SOCKET_HANDLE) {
+        client.retryAt = now + LOOPBACK_RETRY_MS * 1000000LL;
+        return;
+    }
+    stats.connections++;
+    client.used = 0;
+    client.seat = -1;
+    client.playing = false;
+    client.lastKey = -1;
+}
+
+void LoopbackClients::disconnect(Client& client, int64_t now) {
+    if (client.socket == INVALID_SOCKET_HANDLE) return;
+    closeSocket(client.socket);
+    client.socket = INVALID_SOCKET_HANDLE;
+    client.retryAt = now + LOOPBACK_RETRY_MS * 1000000LL;
+}
+
+// False once the connection is closed (after a match, or turned away)
+bool LoopbackClients::readMessages(Client& client) {
+    int received = receiveSome(client.socket, client.buffer.data() + client.used, (int)(client.buffer.size() - client.used));
+    if (received < 0) return false;
+    client.used += received;
+
+    size_t offset = 0;
+    while (client.used - offset >= sizeof(NetMessageHeader)) {
+        NetMessageHeader header;
+        memcpy(&header, client.buffer.data() + offset, sizeof(header));
+        if (header.size < sizeof(NetMessageHeader) || header.size > client.buffer.size()) {
+            stats.protocolErrors++;
+            return false;
+        }
+        if (client.used - offset < header.size) break;
+        const char* message = client.buffer.data() + offset;
+        if (header.type == NET_WELCOME && header.size == sizeof(NetWelcome)) {
+            NetWelcome welcome;
+            memcpy(&welcome, message, sizeof(welcome));
+            if (memcmp(welcome.magic, NET_MAGIC, 4) != 0 || welcome.version != NET_VERSION) {
+                stats.protocolErrors++;
+                return false;
+            }
+            client.seat = welcome.seat;
+            client.playing = false;
+            stats.welcomes++;
+        }
+        else if (header.type == NET_TICK && header.size >= sizeof(NetTick)) {
+            handleTick(client, message, header.size);
+        }
+        else {
+            stats.protocolErrors++;
+        }
+        offset += header.size;
+    }
+    memmove(client.buffer.data(), client.buffer.data() + offset, client.used - offset);
+    client.used -= offset;
+    return true;
+}
+
+void LoopbackClients::handleTick(Client& client, const char* message, size_t size) {
+    NetTick tick;
+    memcpy(&tick, message, sizeof(tick));
+    stats.latency.record(netClockNs() - tick.sentAt);
+    stats.ticks++;
+    if (client.playing && tick.tick != client.lastTick + 1) {
+        stats.missedTicks += tick.tick > client.lastTick ? tick.tick - client.lastTick - 1 : 1;
+    }
+    client.playing = true;
+    client.lastTick = tick.tick;
+    if (tick.gameOver) {
+        stats.matches++;
+        return;
+    }
+
+    // Toward the apple along the longer axis; an occasional random turn keeps it from looping
+    if (client.seat < 0 || client.seat >= tick.snakeCount || size < sizeof(NetTick) + (client.seat + 1) * sizeof(NetSnakeState)) return;
+    NetSnakeState state;
+    memcpy(&state, message + sizeof(NetTick) + client.seat * sizeof(NetSnakeState), sizeof(state));
+    if (!(state.flags & NET_SNAKE_ALIVE)) return;
+    int dx = tick.apple[0] - state.headX;
+    int dy = tick.apple[1] - state.headY;
+    int key;
+    if (rng.nextBelow(8) == 0) key = "wasd"[rng.nextBelow(4)];
+    else if (std::abs(dx) >= std::abs(dy)) key = dx < 0 ? 'a' : 'd';
+    else key = dy < 0 ? 'w' : 's';
+    if (key == client.lastKey) return;
+    char byte = (char)key;
+    if (sendSome(client.socket, &byte, 1) == 1) {
+        client.lastKey = key;
+        stats.keys++;
+    }
+}
+
+void LoopbackClients::printStats(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    out << "Clients: " << clients.size() << " clients, " << stats.connections << " connections, " << stats.welcomes << " seats, "
+        << stats.matches << " matches played out, " << stats.keys << " keys sent" << std::endl;
+    out << "  ticks received: " << stats.ticks << ", " << stats.missedTicks << " missed, " << stats.protocolErrors << " protocol errors" << std::endl;
+    out << "  broadcast latency: mean " << stats.latency.meanUs() << " us  p50 " << stats.latency.percentileUs(0.50) << " us  p99 "
+        << stats.latency.percentileUs(0.99) << " us  max " << stats.latency.maxUs() << " us" << std::endl;
+}
+
+bool runServerLoadTest(const Map& map, const ServerConfig& config, int clients, int seconds, std::ostream& out) {
+    GameServer server(map, config);
+    if (!server.start()) return false;
+    out << "Serving " << config.matches << " matches on " << config.endpoint << " to " << clients << " loopback clients for " << seconds << " s" << std::endl;
+
+    LoopbackClients players(config.endpoint, clients, config.seed ^ 0x5eed);
+    players.start();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    players.stop();
+    server.stop();
+
+    server.printStats(out);
+    players.printStats(out);
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GameServer.h"
+#include "GameRng.h"
+#include "Map.h"
+#include "NetSocket.h"
+#include "LatencyHistogram.h"
+
+#define LOOPBACK_RECEIVE_BUFFER 4096
+#define LOOPBACK_RETRY_MS 50        // wait before connecting again after a match or a rejection
+
+// Stand-in players for exercising a GameServer without a window: `count` clients on one
+// thread, each heading for the apple (ignoring walls and bodies) and connecting again after
+// every match. Checks that every tick of a match arrives, in order, and measures how long
+// each NetTick took from the server writing it to the client reading it.
+class LoopbackClients
+{
+public:
+    struct ClientStats {
+        int64_t connections;
+        int64_t welcomes;
+        int64_t ticks;
+        int64_t missedTicks;        // gaps in a match's tick numbers
+        int64_t matches;            // matches seen to the game over tick
+        int64_t keys;
+        int64_t protocolErrors;
+        LatencyHistogram latency;   // NetTick::sentAt to receipt
+    };
+
+private:
+    struct Client {
+        SocketHandle socket;
+        std::vector<char> buffer;
+        size_t used;
+        int seat;
+        bool playing;               // the first tick of the match has arrived
+        uint32_t lastTick;
+        int lastKey;
+        int64_t retryAt;
+    };
+
+    std::string endpoint;
+    std::vector<Client> clients;
+    GameRng rng;
+    std::thread thread;
+    std::atomic<bool> stopping;
+    ClientStats stats;
+
+    void run();
+    void connectClient(Client& client, int64_t now);
+    void disconnect(Client& client, int64_t now);
+    bool readMessages(Client& client);
+    void handleTick(Client& client, const char* message, size_t size);
+
+public:
+    LoopbackClients(const std::string& endpoint, int count, uint64_t seed);
+    ~LoopbackClients();
+
+    void start();
+    void stop();
+
+    // Totals, once stopped
+    const ClientStats& getStats() const { return stats; }
+    void printStats(std::ostream& out) const;
+};
+
+// Runs a server on `config.endpoint` with `clients` loopback clients for `seconds`, then
+// prints both sides' numbers. False if the server could not start.
+bool runServerLoadTest(const Map& map, const ServerConfig& config, int clients, int seconds, std::ostream& out);
@@ -1,56 +1,100 @@
 #pragma once
-#include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
+#include "BinaryMap.h"
+#include "MapRegions.h"
+
+// Longest side of a board: the snake's body keeps its coordinates as int16 (SnakeBody.h)
+#define MAX_BOARD_SIDE 32767
+
+inline bool isValidBoardSize(int rows, int cols) {
+    return rows >= 1 && cols >= 1 && rows <= MAX_BOARD_SIDE && cols <= MAX_BOARD_SIDE;
+}
 
 class Map {
 private:
-    cv::Mat map; // Map matrix
+    int rows;
+    int cols;
+    std::vector<unsigned char> map; // Map matrix, row-major (0 = free, 1 = obstacle)
     std::string mapFile; // Path to the map file
+    unsigned revision; // Bumped on every change to the obstacles, so cached drawings know when to rebuild
 
 public:
     // Constructor
     Map(int rows, int cols, const std::string& mapFile)
-        : mapFile(mapFile) {
-        map = cv::Mat(rows, cols, CV_8UC1, cv::Scalar(0)); // Initialize with free space (0)
+        : rows(rows), cols(cols), map((size_t)rows * cols, 0), mapFile(mapFile), revision(0) { // Initialize with free space (0)
     }
 
 
 
 
-    // Load map from file
+    // Load map from file (text, or binary .smap which also sets the size)
     bool load() {
+        if (isBinaryMapFile(mapFile)) {
+            return loadBinary();
+        }
         std::ifstream file(mapFile);
         if (!file.is_open()) {
             std::cerr << "Map file not found! Creating a new empty map." << std::endl;
             return false;
         }
-        for (int i = 0; i < map.rows; ++i) {
-            for (int j = 0; j < map.cols; ++j) {
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
                 int value;
                 file >> value;
-                map.at<uchar>(i, j) = static_cast<uchar>(value);
+                map[i * cols + j] = static_cast<unsigned char>(value);
             }
         }
         file.close();
+        revision++;
         return true;
     }
 
-    // Save map to file
-    void save() const {
+    // Memory-map a .smap file and expand its obstacle bits into the grid
+    bool loadBinary() {
+        BinaryMapView view;
+        if (!view.open(mapFile)) {
+            std::cerr << "Map file not found! Creating a new empty map." << std::endl;
+            return false;
+        }
+        rows = view.getRows();
+        cols = view.getCols();
+        map.resize((size_t)rows * cols);
+        for (int i = 0; i < rows; ++i) {
+            view.unpackRow(i, &map[(size_t)i * cols]);
+        }
+        revision++;
+        return true;
+    }
+
+    // Save map to file; pockets are reported, a map with no room to play is refused
+    bool save() const {
+        if (!validateMap(*this)) {
+            std::cerr << "Failed to save the map!" << std::endl;
+            return false;
+        }
+        if (isBinaryMapFile(mapFile)) {
+            if (!saveBinaryMap(*this, mapFile)) return false;
+            std::cout << "Map saved to " << mapFile << std::endl;
+            return true;
+        }
         std::ofstream file(mapFile);
         if (!file.is_open()) {
             std::cerr << "Failed to save the map!" << std::endl;
-            return;
+            return false;
         }
-        for (int i = 0; i < map.rows; ++i) {
-            for (int j = 0; j < map.cols; ++j) {
-                file << static_cast<int>(map.at<uchar>(i, j)) << " ";
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                file << static_cast<int>(map[i * cols + j]) << " ";
             }
             file << "\n";
         }
         file.close();
         std::cout << "Map saved to " << mapFile << std::endl;
+        return true;
     }
 
     bool isObstacle(int x, int y) const {
@@ -59,8 +103,8 @@ public:
         int j = x;
 
         // Check bounds to ensure valid access
-        if (i >= 0 && i < map.rows && j >= 0 && j < map.cols) {
-            return map.at<uchar>(i, j) == 1; // Return true if the cell is an obstacle
+        if (i >= 0 && i < rows && j >= 0 && j < cols) {
+            return map[i * cols + j] == 1; // Return true if the cell is an obstacle
         }
 
         return false; // Out of bounds, treat as no obstacle
@@ -70,8 +114,9 @@ public:
         int i = y;
         int j = x;
 
-        if (i >= 0 && i < map.rows && j >= 0 && j < map.cols) {
-            map.at<uchar>(i, j) = 1;
+        if (i >= 0 && i < rows && j >= 0 && j < cols) {
+            if (map[i * cols + j] != 1) revision++;
+            map[i * cols + j] = 1;
         }
     }
 
@@ -79,26 +124,42 @@ public:
         int i = y;
         int j = x;
 
-        if (i >= 0 && i < map.rows && j >= 0 && j < map.cols) {
-            map.at<uchar>(i, j) = 0;
+        if (i >= 0 && i < rows && j >= 0 && j < cols) {
+            if (map[i * cols + j] != 0) revision++;
+            map[i * cols + j] = 0;
         }
     }
 
-    void draw(cv::Mat& frame, cv::Scalar color, int cellSize) {
-        for (int i = 0; i < this->map.rows; ++i) {
-            for (int j = 0; j < this->map.cols; ++j) {
-                if (this->map.at<uchar>(i, j) == 1) { // Obstacle
-                    cv::rectangle(frame,
-                        cv::Point(j * cellSize, i * cellSize),
-                        cv::Point((j + 1) * cellSize, (i + 1) * cellSize),
-                        color, cv::FILLED);
-                }
+    // Bulk edits for the editor: one revision for the whole change
+    void fillRect(int x, int y, int width, int height, unsigned char value) {
+        int lastRow = std::min(y + height, rows);
+        int lastCol = std::min(x + width, cols);
+        for (int i = std::max(y, 0); i < lastRow; ++i) {
+            for (int j = std::max(x, 0); j < lastCol; ++j) {
+                map[i * cols + j] = value;
             }
         }
+        revision++;
+    }
+
+    void setCells(const std::vector<int>& cells, unsigned char value) {
+        for (int cell : cells) {
+            map[cell] = value;
+        }
+        revision++;
+    }
+
+    // Replace every cell (row-major, rows * cols of them)
+    void assignCells(const std::vector<unsigned char>& cells) {
+        map.assign(cells.begin(), cells.end());
+        revision++;
     }
 
     // Getters
-    int getRows() const { return map.rows; }
-    int getCols() const { return map.cols; }
-    const cv::Mat& getMap() const { return map; }
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+    const std::vector<unsigned char>& getMap() const { return map; }
+    const std::string& getMapFile() const { return mapFile; }
+    void setMapFile(const std::string& path) { mapFile = path; }
+    unsigned getRevision() const { return revision; }
 };
@@ -0,0 +1,23 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include "Map.h"
+
+// Draw the obstacles inside `view` (in cells) onto a frame, with the view's top-left cell at the frame origin
+inline void drawMap(const Map& map, cv::Mat& frame, cv::Scalar color, int cellSize, cv::Rect view) {
+    int lastRow = std::min(view.y + view.height, map.getRows());
+    int lastCol = std::min(view.x + view.width, map.getCols());
+    for (int i = std::max(view.y, 0); i < lastRow; ++i) {
+        for (int j = std::max(view.x, 0); j < lastCol; ++j) {
+            if (map.isObstacle(j, i)) { // Obstacle
+                cv::rectangle(frame,
+                    cv::Rect((j - view.x) * cellSize, (i - view.y) * cellSize, cellSize, cellSize),
+                    color, cv::FILLED);
+            }
+        }
+    }
+}
+
+// Draw the obstacles of a map onto a frame
+inline void drawMap(const Map& map, cv::Mat& frame, cv::Scalar color, int cellSize) {
+    drawMap(map, frame, color, cellSize, cv::Rect(0, 0, map.getCols(), map.getRows()));
+}
@@ -0,0 +1,363 @@
+#include "MapEditor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const cv::Scalar FREE_COLOR(255, 255, 255);
+static const cv::Scalar OBSTACLE_COLOR(0, 0, 255);
+static const cv::Scalar OUTSIDE_COLOR(64, 64, 64);      // view area past the edge of the map
+static const cv::Scalar POCKET_COLOR(200, 200, 200);     // free, but walled off from the spawn point
+static const cv::Scalar PREVIEW_COLOR(255, 0, 0);
+static const cv::Scalar SPAWN_COLOR(0, 160, 0);
+static const int ZOOM_LEVELS[] = { 1, 2, 3, 4, 6, 8, 12, 16, 20, 28, 40 };   // pixels per cell
+static const int ZOOM_LEVEL_COUNT = sizeof(ZOOM_LEVELS) / sizeof(ZOOM_LEVELS[0]);
+static const size_t MAX_DIRTY_CELLS = 4096;    // more changed cells than this repaint the whole view
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+MapEditor::MapEditor(Map& map, int cellSize)
+    : map(map), cellSize(cellSize), defaultCellSize(cellSize), origin(0, 0), tool(TOOL_BRUSH),
+    isDrawing(false), isErasing(false), isPanning(false), cursor(-1, -1), redrawAll(true), overlayChanged(true), analyzedRevision(0), analyzed(false) {}
+
+cv::Point MapEditor::cellAt(int x, int y) const {
+    return cv::Point(origin.x + floorDiv(x, cellSize), origin.y + floorDiv(y, cellSize));
+}
+
+// Every cell on the line between two mouse positions (Bresenham), so fast strokes stay connected
+void MapEditor::addStrokeSegment(cv::Point from, cv::Point to, unsigned char value) {
+    int dx = std::abs(to.x - from.x), sx = from.x < to.x ? 1 : -1;
+    int dy = -std::abs(to.y - from.y), sy = from.y < to.y ? 1 : -1;
+    int error = dx + dy;
+    cv::Point p = from;
+    while (true) {
+        if (p.x >= 0 && p.x < map.getCols() && p.y >= 0 && p.y < map.getRows()) {
+            CellEdit edit = { p.y * map.getCols() + p.x, value };
+            pending.push_back(edit);
+        }
+        if (p.x == to.x && p.y == to.y) break;
+        int twice = 2 * error;
+        if (twice >= dy) { error += dy; p.x += sx; }
+        if (twice <= dx) { error += dx; p.y += sy; }
+    }
+}
+
+// The strokes since the last frame, in one pass over the map
+void MapEditor::applyEdits() {
+    const std::vector<unsigned char>& cells = map.getMap();
+    for (const CellEdit& edit : pending) {
+        if (cells[edit.cell] == edit.value) continue;
+        int x = edit.cell % map.getCols(), y = edit.cell / map.getCols();
+        if (edit.value) map.setObstacle(x, y);
+        else map.unsetObstacle(x, y);
+        if (!redrawAll) dirtyCells.push_back(edit.cell);
+    }
+    pending.clear();
+    if (dirtyCells.size() > MAX_DIRTY_CELLS) {
+        dirtyCells.clear();
+        redrawAll = true;
+    }
+}
+
+// Label the regions again if the map changed; free cells that were walled off or opened up
+// are repainted. Without pockets before or after, only the edited cells changed colour.
+void MapEditor::analyzeRegions() {
+    if (analyzed && map.getRevision() == analyzedRevision) return;
+    bool pocketsBefore = analyzed && regions.getUnreachableCount() > 0;
+    int spawnBefore = regions.getSpawnCell();
+    if (pocketsBefore) reachableBefore = regions.getReachableMask();
+    regions.analyze(map);
+    analyzed = true;
+    analyzedRevision = map.getRevision();
+    if (regions.getSpawnCell() != spawnBefore) overlayChanged = true;
+    if (redrawAll || (!pocketsBefore && regions.getUnreachableCount() == 0)) return;
+
+    const std::vector<unsigned char>& reachable = regions.getReachableMask();
+    if (!pocketsBefore) reachableBefore.assign(reachable.size(), 0);
+    if (reachableBefore.size() != reachable.size()) {
+        dirtyCells.clear();
+        dirtyRects.clear();
+        redrawAll = true;
+        return;
+    }
+    // The changed cells one by one, or their bounding box when there are many
+    int cols = map.getCols();
+    int minX = cols, maxX = -1, minY = map.getRows(), maxY = -1;
+    size_t changed = 0, firstNew = dirtyCells.size();
+    for (size_t cell = 0; cell < reachable.size(); ++cell) {
+        if (reachable[cell] == reachableBefore[cell]) continue;
+        int x = (int)(cell % cols), y = (int)(cell / cols);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        if (++changed <= MAX_DIRTY_CELLS) dirtyCells.push_back((int)cell);
+    }
+    if (changed > MAX_DIRTY_CELLS) {
+        dirtyCells.resize(firstNew);
+        dirtyRects.push_back(cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1));
+    }
+}
+
+void MapEditor::applyRect(cv::Point a, cv::Point b, unsigned char value) {
+    cv::Rect cells(std::min(a.x, b.x), std::min(a.y, b.y), std::abs(a.x - b.x) + 1, std::abs(a.y - b.y) + 1);
+    cells = cells & cv::Rect(0, 0, map.getCols(), map.getRows());
+    if (cells.empty()) return;
+    applyEdits(); // keep the order of the edits
+    map.fillRect(cells.x, cells.y, cells.width, cells.height, value);
+    dirtyRects.push_back(cells);
+}
+
+// Turns the 4-connected region of cells like the start cell into `value`
+void MapEditor::floodFill(cv::Point start, unsigned char value) {
+    int rows = map.getRows(), cols = map.getCols();
+    if (start.x < 0 || start.x >= cols || start.y < 0 || start.y >= rows) return;
+    applyEdits();
+    const std::vector<unsigned char>& cells = map.getMap();
+    unsigned char from = cells[start.y * cols + start.x];
+    if (from == value) return;
+
+    // Scanline fill: each run of matching cells is claimed once, then the rows above and below are searched
+    std::vector<unsigned char> seen(cells.size(), 0);
+    std::vector<int> filled;
+    std::vector<int> stack(1, start.y * cols + start.x);
+    int minX = start.x, maxX = start.x, minY = start.y, maxY = start.y;
+    while (!stack.empty()) {
+        int cell = stack.back();
+        stack.pop_back();
+        if (seen[cell]) continue;
+        int y = cell / cols;
+        int left = cell % cols, right = left;
+        while (left > 0 && !seen[y * cols + left - 1] && cells[y * cols + left - 1] == from) left--;
+        while (right < cols - 1 && !seen[y * cols + right + 1] && cells[y * cols + right + 1] == from) right++;
+        for (int x = left; x <= right; ++x) {
+            seen[y * cols + x] = 1;
+            filled.push_back(y * cols + x);
+        }
+        minX = std::min(minX, left);
+        maxX = std::max(maxX, right);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        for (int ny = y - 1; ny <= y + 1; ny += 2) {
+            if (ny < 0 || ny >= rows) continue;
+            for (int x = left; x <= right; ++x) {
+                int next = ny * cols + x;
+                // One seed per run of the neighbouring row
+                if (!seen[next] && cells[next] == from && (x == left || cells[next - 1] != from || seen[next - 1])) {
+                    stack.push_back(next);
+                }
+            }
+        }
+    }
+    map.setCells(filled, value);
+    dirtyRects.push_back(cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1));
+}
+
+void MapEditor::clampOrigin() {
+    int viewCols = std::max(viewSize.width / cellSize, 1);
+    int viewRows = std::max(viewSize.height / cellSize, 1);
+    origin.x = std::max(0, std::min(origin.x, map.getCols() - viewCols));
+    origin.y = std::max(0, std::min(origin.y, map.getRows() - viewRows));
+}
+
+// Keeps the cell under `pixel` in place
+void MapEditor::setZoom(int newCellSize, cv::Point pixel) {
+    if (newCellSize == cellSize) return;
+    cv::Point cell = cellAt(pixel.x, pixel.y);
+    cellSize = newCellSize;
+    origin = cv::Point(cell.x - pixel.x / cellSize, cell.y - pixel.y / cellSize);
+    clampOrigin();
+    redrawAll = true;
+    overlayChanged = true;
+}
+
+void MapEditor::panBy(int dx, int dy) {
+    cv::Point before = origin;
+    origin += cv::Point(dx, dy);
+    clampOrigin();
+    if (origin != before) {
+        redrawAll = true;
+        overlayChanged = true;
+    }
+}
+
+void MapEditor::handleMouse(int event, int x, int y, int flags) {
+    cv::Point cell = cellAt(x, y);
+    if (cell != cursor) {
+        cursor = cell;
+        overlayChanged = true;
+    }
+
+    if ((event == cv::EVENT_LBUTTONDOWN || event == cv::EVENT_RBUTTONDOWN) && y < viewSize.height) {
+        unsigned char value = event == cv::EVENT_LBUTTONDOWN ? 1 : 0;
+        isDrawing = value == 1;   // Start drawing
+        isErasing = value == 0;   // Start erasing
+        lastCell = cell;
+        anchor = cell;
+        if (tool == TOOL_BRUSH) addStrokeSegment(cell, cell, value);
+        else if (tool == TOOL_FILL) floodFill(cell, value);
+    }
+    else if (event == cv::EVENT_MOUSEMOVE) {
+        if (isPanning) {
+            cv::Point before = origin;
+            origin = panOrigin - cv::Point(floorDiv(x - panStart.x, cellSize), floorDiv(y - panStart.y, cellSize));
+            clampOrigin();
+            if (origin != before) redrawAll = true;
+        }
+        else if (tool == TOOL_BRUSH && (isDrawing || isErasing) && cell != lastCell) {
+            addStrokeSegment(lastCell, cell, isDrawing ? 1 : 0);
+            lastCell = cell;
+        }
+    }
+    else if (event == cv::EVENT_LBUTTONUP || event == cv::EVENT_RBUTTONUP) {
+        if (tool == TOOL_RECT && (isDrawing || isErasing)) {
+            applyRect(anchor, cell, isDrawing ? 1 : 0);
+            overlayChanged = true;
+        }
+        isDrawing = false; // Stop drawing
+        isErasing = false; // Stop erasing
+    }
+    else if (event == cv::EVENT_MBUTTONDOWN) {
+        isPanning = true;
+        panStart = cv::Point(x, y);
+        panOrigin = origin;
+    }
+    else if (event == cv::EVENT_MBUTTONUP) {
+        isPanning = false;
+    }
+    else if (event == cv::EVENT_MOUSEWHEEL) {
+        int level = (int)(std::find(ZOOM_LEVELS, ZOOM_LEVELS + ZOOM_LEVEL_COUNT, cellSize) - ZOOM_LEVELS);
+        level += cv::getMouseWheelDelta(flags) > 0 ? 1 : -1;
+        if (level >= 0 && level < ZOOM_LEVEL_COUNT) setZoom(ZOOM_LEVELS[level], cv::Point(x, y));
+    }
+}
+
+bool MapEditor::handleKey(int key) {
+    int level = (int)(std::find(ZOOM_LEVELS, ZOOM_LEVELS + ZOOM_LEVEL_COUNT, cellSize) - ZOOM_LEVELS);
+    cv::Point center(viewSize.width / 2, viewSize.height / 2);
+    int stepCols = std::max(viewSize.width / cellSize / 4, 1);
+    int stepRows = std::max(viewSize.height / cellSize / 4, 1);
+    switch (key) {
+    case 'b': tool = TOOL_BRUSH; break;
+    case 'r': tool = TOOL_RECT; break;
+    case 'f': tool = TOOL_FILL; break;
+    case '+':
+    case '=': if (level + 1 < ZOOM_LEVEL_COUNT) setZoom(ZOOM_LEVELS[level + 1], center); break;
+    case '-': if (level > 0) setZoom(ZOOM_LEVELS[std::min(level, ZOOM_LEVEL_COUNT) - 1], center); break;
+    case 'i': panBy(0, -stepRows); break;
+    case 'k': panBy(0, stepRows); break;
+    case 'j': panBy(-stepCols, 0); break;
+    case 'l': panBy(stepCols, 0); break;
+    default: return false;
+    }
+    overlayChanged = true;
+    return true;
+}
+
+cv::Rect MapEditor::visibleCells() const {
+    cv::Rect cells(origin.x, origin.y, (viewSize.width + cellSize - 1) / cellSize, (viewSize.height + cellSize - 1) / cellSize);
+    return cells & cv::Rect(0, 0, map.getCols(), map.getRows());
+}
+
+// Paints map cells into the view: one pixel row per map row is built, then repeated for the cell height
+void MapEditor::paintCells(cv::Rect cells) {
+    if (cells.empty()) return;
+    const std::vector<unsigned char>& grid = map.getMap();
+    int cols = map.getCols();
+    int x0 = (cells.x - origin.x) * cellSize;
+    int width = std::min(cells.width * cellSize, viewSize.width - x0);
+    const unsigned char freeColor[3] = { (unsigned char)FREE_COLOR[0], (unsigned char)FREE_COLOR[1], (unsigned char)FREE_COLOR[2] };
+    const unsigned char obstacleColor[3] = { (unsigned char)OBSTACLE_COLOR[0], (unsigned char)OBSTACLE_COLOR[1], (unsigned char)OBSTACLE_COLOR[2] };
+    const unsigned char pocketColor[3] = { (unsigned char)POCKET_COLOR[0], (unsigned char)POCKET_COLOR[1], (unsigned char)POCKET_COLOR[2] };
+    std::vector<unsigned char> line((size_t)width * 3);
+
+    for (int row = cells.y; row < cells.y + cells.height; ++row) {
+        for (int px = 0; px < width; ++px) {
+            size_t cell = (size_t)row * cols + cells.x + px / cellSize;
+            const unsigned char* color = grid[cell] == 1 ? obstacleColor : (regions.isReachable((int)cell) ? freeColor : pocketColor);
+            memcpy(&line[(size_t)px * 3], color, 3);
+        }
+        int y0 = (row - origin.y) * cellSize;
+        int y1 = std::min(y0 + cellSize, viewSize.height);
+        for (int y = y0; y < y1; ++y) {
+            memcpy(view.ptr(y) + (size_t)x0 * 3, line.data(), line.size());
+        }
+    }
+}
+
+void MapEditor::drawOverlay(cv::Mat& canvas) const {
+    int spawn = regions.getSpawnCell();
+    if (spawn >= 0) {
+        cv::Point cell(spawn % map.getCols() - origin.x, spawn / map.getCols() - origin.y);
+        cv::rectangle(canvas, cv::Rect(cell.x * cellSize, cell.y * cellSize, cellSize, cellSize), SPAWN_COLOR, cv::FILLED);
+    }
+
+    if (tool == TOOL_RECT && (isDrawing || isErasing)) {
+        cv::Point a(std::min(anchor.x, cursor.x) - origin.x, std::min(anchor.y, cursor.y) - origin.y);
+        cv::Point b(std::max(anchor.x, cursor.x) - origin.x + 1, std::max(anchor.y, cursor.y) - origin.y + 1);
+        cv::rectangle(canvas, cv::Rect(a.x * cellSize, a.y * cellSize, (b.x - a.x) * cellSize, (b.y - a.y) * cellSize), PREVIEW_COLOR, 1);
+    }
+
+    static const char* toolNames[] = { "Brush", "Rectangle", "Fill" };
+    std::string status = std::string(toolNames[tool]) + "  " + std::to_string(cellSize) + " px/cell  " +
+        std::to_string(map.getCols()) + "x" + std::to_string(map.getRows());
+    if (regions.getUnreachableCount() > 0) {
+        status += "  " + std::to_string(regions.getUnreachableCount()) + " unreachable";
+    }
+    if (cursor.x >= 0 && cursor.x < map.getCols() && cursor.y >= 0 && cursor.y < map.getRows()) {
+        status += "  (" + std::to_string(cursor.x) + ", " + std::to_string(cursor.y) + ")";
+    }
+    cv::rectangle(canvas, cv::Rect(0, viewSize.height, canvas.cols, canvas.rows - viewSize.height), cv::Scalar(0, 0, 0), cv::FILLED);
+    putText(canvas, status, cv::Point(5, canvas.rows - 5), cv::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(255, 255, 255), 1);
+}
+
+bool MapEditor::render(cv::Mat& canvas) {
+    applyEdits();
+    analyzeRegions();
+
+    // The status line takes the bottom rows of the canvas; the view gets the rest
+    cv::Size canvasView(canvas.cols, std::max(canvas.rows - MAP_EDITOR_STATUS_HEIGHT, 1));
+    if (view.empty() || canvasView != viewSize) {
+        bool first = view.empty();
+        viewSize = canvasView;
+        view.create(viewSize.height, viewSize.width, CV_8UC3);
+        if (first) {
+            // Start with the whole map in view if a zoom level down to 1 px allows it
+            int level = ZOOM_LEVEL_COUNT - 1;
+            while (level > 0 && (ZOOM_LEVELS[level] > defaultCellSize ||
+                map.getCols() * ZOOM_LEVELS[level] > viewSize.width || map.getRows() * ZOOM_LEVELS[level] > viewSize.height)) {
+                level--;
+            }
+            cellSize = ZOOM_LEVELS[level];
+        }
+        clampOrigin();
+        redrawAll = true;
+    }
+
+    if (!redrawAll && dirtyCells.empty() && dirtyRects.empty() && !overlayChanged) {
+        return false; // The window already shows all of it
+    }
+
+    cv::Rect visible = visibleCells();
+    if (redrawAll) {
+        view.setTo(OUTSIDE_COLOR);
+        paintCells(visible);
+    }
+    else {
+        for (const cv::Rect& cells : dirtyRects) {
+            paintCells(cells & visible);
+        }
+        for (int cell : dirtyCells) {
+            paintCells(cv::Rect(cell % map.getCols(), cell / map.getCols(), 1, 1) & visible);
+        }
+    }
+    dirtyCells.clear();
+    dirtyRects.clear();
+    redrawAll = false;
+    overlayChanged = false;
+
+    view.copyTo(canvas(cv::Rect(0, 0, viewSize.width, viewSize.height)));
+    drawOverlay(canvas);
+    return true;
+}
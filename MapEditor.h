@@ -1,64 +1,85 @@
 #pragma once
-#pragma once
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
 #include "Map.h"
+#include "MapRegions.h"
+
+#define MAP_EDITOR_STATUS_HEIGHT 18    // pixels below the view for the status line
 
+enum EditorTool { TOOL_BRUSH, TOOL_RECT, TOOL_FILL };
+
+// Obstacle editor for maps of any size.
+// Mouse events only record edits: brush strokes are interpolated cell by cell
+// between events (so fast strokes leave no gaps) and everything is applied to
+// the map in one batch when the next frame is rendered. The view (a window of
+// the map at the current zoom) is kept as an image, and only the cells that
+// changed are painted into it again; zooming or panning repaints the view.
+// The regions of the map are labelled again after every change: free cells the
+// snake cannot reach are shaded, and the spawn cell is marked.
+//   left button: draw, right button: erase (brush, rectangle, or flood fill)
+//   middle drag or i/j/k/l: pan, mouse wheel or +/-: zoom
+//   b / r / f: brush, rectangle, fill tool
 class MapEditor {
 private:
-    Map& map;             // Reference to the map being edited
-    int cellSize;         // Size of each grid cell in pixels
-    bool isDrawing;       // Tracks left mouse button state
-    bool isErasing;       // Tracks right mouse button state
+    struct CellEdit {
+        int cell;               // row-major index
+        unsigned char value;    // 1 = obstacle, 0 = free
+    };
 
-public:
-    // Constructor
-    MapEditor(Map& map, int cellSize)
-        : map(map), cellSize(cellSize), isDrawing(false), isErasing(false) {}
+    Map& map;
+    int cellSize;               // pixels per cell at the current zoom
+    int defaultCellSize;
+    cv::Point origin;           // map cell at the top-left of the view
+    cv::Size viewSize;          // view in pixels, set by render()
+    EditorTool tool;
 
-    // Mouse callback for editing the map
-    void handleMouse(int event, int x, int y) {
-        // Calculate cell indices from pixel coordinates
-        int col = x / cellSize;
-        int row = y / cellSize;
+    bool isDrawing;             // Tracks left mouse button state
+    bool isErasing;             // Tracks right mouse button state
+    bool isPanning;             // Tracks middle mouse button state
+    cv::Point lastCell;         // brush: cell of the previous mouse event
+    cv::Point anchor;           // rectangle: cell where the drag started
+    cv::Point panStart;         // pixel where the pan started
+    cv::Point panOrigin;
+    cv::Point cursor;           // cell under the mouse
+
+    std::vector<CellEdit> pending;      // brush cells not applied to the map yet
+    std::vector<int> dirtyCells;        // changed cells not painted into the view yet
+    std::vector<cv::Rect> dirtyRects;   // changed areas (rectangles, fills), in cells
+    bool redrawAll;
+    bool overlayChanged;                // status line or rectangle preview must be drawn again
+    cv::Mat view;                       // painted cells of the view, without the overlay
+    MapRegions regions;
+    std::vector<unsigned char> reachableBefore;     // mask of the previous analysis, to find cells to repaint
+    unsigned analyzedRevision;
+    bool analyzed;
+
+    cv::Point cellAt(int x, int y) const;
+    void addStrokeSegment(cv::Point from, cv::Point to, unsigned char value);
+    void applyEdits();
+    void analyzeRegions();
+    void applyRect(cv::Point a, cv::Point b, unsigned char value);
+    void floodFill(cv::Point start, unsigned char value);
+    void setZoom(int newCellSize, cv::Point pixel);
+    void panBy(int dx, int dy);
+    void clampOrigin();
+    cv::Rect visibleCells() const;
+    void paintCells(cv::Rect cells);
+    void drawOverlay(cv::Mat& canvas) const;
+
+public:
+    MapEditor(Map& map, int cellSize);
 
-        if (event == cv::EVENT_LBUTTONDOWN) {
-            isDrawing = true;  // Start drawing
-            map.setObstacle(col, row);
-        }
-        else if (event == cv::EVENT_RBUTTONDOWN) {
-            isErasing = true;  // Start erasing
-            map.unsetObstacle(col, row);
-        }
-        else if (event == cv::EVENT_MOUSEMOVE) {
-            if (isDrawing) {
-                map.setObstacle(col, row);
-            }
-            else if (isErasing) {
-                map.unsetObstacle(col, row);
-            }
-        }
-        else if (event == cv::EVENT_LBUTTONUP) {
-            isDrawing = false; // Stop drawing
-        }
-        else if (event == cv::EVENT_RBUTTONUP) {
-            isErasing = false; // Stop erasing
-        }
-    }
+    // Mouse callback for editing the map (flags carry the wheel delta)
+    void handleMouse(int event, int x, int y, int flags = 0);
+    // Tool, zoom and pan keys; false if the key is not the editor's
+    bool handleKey(int key);
 
-    // Render the map onto a canvas
-    void render(cv::Mat& canvas) const {
-        canvas.setTo(cv::Scalar(255, 255, 255)); // Clear to white background
-        const cv::Mat& mapMatrix = map.getMap();
+    // Apply the pending edits and bring the canvas up to date; false when nothing on it changed.
+    // The bottom MAP_EDITOR_STATUS_HEIGHT rows of the canvas hold the status line, not map cells.
+    bool render(cv::Mat& canvas);
 
-        for (int i = 0; i < mapMatrix.rows; ++i) {
-            for (int j = 0; j < mapMatrix.cols; ++j) {
-                if (mapMatrix.at<uchar>(i, j) == 1) { // Obstacle
-                    cv::rectangle(canvas,
-                        cv::Point(j * cellSize, i * cellSize),
-                        cv::Point((j + 1) * cellSize, (i + 1) * cellSize),
-                        cv::Scalar(0, 0, 255), cv::FILLED);
-                }
-            }
-        }
-    }
+    EditorTool getTool() const { return tool; }
+    int getCellSize() const { return cellSize; }
+    cv::Point getOrigin() const { return origin; }
 };
@@ -0,0 +1,317 @@
+#include "MapGenerator.h"
+#include "MapRegions.h"
+#include "GameRng.h"
+#include "ScoreStore.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const char* SYMMETRY_NAMES[] = { "none", "x", "y", "quad", "rotate" };
+
+const char* mapSymmetryName(MapSymmetry symmetry) {
+    return SYMMETRY_NAMES[symmetry];
+}
+
+bool parseMapGenParam(const std::string& text, MapGenParams& params) {
+    size_t equals = text.find('=');
+    if (equals == std::string::npos) return false;
+    std::string key = text.substr(0, equals);
+    std::string value = text.substr(equals + 1);
+
+    if (key == "size") {
+        return sscanf(value.c_str(), "%dx%d", &params.cols, &params.rows) == 2 && isValidBoardSize(params.rows, params.cols);
+    }
+    if (key == "density") {
+        params.density = atof(value.c_str());
+        return params.density >= 0.0 && params.density < 1.0;
+    }
+    if (key == "corridor") {
+        params.corridorWidth = atoi(value.c_str());
+        return params.corridorWidth >= 1;
+    }
+    if (key == "rooms") {
+        params.roomCount = atoi(value.c_str());
+        return params.roomCount >= 0;
+    }
+    if (key == "symmetry") {
+        for (int s = SYMMETRY_NONE; s <= SYMMETRY_ROTATE; ++s) {
+            if (value == SYMMETRY_NAMES[s]) {
+                params.symmetry = (MapSymmetry)s;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Rectangle of cells
+struct CellRect {
+    int x, y, width, height;
+};
+
+// Grid under construction, row-major, 1 = obstacle
+struct Layout {
+    int rows;
+    int cols;
+    MapSymmetry symmetry;
+    std::vector<unsigned char> cells;
+
+    Layout(int rows, int cols, MapSymmetry symmetry, unsigned char value) : rows(rows), cols(cols), symmetry(symmetry), cells((size_t)rows * cols, value) {}
+
+    // The rectangle and its copies under the symmetry, without duplicates; returns how many
+    int images(CellRect r, CellRect out[4]) const {
+        CellRect mirrorX = { cols - r.x - r.width, r.y, r.width, r.height };
+        CellRect mirrorY = { r.x, rows - r.y - r.height, r.width, r.height };
+        CellRect rotated = { cols - r.x - r.width, rows - r.y - r.height, r.width, r.height };
+        int count = 0;
+        out[count++] = r;
+        if (symmetry == SYMMETRY_MIRROR_X || symmetry == SYMMETRY_QUAD) out[count++] = mirrorX;
+        if (symmetry == SYMMETRY_MIRROR_Y || symmetry == SYMMETRY_QUAD) out[count++] = mirrorY;
+        if (symmetry == SYMMETRY_ROTATE || symmetry == SYMMETRY_QUAD) out[count++] = rotated;
+        int unique = 0;
+        for (int i = 0; i < count; ++i) {
+            bool seen = false;
+            for (int j = 0; j < unique; ++j) {
+                seen = seen || (out[j].x == out[i].x && out[j].y == out[i].y);
+            }
+            if (!seen) out[unique++] = out[i];
+        }
+        return unique;
+    }
+
+    void fill(CellRect r, unsigned char value) {
+        int x0 = std::max(r.x, 0), x1 = std::min(r.x + r.width, cols);
+        int y0 = std::max(r.y, 0), y1 = std::min(r.y + r.height, rows);
+        for (int i = y0; i < y1; ++i) {
+            for (int j = x0; j < x1; ++j) cells[(size_t)i * cols + j] = value;
+        }
+    }
+
+    // Fill the rectangle and its symmetric copies
+    void fillAll(CellRect r, unsigned char value) {
+        CellRect copies[4];
+        int count = images(r, copies);
+        for (int i = 0; i < count; ++i) fill(copies[i], value);
+    }
+
+    // No obstacle in the rectangle (clipped to the board)
+    bool isFree(CellRect r) const {
+        int x0 = std::max(r.x, 0), x1 = std::min(r.x + r.width, cols);
+        int y0 = std::max(r.y, 0), y1 = std::min(r.y + r.height, rows);
+        for (int i = y0; i < y1; ++i) {
+            for (int j = x0; j < x1; ++j) {
+                if (cells[(size_t)i * cols + j] == 1) return false;
+            }
+        }
+        return true;
+    }
+
+    size_t countFree() const { return (size_t)std::count(cells.begin(), cells.end(), 0); }
+};
+
+// Rooms carved out of rock; each one is joined to the previous one by an L-shaped corridor,
+// so they are all connected. The first room sits on the board center, where the snake starts;
+// symmetric copies of the others connect through it.
+static void carveRooms(Layout& layout, const MapGenParams& params, GameRng& rng) {
+    int width = params.corridorWidth;
+    // Rooms sized as if they were laid out in a square grid over the board
+    int perSide = 1;
+    while (perSide * perSide < params.roomCount) perSide++;
+    int maxWidth = std::max(layout.cols / perSide, 3), maxHeight = std::max(layout.rows / perSide, 3);
+    int minWidth = std::max(std::max(3, width + 2), maxWidth / 2), minHeight = std::max(std::max(3, width + 2), maxHeight / 2);
+    maxWidth = std::max(maxWidth, minWidth);
+    maxHeight = std::max(maxHeight, minHeight);
+    int previousX = 0, previousY = 0;
+
+    for (int k = 0; k < params.roomCount; ++k) {
+        int w = std::min(minWidth + (int)rng.nextBelow(maxWidth - minWidth + 1), layout.cols);
+        int h = std::min(minHeight + (int)rng.nextBelow(maxHeight - minHeight + 1), layout.rows);
+        int x, y;
+        if (k == 0) {
+            x = layout.cols / 2 - w / 2;
+            y = layout.rows / 2 - h / 2;
+        }
+        else {
+            x = (int)rng.nextBelow(layout.cols - w + 1);
+            y = (int)rng.nextBelow(layout.rows - h + 1);
+        }
+        CellRect room = { x, y, w, h };
+        layout.fillAll(room, 0);
+
+        int centerX = x + w / 2, centerY = y + h / 2;
+        if (k > 0) {
+            bool acrossFirst = rng.nextBelow(2) == 0;
+            int turnX = acrossFirst ? centerX : previousX, turnY = acrossFirst ? previousY : centerY;
+            CellRect across = { std::min(previousX, centerX), turnY, std::abs(centerX - previousX) + width, width };
+            CellRect down = { turnX, std::min(previousY, centerY), width, std::abs(centerY - previousY) + width };
+            layout.fillAll(across, 0);
+            layout.fillAll(down, 0);
+        }
+        previousX = centerX;
+        previousY = centerY;
+    }
+}
+
+// Straight wall segments over the open floor until `density` of it is covered. A segment (with
+// its symmetric copies) is only placed with corridorWidth free cells all around it, or flush
+// against the board edge, and away from the board center, so the walls never pinch a passage
+// below the corridor width.
+static void placeWalls(Layout& layout, const MapGenParams& params, GameRng& rng) {
+    int gap = params.corridorWidth;
+    int maxLength = std::max(2, std::min(layout.rows, layout.cols) / 3);
+    int64_t target = (int64_t)(params.density * (double)layout.countFree());
+    int64_t attempts = 200 + 20 * (target / (1 + maxLength / 2) + 1);
+    int centerX = layout.cols / 2, centerY = layout.rows / 2;
+
+    for (int64_t placed = 0; placed < target && attempts > 0; --attempts) {
+        int length = 2 + (int)rng.nextBelow(maxLength - 1);
+        bool across = rng.nextBelow(2) == 0;
+        int w = across ? length : 1, h = across ? 1 : length;
+        if (w > layout.cols || h > layout.rows) continue;
+        CellRect wall = { (int)rng.nextBelow(layout.cols - w + 1), (int)rng.nextBelow(layout.rows - h + 1), w, h };
+
+        CellRect copies[4];
+        int count = layout.images(wall, copies);
+        bool fits = true;
+        for (int i = 0; i < count && fits; ++i) {
+            const CellRect& r = copies[i];
+            int left = r.x, right = layout.cols - r.x - r.width, top = r.y, bottom = layout.rows - r.y - r.height;
+            CellRect around = { r.x - gap, r.y - gap, r.width + 2 * gap, r.height + 2 * gap };
+            fits = !((left > 0 && left < gap) || (right > 0 && right < gap) || (top > 0 && top < gap) || (bottom > 0 && bottom < gap)) &&
+                !(centerX >= around.x && centerX < around.x + around.width && centerY >= around.y && centerY < around.y + around.height) &&
+                layout.isFree(around);
+            // Copies that touch across the symmetry axis are fine; closer than the gap they pinch a passage
+            for (int j = 0; j < i && fits; ++j) {
+                int dx = std::max(copies[j].x - (r.x + r.width), r.x - (copies[j].x + copies[j].width));
+                int dy = std::max(copies[j].y - (r.y + r.height), r.y - (copies[j].y + copies[j].height));
+                fits = (dx <= 0 && dy <= 0) || std::max(dx, dy) >= gap;
+            }
+        }
+        if (!fits) continue;
+
+        for (int i = 0; i < count; ++i) layout.fill(copies[i], 1);
+        placed += (int64_t)length * count;
+    }
+}
+
+bool generateMap(const MapGenParams& params, uint64_t seed, Map& map) {
+    GameRng rng(seed);
+    int rows = params.rows, cols = params.cols;
+    int center = (rows / 2) * cols + cols / 2;
+    MapRegions regions;
+
+    for (int attempt = 0; attempt < MAX_GENERATE_ATTEMPTS; ++attempt) {
+        Layout layout(rows, cols, params.symmetry, params.roomCount > 0 ? 1 : 0);
+        if (params.roomCount > 0) carveRooms(layout, params, rng);
+        placeWalls(layout, params, rng);
+        layout.cells[center] = 0;
+
+        map = Map(rows, cols, map.getMapFile());
+        map.assignCells(layout.cells);
+        regions.analyze(map);
+        if (regions.getSpawnCell() != center || regions.getReachableCount() < MIN_PLAYABLE_CELLS) {
+            continue; // the center got walled in: try another layout from the same generator
+        }
+        if (regions.getUnreachableCount() > 0) {
+            for (size_t cell = 0; cell < layout.cells.size(); ++cell) {
+                if (layout.cells[cell] == 0 && !regions.isReachable((int)cell)) layout.cells[cell] = 1;
+            }
+            map.assignCells(layout.cells);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool makeDirectory(const std::string& path) {
+#ifdef _WIN32
+    return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+int generateMapCorpus(const std::string& directory, int count, uint64_t baseSeed, const MapGenParams& params, int threads, std::ostream& out) {
+    if (!makeDirectory(directory)) {
+        std::cerr << "Cannot create " << directory << std::endl;
+        return 0;
+    }
+
+    struct Entry {
+        std::string file;
+        uint64_t seed;
+        size_t freeCells;
+        bool written;
+    };
+    std::vector<Entry> entries(count > 0 ? count : 0);
+
+    auto start = std::chrono::steady_clock::now();
+    int threadCount;
+    {
+        WorkStealingPool pool(threads > 0 ? (size_t)threads : 0);
+        threadCount = (int)pool.size();
+        pool.parallelFor(entries.size(), [&](size_t i) {
+            Entry& entry = entries[i]; // each task owns its slot
+            char name[32];
+            snprintf(name, sizeof(name), "map_%05u%s", (unsigned)i, SMAP_EXTENSION);
+            entry.file = name;
+            entry.seed = baseSeed + (uint64_t)i;
+            Map map(0, 0, directory + "/" + name);
+            entry.written = generateMap(params, entry.seed, map) && saveBinaryMap(map, map.getMapFile());
+            entry.freeCells = entry.written ? (size_t)std::count(map.getMap().begin(), map.getMap().end(), 0) : 0;
+        });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The index lists the maps in seed order, whatever order the workers finished in
+    std::ostringstream index;
+    index << "# size=" << params.cols << "x" << params.rows << " density=" << params.density
+        << " corridor=" << params.corridorWidth << " rooms=" << params.roomCount
+        << " symmetry=" << mapSymmetryName(params.symmetry) << "\n";
+    index << "# file seed free_cells\n";
+    int written = 0;
+    for (const Entry& entry : entries) {
+        if (!entry.written) {
+            out << "Seed " << entry.seed << ": no playable layout" << std::endl;
+            continue;
+        }
+        index << entry.file << " " << entry.seed << " " << entry.freeCells << "\n";
+        written++;
+    }
+    if (!writeFileAtomically(directory + "/" + CORPUS_INDEX_FILE, index.str())) {
+        std::cerr << "Failed to write the corpus index!" << std::endl;
+    }
+
+    out << "Generated " << written << " of " << entries.size() << " maps into " << directory
+        << "  threads: " << threadCount << "  wall: " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+    return written;
+}
+
+std::vector<Map> loadMapCorpus(const std::string& directory) {
+    std::vector<Map> maps;
+    std::ifstream index(directory + "/" + CORPUS_INDEX_FILE);
+    if (!index.is_open()) {
+        std::cerr << "Corpus index not found in " << directory << std::endl;
+        return maps;
+    }
+    std::string line;
+    while (std::getline(index, line)) {
+        std::istringstream fields(line);
+        std::string file;
+        if (!(fields >> file) || file[0] == '#') continue;
+        Map map(0, 0, directory + "/" + file);
+        if (map.load()) maps.push_back(map);
+    }
+    return maps;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Map.h"
+
+#define CORPUS_INDEX_FILE "index.txt"
+#define MAX_GENERATE_ATTEMPTS 8    // layouts tried per seed before giving up on it
+
+enum MapSymmetry { SYMMETRY_NONE, SYMMETRY_MIRROR_X, SYMMETRY_MIRROR_Y, SYMMETRY_QUAD, SYMMETRY_ROTATE };
+
+struct MapGenParams {
+    int rows;
+    int cols;
+    double density;         // fraction of the open floor covered by wall segments
+    int corridorWidth;      // passages between walls, and carved corridors, are at least this wide
+    int roomCount;          // 0: open board; otherwise rooms carved out of solid rock, joined by corridors
+    MapSymmetry symmetry;
+
+    // The default board size
+    MapGenParams() : rows(20), cols(30), density(0.1), corridorWidth(2), roomCount(0), symmetry(SYMMETRY_NONE) {}
+};
+
+// Reads one "key=value" option: size=WxH, density=0.2, corridor=2, rooms=5, symmetry=none|x|y|quad|rotate.
+// False on an unknown key or a bad value.
+bool parseMapGenParam(const std::string& text, MapGenParams& params);
+const char* mapSymmetryName(MapSymmetry symmetry);
+
+// Builds the layout for `seed` into `map` (replaced by a map of the parameters' size): the same seed and
+// parameters always give the same map. Pockets the snake could not reach are filled in;
+// false if no playable layout with a free board center came up in MAX_GENERATE_ATTEMPTS.
+bool generateMap(const MapGenParams& params, uint64_t seed, Map& map);
+
+// Generates maps for seeds baseSeed .. baseSeed + count - 1 on all cores and writes them to
+// `directory` as .smap files, with an index of files and seeds. Returns the number written.
+int generateMapCorpus(const std::string& directory, int count, uint64_t baseSeed, const MapGenParams& params, int threads, std::ostream& out);
+
+// Every map listed in a corpus index, in index order
+std::vector<Map> loadMapCorpus(const std::string& directory);
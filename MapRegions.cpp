@@ -0,0 +1,132 @@
+#include "MapRegions.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "Map.h"
+
+MapRegions::MapRegions() : rows(0), cols(0), largest(-1), spawnCell(-1), freeCount(0) {}
+
+int MapRegions::findRoot(int run) {
+    while (parent[run] != run) {
+        parent[run] = parent[parent[run]]; // path halving
+        run = parent[run];
+    }
+    return run;
+}
+
+void MapRegions::analyze(const Map& map) {
+    rows = map.getRows();
+    cols = map.getCols();
+    const std::vector<unsigned char>& grid = map.getMap();
+    runs.clear();
+    rowRuns.assign((size_t)rows + 1, 0);
+    parent.clear();
+    freeCount = 0;
+
+    int previous = 0; // first run of the row above
+    for (int y = 0; y < rows; ++y) {
+        const unsigned char* row = &grid[(size_t)y * cols];
+        rowRuns[y] = (int)runs.size();
+        int above = previous;
+        int aboveEnd = rowRuns[y];
+        for (int x = 0; x < cols; ) {
+            if (row[x] == 1) { ++x; continue; }
+            Run run = { y, x, x };
+            const void* wall = memchr(row + x, 1, (size_t)(cols - x));
+            run.end = wall ? (int)((const unsigned char*)wall - row) : cols;
+            x = run.end;
+            freeCount += run.end - run.start;
+
+            int id = (int)runs.size();
+            runs.push_back(run);
+            parent.push_back(id);
+            // Join every run above that shares a column; the last one may also touch the next run
+            while (above < aboveEnd && runs[above].end <= run.start) ++above;
+            for (int a = above; a < aboveEnd && runs[a].start < run.end; ++a) {
+                int rootA = findRoot(a), rootB = findRoot(id);
+                if (rootA != rootB) parent[std::max(rootA, rootB)] = std::min(rootA, rootB);
+            }
+        }
+        previous = rowRuns[y];
+    }
+    rowRuns[rows] = (int)runs.size();
+
+    // Number the regions in row-major order of their first cell
+    sizes.clear();
+    region.resize(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+        int root = findRoot((int)i);
+        if (root == (int)i) {
+            region[i] = (int)sizes.size();
+            sizes.push_back(0);
+        }
+        else {
+            region[i] = region[root]; // a root is its region's first run, so it is numbered already
+        }
+        sizes[region[i]] += runs[i].end - runs[i].start;
+    }
+
+    // The largest region, the center's on a tie
+    int centerX = cols / 2, centerY = rows / 2;
+    int centerRegion = regionAt(centerX, centerY);
+    largest = centerRegion;
+    for (int r = 0; r < (int)sizes.size(); ++r) {
+        if (largest < 0 || sizes[r] > sizes[largest]) largest = r;
+    }
+
+    // Spawn at the center, or at the cell of the region nearest to it
+    spawnCell = -1;
+    if (largest >= 0 && largest == centerRegion) {
+        spawnCell = centerY * cols + centerX;
+    }
+    else if (largest >= 0) {
+        long long best = -1;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            const Run& run = runs[i];
+            if (region[i] != largest) continue;
+            int x = std::max(run.start, std::min(centerX, run.end - 1));
+            long long dx = x - centerX, dy = run.row - centerY;
+            long long distance = dx * dx + dy * dy;
+            if (best < 0 || distance < best) {
+                best = distance;
+                spawnCell = run.row * cols + x;
+            }
+        }
+    }
+
+    reachable.assign((size_t)rows * cols, 0);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (region[i] != largest) continue;
+        std::fill(reachable.begin() + (size_t)runs[i].row * cols + runs[i].start, reachable.begin() + (size_t)runs[i].row * cols + runs[i].end, 1);
+    }
+}
+
+int MapRegions::regionAt(int x, int y) const {
+    if (x < 0 || x >= cols || y < 0 || y >= rows) return -1;
+    // Runs of a row are sorted: the last one starting at or before x
+    auto first = runs.begin() + rowRuns[y], last = runs.begin() + rowRuns[y + 1];
+    auto it = std::upper_bound(first, last, x, [](int value, const Run& run) { return value < run.start; });
+    if (it == first || (it - 1)->end <= x) return -1;
+    return region[it - 1 - runs.begin()];
+}
+
+bool validateMap(const Map& map) {
+    MapRegions regions;
+    regions.analyze(map);
+    if (regions.getReachableCount() < MIN_PLAYABLE_CELLS) {
+        std::cerr << "Map has no room to play: " << regions.getReachableCount() << " free cell(s) around the spawn point" << std::endl;
+        return false;
+    }
+
+    int cols = map.getCols();
+    int spawn = regions.getSpawnCell();
+    if (spawn != (map.getRows() / 2) * cols + cols / 2) {
+        std::cerr << "Warning: the board center is blocked or walled in; the snake starts at ("
+            << spawn % cols << ", " << spawn / cols << ")" << std::endl;
+    }
+    if (regions.getUnreachableCount() > 0) {
+        std::cerr << "Warning: " << regions.getUnreachableCount() << " free cell(s) in " << regions.getRegionCount() - 1
+            << " enclosed pocket(s) can never be reached; no items are placed there" << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+class Map;
+
+#define MIN_PLAYABLE_CELLS 2    // the snake's first cell and one for the apple
+
+// Connected regions of the free cells of a map, the way the snake moves
+// (4 neighbours, no wrap-around). The free cells of each row are taken as runs,
+// and runs that touch a run of the row above are joined with a union-find, so
+// the work is one pass over the grid plus one step per run: cheap enough to
+// repeat on every frame the editor changes a large map.
+// The snake spawns in the largest region (at the board center when the center
+// is in it), and only that region is reachable: items are placed there alone.
+class MapRegions {
+private:
+    struct Run {
+        int row;
+        int start, end;     // free cells [start, end) of the row
+    };
+
+    int rows;
+    int cols;
+    std::vector<Run> runs;              // row-major
+    std::vector<int> rowRuns;           // first run of each row, plus one past the last
+    std::vector<int> parent;            // union-find over the runs; a root is the lowest run of its set
+    std::vector<int> region;            // region of each run
+    std::vector<int> sizes;             // cells per region
+    std::vector<unsigned char> reachable;   // per cell: free and in the spawn region
+    int largest;
+    int spawnCell;
+    int freeCount;
+
+    int findRoot(int run);
+
+public:
+    MapRegions();
+
+    // Label the regions of the map's current obstacles
+    void analyze(const Map& map);
+
+    int getRegionCount() const { return (int)sizes.size(); }
+    int getRegionSize(int index) const { return sizes[index]; }
+    // Region of a cell, -1 for obstacles and cells outside the board
+    int regionAt(int x, int y) const;
+    // Region the snake starts in, -1 when the map has no free cell
+    int getSpawnRegion() const { return largest; }
+    // Row-major cell the snake starts on, -1 when the map has no free cell
+    int getSpawnCell() const { return spawnCell; }
+
+    bool isReachable(int cell) const { return reachable[cell] != 0; }
+    // Row-major, 1 per reachable cell
+    const std::vector<unsigned char>& getReachableMask() const { return reachable; }
+    int getFreeCount() const { return freeCount; }
+    int getReachableCount() const { return largest < 0 ? 0 : sizes[largest]; }
+    // Free cells in pockets the snake can never get to
+    int getUnreachableCount() const { return freeCount - getReachableCount(); }
+};
+
+// Reports pockets and a walled-in board center on the console; false if the
+// map cannot be played at all (no room around the spawn point)
+bool validateMap(const Map& map);
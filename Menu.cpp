@@ -1,46 +1,88 @@
 #include "Menu.h"
+#include <array>
+#include <map>
 
+// Retained UI: every distinct look of a screen (which screen, selection, values,
+// frame size) is rasterized once and kept. A screen function only copies the
+// cached image into the frame when its look differs from what the window shows,
+// and reports whether it did, so the caller can skip imshow on idle frames.
+typedef std::array<int, 8> ScreenKey;
 
+enum ScreenId { NO_SCREEN, MAIN_MENU_SCREEN, GAME_OVER_SCREEN, OPTIONS_SCREEN, PAUSE_SCREEN };
 
-void showMenu(cv::Mat& frame, int& selectedOption) {
-    std::vector<std::string> menuOptions = { "Start the Game", "Options", "Exit" };
-    frame = cv::Scalar(0, 0, 0);
+static std::map<ScreenKey, cv::Mat> screenCache;
+static ScreenKey presentedKey = { NO_SCREEN };
 
-    for (size_t i = 0; i < menuOptions.size(); i++) {
-        cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
-        putText(frame, menuOptions[i], cv::Point(windowWidth / 3, 100 + i * 40), cv::FONT_HERSHEY_SIMPLEX, 1, color, 2);
+template <class Draw>
+static bool presentScreen(cv::Mat& frame, ScreenKey key, Draw draw) {
+    if (key == presentedKey) {
+        return false; // Window already shows exactly this
     }
+    auto cached = screenCache.find(key);
+    if (cached == screenCache.end()) {
+        cv::Mat image(frame.rows, frame.cols, CV_8UC3, cv::Scalar(0, 0, 0));
+        draw(image);
+        cached = screenCache.emplace(key, image).first;
+    }
+    cached->second.copyTo(frame);
+    presentedKey = key;
+    return true;
+}
+
+void invalidateScreen() {
+    presentedKey = ScreenKey{ NO_SCREEN };
+}
+
+static const std::string menuOptions[] = { "Start the Game", "Autopilot", "Options", "Exit" };
+static const std::string gameOverMenuOptions[] = { "Retry", "Back to Menu" };
+static const std::string optionsMenu[] = {
+    "1. Snake Speed:",
+    "2. Sound:",
+    "3. Window Size: 800 x 600",
+    "4. Full-screen: 1400 x 760",
+    "5. Back"
+};
+
+bool showMenu(cv::Mat& frame, int& selectedOption) {
+    ScreenKey key = { MAIN_MENU_SCREEN, selectedOption, frame.cols, frame.rows, windowWidth, windowHeight };
+    return presentScreen(frame, key, [&](cv::Mat& image) {
+        for (size_t i = 0; i < 4; i++) {
+            cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
+            putText(image, menuOptions[i], cv::Point(windowWidth / 3, 100 + i * 40), cv::FONT_HERSHEY_SIMPLEX, 1, color, 2);
+        }
+    });
 }
 
 void handleMenuInput(int key, int& selectedOption, GameStates& currentState, SnakeGame& game) {
     if (key == 'w' && selectedOption > 0) {
         selectedOption--;
     }
-    if (key == 's' && selectedOption < 2) {
+    if (key == 's' && selectedOption < 3) {
         selectedOption++;
     }
 
     if (key == 13) { // ASCI code for enter button
         switch (selectedOption) {
         case 0:
+        case 1:
             currentState = PLAYING;
+            game.setAutopilot(selectedOption == 1);
             game.resetGame();
             break;
-        case 1: currentState = OPTIONS; break;
-        case 2: currentState = EXIT; break;
+        case 2: currentState = OPTIONS; break;
+        case 3: currentState = EXIT; break;
         }
     }
 }
 
-void showGameOverMenu(cv::Mat& frame, int& selectedOption) {
-    std::vector<std::string> gameOverMenuOptions = { "Retry", "Back to Menu" };
-    frame = cv::Scalar(0, 0, 0);
-    
-    for (size_t i = 0; i < gameOverMenuOptions.size(); i++) {
-        cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
-        putText(frame, gameOverMenuOptions[i], cv::Point(windowWidth / 3, windowHeight / 2 + i * 40), cv::FONT_HERSHEY_SIMPLEX, 1, color, 2);
-    }
-
+bool showGameOverMenu(cv::Mat& frame, int& selectedOption) {
+    ScreenKey key = { GAME_OVER_SCREEN, selectedOption, frame.cols, frame.rows, windowWidth, windowHeight };
+    return presentScreen(frame, key, [&](cv::Mat& image) {
+        for (size_t i = 0; i < 2; i++) {
+            cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
+            putText(image, gameOverMenuOptions[i], cv::Point(windowWidth / 3, windowHeight / 2 + i * 40), cv::FONT_HERSHEY_SIMPLEX, 1, color, 2);
+        }
+    });
 }
 
 void handleGameOverMenuInput(int key, int& selectedOption, GameStates& currentState, SnakeGame& game) {
@@ -62,78 +104,83 @@ void handleGameOverMenuInput(int key, int& selectedOption, GameStates& currentSt
 
 }
 
-void showOptionsMenu(cv::Mat& frame, int& selectedOption, int snakeSpeed, bool soundEnable, int& windowWidth, int& windowHeight) {
-    std::vector<std::string> optionsMenu = {
-        "1. Snake Speed:",
-        "2. Sound:",
-        "3. Window Size: 800 x 600",
-        "4. Full-screen: 1400 x 760",
-        "5. Back"
-    };
-    frame = cv::Scalar(0, 0, 0);
-
-    int textYPosition = 80;
-    int lineSpacing = 50;
-
-    for (size_t i = 0; i < optionsMenu.size(); i++) {
-        cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
-        putText(frame, optionsMenu[i], cv::Point(50, textYPosition + i * lineSpacing), cv::FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
-
-        if (i == 0) {
-            int baseX = 165;
-            cv::Scalar colorLent = cv::Scalar(255, 255, 255);
-            cv::Scalar colorNormal = cv::Scalar(255, 255, 255);
-            cv::Scalar colorRapid = cv::Scalar(255, 255, 255);
-
-            if (snakeSpeed == 200) {
-                colorLent = cv::Scalar(0, 255, 0);
-            }
-            else if (snakeSpeed == 100) {
-                colorNormal = cv::Scalar(0, 255, 0);
-            }
-            else if (snakeSpeed == 50) {
-                colorRapid = cv::Scalar(0, 255, 0);
+bool showOptionsMenu(cv::Mat& frame, int& selectedOption, int ticksPerSecond, bool soundEnable, int& windowWidth, int& windowHeight) {
+    ScreenKey key = { OPTIONS_SCREEN, selectedOption, frame.cols, frame.rows, windowWidth, windowHeight, ticksPerSecond, soundEnable ? 1 : 0 };
+    return presentScreen(frame, key, [&](cv::Mat& image) {
+        int textYPosition = 80;
+        int lineSpacing = 50;
+
+        for (size_t i = 0; i < 5; i++) {
+            cv::Scalar color = (i == selectedOption) ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 255, 255);
+            putText(image, optionsMenu[i], cv::Point(50, textYPosition + i * lineSpacing), cv::FONT_HERSHEY_SIMPLEX, 0.8, color, 2);
+
+            if (i == 0) {
+                int baseX = 165;
+                cv::Scalar colorLent = cv::Scalar(255, 255, 255);
+                cv::Scalar colorNormal = cv::Scalar(255, 255, 255);
+                cv::Scalar colorRapid = cv::Scalar(255, 255, 255);
+
+                if (ticksPerSecond == SPEED_SLOW) {
+                    colorLent = cv::Scalar(0, 255, 0);
+                }
+                else if (ticksPerSecond == SPEED_NORMAL) {
+                    colorNormal = cv::Scalar(0, 255, 0);
+                }
+                else if (ticksPerSecond == SPEED_FAST) {
+                    colorRapid = cv::Scalar(0, 255, 0);
+                }
+
+                putText(image, "Slow", cv::Point(baseX + 100, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorLent, 2);
+                putText(image, "|", cv::Point(baseX + 160, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
+                putText(image, "Normal", cv::Point(baseX + 170, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorNormal, 2);
+                putText(image, "|", cv::Point(baseX + 270, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
+                putText(image, "Fast", cv::Point(baseX + 280, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorRapid, 2);
             }
 
-            putText(frame, "Slow", cv::Point(baseX + 100, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorLent, 2);
-            putText(frame, "|", cv::Point(baseX + 160, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
-            putText(frame, "Normal", cv::Point(baseX + 170, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorNormal, 2);
-            putText(frame, "|", cv::Point(baseX + 270, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
-            putText(frame, "Fast", cv::Point(baseX + 280, textYPosition), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorRapid, 2);
-        }
+            if (i == 1) {
+                int baseX = 200;
+                cv::Scalar colorOn = cv::Scalar(255, 255, 255);
+                cv::Scalar colorOff = cv::Scalar(255, 255, 255);
 
-        if (i == 1) {
-            int baseX = 200;
-            cv::Scalar colorOn = cv::Scalar(255, 255, 255);
-            cv::Scalar colorOff = cv::Scalar(255, 255, 255);
-
-            if (soundEnable) {
-                colorOn = cv::Scalar(0, 255, 0);
-            }
-            else
-            {
-                colorOff = cv::Scalar(0, 255, 0);
-            }
+                if (soundEnable) {
+                    colorOn = cv::Scalar(0, 255, 0);
+                }
+                else
+                {
+                    colorOff = cv::Scalar(0, 255, 0);
+                }
 
 
-            putText(frame, "On", cv::Point(baseX, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorOn, 2);
-            putText(frame, "|", cv::Point(baseX + 40, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
-            putText(frame, "Off", cv::Point(baseX + 60, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorOff, 2);
+                putText(image, "On", cv::Point(baseX, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorOn, 2);
+                putText(image, "|", cv::Point(baseX + 40, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
+                putText(image, "Off", cv::Point(baseX + 60, textYPosition + 53), cv::FONT_HERSHEY_SIMPLEX, 0.8, colorOff, 2);
 
+            }
         }
-    }
+    });
+}
+
+bool showPauseScreen(cv::Mat& frame) {
+    ScreenKey key = { PAUSE_SCREEN, 0, frame.cols, frame.rows, windowWidth, windowHeight };
+    return presentScreen(frame, key, [&](cv::Mat& image) {
+        putText(image, "Pause", cv::Point(windowWidth / 3 + 20, windowHeight / 2), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(255, 255, 255), 2);
+        putText(image, "Press ESC to Resume", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 50), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
+        //putText(image, "Press 1 to Buy a Life (5 points)", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 150), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
+        //putText(image, "Press 2 to Buy a Super Power (15 points)", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 100), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
+        putText(image, "Press 1 to enter map editor", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 150), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
+    });
 }
 
-void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentState, int& snakeSpeed, bool& soundEnable, int& windowWidth, int& windowHeight, SnakeGame& game, cv::Mat& frame) {
+void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentState, int& ticksPerSecond, bool& soundEnable, int& windowWidth, int& windowHeight, SnakeGame& game, cv::Mat& frame) {
     if (key == 'w' && selectedOption > 0) selectedOption--;
     if (key == 's' && selectedOption < 4) selectedOption++;
 
     if (key == 13) {
         switch (selectedOption) {
         case 0:
-            if (snakeSpeed == 100) snakeSpeed = 200;
-            else if (snakeSpeed == 200) snakeSpeed = 50;
-            else snakeSpeed = 100;
+            if (ticksPerSecond == SPEED_NORMAL) ticksPerSecond = SPEED_SLOW;
+            else if (ticksPerSecond == SPEED_SLOW) ticksPerSecond = SPEED_FAST;
+            else ticksPerSecond = SPEED_NORMAL;
             break;
 
         case 1:
@@ -145,6 +192,7 @@ void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentSta
             windowHeight = (windowHeight == HEIGHT) ? 600 : HEIGHT;
             cv::resizeWindow("Snake Game", windowWidth, windowHeight);
             frame = cv::Mat(windowHeight, windowWidth, CV_8UC3);
+            invalidateScreen();
             game.resetGame();
             break;
 
@@ -153,6 +201,7 @@ void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentSta
             windowHeight = 760;
             setWindowProperty("Snake Game", cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN);
             frame = cv::Mat(windowHeight, windowWidth, CV_8UC3);
+            invalidateScreen();
             game.resetGame();
             break;
 
@@ -5,13 +5,24 @@
 #include "Snake.h"
 #include "Glob.h"
 
+// Snake speeds offered in the options, in ticks per second
+#define SPEED_SLOW 5
+#define SPEED_NORMAL 10
+#define SPEED_FAST 20
 
-void showMenu(cv::Mat& frame, int& selectedOption);
+
+// The show* functions draw from a cache of rasterized screens and return true only
+// when the frame changed, i.e. when the caller has to imshow it again.
+bool showMenu(cv::Mat& frame, int& selectedOption);
 void handleMenuInput(int key, int& selectedOption, GameStates& currentState, SnakeGame& game);
 
-void showGameOverMenu(cv::Mat& frame, int& selectedOption);
+bool showGameOverMenu(cv::Mat& frame, int& selectedOption);
 void handleGameOverMenuInput(int key, int& selectedOption, GameStates& currentState, SnakeGame& game);
 
-void showOptionsMenu(cv::Mat& frame, int& selectedOption, int snakeSpeed, bool soundEnable, int& windowWidth, int& windowHeight);
-void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentState, int& snakeSpeed, bool& soundEnable, int& windowWidth, int& windowHeight, SnakeGame& game, cv::Mat& frame);
+bool showOptionsMenu(cv::Mat& frame, int& selectedOption, int ticksPerSecond, bool soundEnable, int& windowWidth, int& windowHeight);
+void handleOptionsMenuInput(int key, int& selectedOption, GameStates& currentState, int& ticksPerSecond, bool& soundEnable, int& windowWidth, int& windowHeight, SnakeGame& game, cv::Mat& frame);
+bool showPauseScreen(cv::Mat& frame);
+
+// Something other than a menu screen was drawn into the frame or the window
+void invalidateScreen();
 //void checkWindowSize(const std::string& windowName);
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include "MultiSnakeCore.h"
+#include <cctype>
+#include <cstdlib>
+
+// Updates per second when no clock is injected, as in SnakeCore
+#define DEFAULT_TICK_FREQUENCY 10.0
+#define DIRTY_CELLS_PER_SNAKE 64
+
+MultiSnakeCore::MultiSnakeCore(const Map& map, int snakeCount, uint64_t seed)
+    : snakes(std::max(1, std::min(snakeCount, MAX_SNAKES))), rng(seed), seed(seed), gameOver(false), boardFull(false),
+      claimGeneration(0), allDirty(true), tickCount(0), tickFrequency(DEFAULT_TICK_FREQUENCY), map(map)
+{
+    apple = SnakePoint(-1, -1);
+    specialApple = SnakePoint(-1, -1);
+    pinkApple = SnakePoint(-1, -1);
+    resetGame();
+}
+
+void MultiSnakeCore::setTickSource(std::function<int64_t()> counter, double frequency) {
+    tickCounter = counter;
+    tickFrequency = counter ? frequency : DEFAULT_TICK_FREQUENCY;
+}
+
+void MultiSnakeCore::update() {
+    if (gameOver) return;
+    tickCount++;
+    int count = (int)snakes.size();
+    int cols = this->map.getCols(), rows = this->map.getRows();
+
+    // Next heads, checked against the board as it was before anyone moved
+    if (++claimGeneration == 0) { // wrapped: forget every old claim
+        std::fill(claimStamp.begin(), claimStamp.end(), 0);
+        claimGeneration = 1;
+    }
+    for (int i = 0; i < count; ++i) {
+        SnakePlayer& s = snakes[i];
+        moving[i] = 0;
+        if (!s.alive) continue;
+        if (s.invincible && now() > s.invincibilityEndTime) {
+            s.invincible = false;
+        }
+
+        SnakePoint head = s.body.front();
+        switch (s.dir) {
+        case UP: head.y -= 1; break;
+        case DOWN: head.y += 1; break;
+        case LEFT: head.x -= 1; break;
+        case RIGHT: head.x += 1; break;
+        }
+        if (s.invincible) { // Through the walls to the other side, through anything else
+            head.x = (head.x + cols) % cols;
+            head.y = (head.y + rows) % rows;
+        }
+        else if (occupancy.isBlocked(head.x, head.y)) {
+            s.lastCollision = collisionCause(i, head);
+            continue;
+        }
+        nextHead[i] = head;
+        moving[i] = 1;
+
+        // Head to head: both lose a heart, unless invincible
+        int cell = head.y * cols + head.x;
+        if (claimStamp[cell] == claimGeneration) {
+            int other = claimedBy[cell];
+            if (!snakes[other].invincible) {
+                moving[other] = 0;
+                snakes[other].lastCollision = HIT_SNAKE;
+            }
+            if (!s.invincible) {
+                moving[i] = 0;
+                s.lastCollision = HIT_SNAKE;
+            }
+        }
+        claimStamp[cell] = claimGeneration;
+        claimedBy[cell] = (int8_t)i;
+    }
+
+    // Collisions cost a heart and the move; everyone else steps forward at once
+    for (int i = 0; i < count; ++i) {
+        if (!snakes[i].alive) continue;
+        if (moving[i]) pushHead(i, nextHead[i]);
+        else loseHeart(i);
+    }
+
+    // Items in snake order: the first head on an item takes it
+    for (int i = 0; i < count; ++i) {
+        if (!moving[i]) continue;
+        SnakePlayer& s = snakes[i];
+        SnakePoint head = nextHead[i];
+        if (head.x == apple.x && head.y == apple.y) {
+            placeApple();
+            if (specialApple.x == -1 && specialApple.y == -1) {
+                placeSpecialApple();
+            }
+            if (pinkApple.x == -1 && pinkApple.y == -1) {
+                placePinkApple();
+            }
+        }
+        else if (head.x == specialApple.x && head.y == specialApple.y) {
+            s.invincible = true;
+            s.invincibilityEndTime = now() + (int64_t)(INVINCIBILITY_DURATION * tickFrequency);
+            placeSpecialApple();
+        }
+        else if (head.x == pinkApple.x && head.y == pinkApple.y) {
+            if (s.hearts < MAX_HARTS) {
+                s.hearts++;
+            }
+            placePinkApple();
+        }
+        else {
+            popTail(i);
+        }
+        s.score = s.body.size() - 1;
+    }
+
+    if (getAliveCount() == 0) {
+        gameOver = true;
+    }
+}
+
+void MultiSnakeCore::changeDirection(int index, int key) {
+    SnakePlayer& s = snakes[index];
+    switch (tolower(key)) {
+    case 'w': if (s.dir != DOWN) s.dir = UP; break;
+    case 'a': if (s.dir != RIGHT) s.dir = LEFT; break;
+    case 's': if (s.dir != UP) s.dir = DOWN; break;
+    case 'd': if (s.dir != LEFT) s.dir = RIGHT; break;
+    }
+}
+
+void MultiSnakeCore::markDirty(int x, int y) {
+    if (allDirty || !occupancy.inBounds(x, y)) return;
+    if (dirtyCells.size() >= DIRTY_CELLS_PER_SNAKE * snakes.size()) { // Nobody is consuming them (headless), stop tracking
+        dirtyCells.clear();
+        allDirty = true;
+        return;
+    }
+    dirtyCells.push_back(y * this->map.getCols() + x);
+}
+
+void MultiSnakeCore::pushHead(int index, SnakePoint pt) {
+    int cell = pt.y * this->map.getCols() + pt.x;
+    markDirty(pt.x, pt.y);
+    snakes[index].body.pushFront(pt);
+    occupancy.addSnake(pt.x, pt.y);
+    owner[cell] = (int8_t)index;
+    freeCells.remove(cell);
+}
+
+void MultiSnakeCore::popTail(int index) {
+    SnakePoint tail = snakes[index].body.back();
+    snakes[index].body.popBack();
+    occupancy.removeSnake(tail.x, tail.y);
+    markDirty(tail.x, tail.y);
+    if (!occupancy.hasSnake(tail.x, tail.y)) {
+        owner[tail.y * this->map.getCols() + tail.x] = -1;
+    }
+    if (isPlaceable(tail.x, tail.y) && !isItemAt(tail.x, tail.y)) {
+        freeCells.insert(tail.y * this->map.getCols() + tail.x);
+    }
+}
+
+// Out of hearts: the snake leaves the board and its cells are free again
+void MultiSnakeCore::loseHeart(int index) {
+    SnakePlayer& s = snakes[index];
+    if (s.invincible) {
+        return; // not losing hearts
+    }
+
+    s.hearts--;
+    if (s.hearts <= 0) {
+        s.alive = false;
+        while (!s.body.empty()) popTail(index);
+    }
+    else {
+        s.invincible = true;
+        s.invincibilityEndTime = now() + (int64_t)(INVINCIBILITY_DURATION * tickFrequency);
+    }
+}
+
+bool MultiSnakeCore::isItemAt(int x, int y) const {
+    return (x == apple.x && y == apple.y) || (x == specialApple.x && y == specialApple.y) || (x == pinkApple.x && y == pinkApple.y);
+}
+
+bool MultiSnakeCore::isPlaceable(int x, int y) const {
+    return occupancy.isFree(x, y) && regions.isReachable(y * this->map.getCols() + x);
+}
+
+DeathCause MultiSnakeCore::collisionCause(int index, SnakePoint pt) const {
+    if (!occupancy.inBounds(pt.x, pt.y)) return HIT_WALL;
+    if (occupancy.isObstacle(pt.x, pt.y)) return HIT_OBSTACLE;
+    return snakeAt(pt.x, pt.y) == index ? HIT_SELF : HIT_SNAKE;
+}
+
+// Snakes start spread along the middle row, each at the reachable free cell nearest to its spot,
+// heading towards the far side; player 0 heads right and a single snake starts where SnakeCore's does
+void MultiSnakeCore::resetSnakes() {
+    int rows = this->map.getRows(), cols = this->map.getCols();
+    int count = (int)snakes.size();
+    dirtyCells.clear();
+    allDirty = true;
+    occupancy.reset(this->map);
+    regions.analyze(this->map);
+    owner.assign((size_t)rows * cols, -1);
+    claimStamp.assign((size_t)rows * cols, 0);
+    claimedBy.assign((size_t)rows * cols, -1);
+    claimGeneration = 0;
+    nextHead.assign(count, SnakePoint());
+    moving.assign(count, 0);
+
+    int items[] = { apple.y * cols + apple.x, specialApple.y * cols + specialApple.x, pinkApple.y * cols + pinkApple.x };
+    freeCells.assign(rows * cols, [&](int cell) {
+        return occupancy.isFreeCell(cell) && regions.isReachable(cell) && cell != items[0] && cell != items[1] && cell != items[2];
+    });
+
+    for (int i = 0; i < count; ++i) {
+        SnakePlayer& s = snakes[i];
+        s.body.clear();
+        s.body.reserve((size_t)rows * cols + 1);
+
+        int targetX = cols * (2 * i + 1) / (2 * count), targetY = rows / 2;
+        int spawn = count == 1 ? regions.getSpawnCell() : -1;
+        long long best = -1;
+        for (int cell = 0; count > 1 && cell < rows * cols; ++cell) {
+            if (!regions.isReachable(cell) || occupancy.hasSnake(cell % cols, cell / cols)) continue;
+            long long dx = cell % cols - targetX, dy = cell / cols - targetY;
+            if (best < 0 || dx * dx + dy * dy < best) {
+                best = dx * dx + dy * dy;
+                spawn = cell;
+            }
+        }
+        if (spawn < 0) spawn = targetY * cols + targetX; // no room left: stack up as SnakeCore would
+        s.dir = i == 0 || spawn % cols <= cols / 2 ? RIGHT : LEFT;
+        pushHead(i, SnakePoint(spawn % cols, spawn / cols));
+    }
+}
+
+void MultiSnakeCore::resetGame() {
+    apple = SnakePoint(-1, -1);
+    specialApple = SnakePoint(-1, -1);
+    pinkApple = SnakePoint(-1, -1);
+    for (SnakePlayer& s : snakes) {
+        s.hearts = MAX_HARTS;
+        s.score = 0;
+        s.alive = true;
+        s.invincible = false;
+        s.invincibilityEndTime = 0;
+        s.lastCollision = NO_DEATH;
+    }
+    resetSnakes();
+    gameOver = false;
+    boardFull = false;
+    placeApple();
+}
+
+void MultiSnakeCore::newGame(uint64_t seed) {
+    this->seed = seed;
+    rng.seed(seed);
+    resetGame();
+}
+
+int MultiSnakeCore::getAliveCount() const {
+    int alive = 0;
+    for (const SnakePlayer& s : snakes) alive += s.alive ? 1 : 0;
+    return alive;
+}
+
+int MultiSnakeCore::getLeader() const {
+    int leader = 0;
+    for (int i = 1; i < (int)snakes.size(); ++i) {
+        if (snakes[i].score > snakes[leader].score) leader = i;
+    }
+    return leader;
+}
+
+void MultiSnakeCore::releaseItem(const SnakePoint& item) {
+    markDirty(item.x, item.y);
+    if (isPlaceable(item.x, item.y)) {
+        freeCells.insert(item.y * this->map.getCols() + item.x);
+    }
+}
+
+bool MultiSnakeCore::placeItem(SnakePoint& item) {
+    releaseItem(item);
+    if (freeCells.empty()) {
+        item = SnakePoint(-1, -1);
+        return false;
+    }
+    int cell = freeCells.at((int)rng.nextBelow((uint32_t)freeCells.size()));
+    freeCells.remove(cell);
+    item.x = cell % this->map.getCols();
+    item.y = cell / this->map.getCols();
+    markDirty(item.x, item.y);
+    return true;
+}
+
+void MultiSnakeCore::placeApple() {
+    if (!placeItem(apple)) {
+        boardFull = true;
+        gameOver = true;
+    }
+}
+
+void MultiSnakeCore::placeSpecialApple() {
+    if (rng.nextBelow(100) >= 50) { // 50% to respawn
+        releaseItem(specialApple);
+        specialApple = SnakePoint(-1, -1);
+        return;
+    }
+    placeItem(specialApple);
+}
+
+void MultiSnakeCore::placePinkApple() {
+    if (rng.nextBelow(100) >= 20) { // 20% to respawn
+        releaseItem(pinkApple);
+        pinkApple = SnakePoint(-1, -1);
+        return;
+    }
+    placeItem(pinkApple);
+}
+
+int greedyMultiBot(const MultiSnakeCore& game, int index) {
+    static const int keys[4] = { 'w', 's', 'a', 'd' };   // UP, DOWN, LEFT, RIGHT
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    static const Direction opposite[4] = { DOWN, UP, RIGHT, LEFT };
+
+    const SnakePlayer& s = game.getPlayer(index);
+    if (!s.alive) return -1;
+    SnakePoint head = s.body.front();
+    SnakePoint apple = game.getApple();
+    int best = -1;
+    int bestDistance = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (opposite[d] == s.dir) continue; // changeDirection would ignore it
+        int x = head.x + dx[d];
+        int y = head.y + dy[d];
+        if (game.isBlocked(x, y)) continue;
+        int distance = std::abs(x - apple.x) + std::abs(y - apple.y);
+        if (best == -1 || distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+        }
+    }
+    return best == -1 ? -1 : keys[best];
+}
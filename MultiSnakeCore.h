@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Map.h"
+#include "OccupancyGrid.h"
+#include "FreeCellIndex.h"
+#include "MapRegions.h"
+#include "GameRng.h"
+#include "SnakeBody.h"
+#include "SnakeCore.h"
+
+#define MAX_SNAKES 8
+
+// One snake on a shared board
+struct SnakePlayer {
+    SnakeBody body;             // head first, empty once the snake is out
+    Direction dir;
+    int hearts;
+    size_t score;
+    bool alive;
+    bool invincible;
+    int64_t invincibilityEndTime;
+    DeathCause lastCollision;   // what the snake hit when it last lost a heart
+};
+
+// N snakes on one map, each with its own hearts, score and invincibility, sharing one
+// occupancy grid (obstacles + every body), one set of free cells and the same apples.
+// SnakeCore's rules, for every snake at once. A tick is resolved in one pass per step:
+//   1. every snake's next head is checked against the board as it stood at the start of
+//      the tick (a head may not enter any body cell, tails included, as in SnakeCore);
+//      a per-cell stamp of the heads claimed so far catches two heads entering one cell;
+//   2. the heads of the snakes that did not collide are pushed;
+//   3. items are eaten in snake order (contention for one item: the lowest index wins,
+//      the others move on) and the tails of the snakes that did not eat are popped.
+// So a tick costs O(snakes), never O(snakes^2). A snake that runs out of hearts leaves
+// the board. With one snake, newGame(seed) plays exactly like SnakeCore::newGame(seed).
+class MultiSnakeCore
+{
+private:
+    std::vector<SnakePlayer> snakes;
+    OccupancyGrid occupancy;        // segment count per cell | obstacle bit
+    std::vector<int8_t> owner;      // snake that last laid a segment on each cell, -1 = none
+    FreeCellIndex freeCells;        // reachable cells with no obstacle, snake or apple
+    MapRegions regions;
+    GameRng rng;
+    uint64_t seed;
+    SnakePoint apple;
+    SnakePoint specialApple;
+    SnakePoint pinkApple;
+    bool gameOver;
+    bool boardFull;
+    const int INVINCIBILITY_DURATION = 10;
+
+    // Per tick scratch, one entry per snake / per cell
+    std::vector<SnakePoint> nextHead;
+    std::vector<uint8_t> moving;
+    std::vector<uint32_t> claimStamp;   // claimGeneration when a head last claimed the cell
+    std::vector<int8_t> claimedBy;
+    uint32_t claimGeneration;
+
+    std::vector<int> dirtyCells;
+    bool allDirty;
+
+    int64_t tickCount;
+    std::function<int64_t()> tickCounter;
+    double tickFrequency;
+
+    bool placeItem(SnakePoint& item);
+    void releaseItem(const SnakePoint& item);
+    bool isItemAt(int x, int y) const;
+    bool isPlaceable(int x, int y) const;
+    void placeApple();
+    void placeSpecialApple();
+    void placePinkApple();
+    DeathCause collisionCause(int index, SnakePoint pt) const;
+    void pushHead(int index, SnakePoint pt);
+    void popTail(int index);
+    void loseHeart(int index);
+    void resetSnakes();
+    void markDirty(int x, int y);
+
+public:
+    Map map;
+
+    MultiSnakeCore(const Map& map, int snakeCount, uint64_t seed);
+
+    void setTickSource(std::function<int64_t()> counter, double frequency);
+    int64_t now() const { return tickCounter ? tickCounter() : tickCount; }
+    double getTickFrequency() const { return tickFrequency; }
+    uint64_t getSeed() const { return seed; }
+
+    void update();
+    void changeDirection(int index, int key);
+    void resetGame();
+    void newGame(uint64_t seed);
+
+    // Over when every snake is out, or when there is no free cell left for the apple
+    bool isGameOver() const { return gameOver; }
+    bool isBoardFull() const { return boardFull; }
+
+    int getSnakeCount() const { return (int)snakes.size(); }
+    const SnakePlayer& getPlayer(int index) const { return snakes[index]; }
+    const SnakeBody& getSnake(int index) const { return snakes[index].body; }
+    int getAliveCount() const;
+    int getLeader() const;      // highest score, lowest index on a tie
+    // Snake on a cell, -1 for none (the last one to enter it while invincible snakes overlap)
+    int snakeAt(int x, int y) const { return occupancy.hasSnake(x, y) ? owner[y * this->map.getCols() + x] : -1; }
+    bool isSnakeAt(int x, int y) const { return occupancy.hasSnake(x, y); }
+    bool isBlocked(int x, int y) const { return occupancy.isBlocked(x, y); }
+    const MapRegions& getRegions() const { return regions; }
+
+    SnakePoint getApple() const { return apple; }
+    SnakePoint getSpecialApple() const { return specialApple; }
+    SnakePoint getPinkApple() const { return pinkApple; }
+    int64_t getTickCount() const { return tickCount; }
+
+    // Changed cells (row-major indices) for incremental drawing, as in SnakeCore
+    const std::vector<int>& getDirtyCells() const { return dirtyCells; }
+    bool isAllDirty() const { return allDirty; }
+    void clearDirtyCells() { dirtyCells.clear(); allDirty = false; }
+};
+
+// Heads for the apple, avoiding any move that collides right away; -1 keeps the direction
+int greedyMultiBot(const MultiSnakeCore& game, int index);
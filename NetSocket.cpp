@@ -0,0 +1,251 @@
+#include "NetSocket.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef WSAPOLLFD PollEntry;
+#define pollSockets WSAPoll
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+typedef struct pollfd PollEntry;
+#define pollSockets poll
+#endif
+
+static const char* UNIX_PREFIX = "unix:";
+
+bool initSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+static bool isUnixEndpoint(const std::string& endpoint) {
+    return endpoint.compare(0, strlen(UNIX_PREFIX), UNIX_PREFIX) == 0;
+}
+
+static bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static void configure(SocketHandle socket, bool tcp) {
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket((SOCKET)socket, FIONBIO, &nonBlocking);
+#else
+    fcntl((int)socket, F_SETFL, fcntl((int)socket, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt((int)socket, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+#endif
+    if (tcp) {
+        int noDelay = 1;    // one small message per tick: do not hold it back
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+    }
+}
+
+// "port" or "host:port" to a TCP address (IPv4)
+static bool tcpAddress(const std::string& endpoint, sockaddr_in& address) {
+    std::string host = "127.0.0.1";
+    std::string port = endpoint;
+    size_t colon = endpoint.rfind(':');
+    if (colon != std::string::npos) {
+        host = endpoint.substr(0, colon);
+        port = endpoint.substr(colon + 1);
+    }
+    int portNumber = atoi(port.c_str());
+    if (portNumber <= 0 || portNumber > 65535) return false;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)portNumber);
+    if (host == "localhost") host = "127.0.0.1";
+    return inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+}
+
+#ifndef _WIN32
+static bool unixAddress(const std::string& endpoint, sockaddr_un& address) {
+    std::string path = endpoint.substr(strlen(UNIX_PREFIX));
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+#endif
+
+SocketHandle listenOn(const std::string& endpoint, std::string& error) {
+    const int BACKLOG = 256;
+    SocketHandle listener = INVALID_SOCKET_HANDLE;
+    if (isUnixEndpoint(endpoint)) {
+#ifdef _WIN32
+        error = "Unix sockets are not supported on this platform";
+        return INVALID_SOCKET_HANDLE;
+#else
+        sockaddr_un address;
+        if (!unixAddress(endpoint, address)) {
+            error = "bad Unix socket path";
+            return INVALID_SOCKET_HANDLE;
+        }
+        unlink(address.sun_path); // left over from a server that did not shut down
+        listener = (SocketHandle)socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == INVALID_SOCKET_HANDLE || bind((int)listener, (sockaddr*)&address, sizeof(address)) != 0) {
+            error = "cannot bind " + endpoint;
+            if (listener != INVALID_SOCKET_HANDLE) closeSocket(listener);
+            return INVALID_SOCKET_HANDLE;
+        }
+#endif
+    }
+    else {
+        sockaddr_in address;
+        if (!tcpAddress(endpoint, address)) {
+            error = "bad endpoint " + endpoint;
+            return INVALID_SOCKET_HANDLE;
+        }
+        listener = (SocketHandle)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET_HANDLE) {
+            error = "cannot create a socket";
+            return INVALID_SOCKET_HANDLE;
+        }
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0) {
+            error = "cannot bind " + endpoint;
+            closeSocket(listener);
+            return INVALID_SOCKET_HANDLE;
+        }
+    }
+    if (listen(listener, BACKLOG) != 0) {
+        error = "cannot listen on " + endpoint;
+        closeSocket(listener, endpoint);
+        return INVALID_SOCKET_HANDLE;
+    }
+    configure(listener, false);
+    return listener;
+}
+
+SocketHandle acceptClient(SocketHandle listener) {
+    SocketHandle client = (SocketHandle)accept(listener, nullptr, nullptr);
+    if (client == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+    configure(client, true); // TCP_NODELAY just fails on a Unix socket
+    return client;
+}
+
+SocketHandle connectTo(const std::string& endpoint) {
+    SocketHandle client = INVALID_SOCKET_HANDLE;
+    if (isUnixEndpoint(endpoint)) {
+#ifndef _WIN32
+        sockaddr_un address;
+        if (!unixAddress(endpoint, address)) return INVALID_SOCKET_HANDLE;
+        client = (SocketHandle)socket(AF_UNIX, SOCK_STREAM, 0);
+        if (client == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+        if (connect((int)client, (sockaddr*)&address, sizeof(address)) != 0) {
+            closeSocket(client);
+            return INVALID_SOCKET_HANDLE;
+        }
+#endif
+    }
+    else {
+        sockaddr_in address;
+        if (!tcpAddress(endpoint, address)) return INVALID_SOCKET_HANDLE;
+        client = (SocketHandle)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (client == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+        if (connect(client, (sockaddr*)&address, sizeof(address)) != 0) {
+            closeSocket(client);
+            return INVALID_SOCKET_HANDLE;
+        }
+    }
+    if (client != INVALID_SOCKET_HANDLE) configure(client, !isUnixEndpoint(endpoint));
+    return client;
+}
+
+void closeSocket(SocketHandle socket, const std::string& endpoint) {
+    if (socket == INVALID_SOCKET_HANDLE) return;
+#ifdef _WIN32
+    closesocket((SOCKET)socket);
+#else
+    close((int)socket);
+    sockaddr_un address;
+    if (isUnixEndpoint(endpoint) && unixAddress(endpoint, address)) unlink(address.sun_path);
+#endif
+}
+
+int sendSome(SocketHandle socket, const char* data, int size) {
+#ifdef MSG_NOSIGNAL
+    int sent = (int)send(socket, data, size, MSG_NOSIGNAL); // a closed peer is an error, not SIGPIPE
+#else
+    int sent = (int)send(socket, data, size, 0);
+#endif
+    if (sent >= 0) return sent;
+    return wouldBlock() ? 0 : -1;
+}
+
+int receiveSome(SocketHandle socket, char* buffer, int size) {
+    int received = (int)recv(socket, buffer, size, 0);
+    if (received > 0) return received;
+    if (received == 0) return -1; // orderly shutdown
+    return wouldBlock() ? 0 : -1;
+}
+
+struct SocketPoller::Entries {
+    std::vector<PollEntry> polls;
+};
+
+SocketPoller::SocketPoller() : entries(new Entries()) {}
+
+SocketPoller::~SocketPoller() {}
+
+void SocketPoller::add(SocketHandle socket) {
+    PollEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.fd = socket;
+    entry.events = POLLIN;
+    entries->polls.push_back(entry);
+}
+
+void SocketPoller::remove(size_t index) {
+    entries->polls[index] = entries->polls.back();
+    entries->polls.pop_back();
+}
+
+void SocketPoller::clear() {
+    entries->polls.clear();
+}
+
+size_t SocketPoller::size() const {
+    return entries->polls.size();
+}
+
+SocketHandle SocketPoller::socketAt(size_t index) const {
+    return (SocketHandle)entries->polls[index].fd;
+}
+
+int SocketPoller::wait(int timeoutMs) {
+    if (entries->polls.empty()) return 0;
+    return pollSockets(entries->polls.data(), (unsigned long)entries->polls.size(), timeoutMs);
+}
+
+bool SocketPoller::isReady(size_t index) const {
+    return (entries->polls[index].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
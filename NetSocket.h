@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Thin non-blocking socket layer over BSD sockets / Winsock for the game server and its clients.
+// Endpoints: "7777" (TCP on 127.0.0.1), "host:7777" (TCP), "unix:/path/to.sock" (Unix socket, not on Windows).
+typedef intptr_t SocketHandle;
+#define INVALID_SOCKET_HANDLE ((SocketHandle)-1)
+
+// Once per process before any other call (Winsock start-up); false if sockets are unavailable
+bool initSockets();
+
+// Listening socket, non-blocking; error describes a failure
+SocketHandle listenOn(const std::string& endpoint, std::string& error);
+// Next pending connection (non-blocking, no Nagle delay), INVALID_SOCKET_HANDLE when there is none
+SocketHandle acceptClient(SocketHandle listener);
+// Connected socket, non-blocking, no Nagle delay
+SocketHandle connectTo(const std::string& endpoint);
+// Closes the socket; for a Unix socket listener, pass its endpoint to remove the file as well
+void closeSocket(SocketHandle socket, const std::string& endpoint = std::string());
+
+// Bytes moved, 0 when the call would block, -1 when the connection is gone
+int sendSome(SocketHandle socket, const char* data, int size);
+int receiveSome(SocketHandle socket, char* buffer, int size);
+
+// Readability of a set of sockets (poll / WSAPoll). Entries stay in the order
+// added; remove() moves the last entry into the removed slot.
+class SocketPoller
+{
+private:
+    struct Entries;
+    std::unique_ptr<Entries> entries;
+
+public:
+    SocketPoller();
+    ~SocketPoller();
+
+    void add(SocketHandle socket);
+    void remove(size_t index);
+    void clear();
+    size_t size() const;
+    SocketHandle socketAt(size_t index) const;
+
+    // Waits up to timeoutMs for data or a hang-up on any socket; number of ready sockets, -1 on error
+    int wait(int timeoutMs);
+    bool isReady(size_t index) const;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+// Per-cell occupancy of the board: map obstacles merged with the snake body.
+// Each cell keeps a count of the snake segments on it (segments can overlap
+// while the snake is invincible) plus a bit for the obstacle, so a collision
+// query is a single read.
+class OccupancyGrid {
+private:
+    int rows;
+    int cols;
+    std::vector<uint16_t> cells;
+
+public:
+    static const uint16_t OBSTACLE_BIT = 0x8000;
+    static const uint16_t SNAKE_MASK = 0x7FFF;
+
+    OccupancyGrid() : rows(0), cols(0) {}
+
+    // Rebuild from the map obstacles, with no snake on the board
+    void reset(const Map& map) {
+        rows = map.getRows();
+        cols = map.getCols();
+        cells.assign((size_t)rows * cols, 0);
+        const std::vector<unsigned char>& grid = map.getMap();
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (grid[i] == 1) {
+                cells[i] = OBSTACLE_BIT;
+            }
+        }
+    }
+
+    bool inBounds(int x, int y) const {
+        return x >= 0 && x < cols && y >= 0 && y < rows;
+    }
+
+    // Outside the board, an obstacle or a snake segment
+    bool isBlocked(int x, int y) const {
+        return !inBounds(x, y) || cells[y * cols + x] != 0;
+    }
+
+    // No obstacle and no snake segment
+    bool isFree(int x, int y) const {
+        return inBounds(x, y) && cells[y * cols + x] == 0;
+    }
+
+    // isFree by row-major index, for whole-board scans
+    bool isFreeCell(int cell) const { return cells[cell] == 0; }
+
+    bool hasSnake(int x, int y) const {
+        return inBounds(x, y) && (cells[y * cols + x] & SNAKE_MASK) != 0;
+    }
+
+    bool isObstacle(int x, int y) const {
+        return inBounds(x, y) && (cells[y * cols + x] & OBSTACLE_BIT) != 0;
+    }
+
+    void addSnake(int x, int y) { cells[y * cols + x]++; }
+    void removeSnake(int x, int y) { cells[y * cols + x]--; }
+
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+};
@@ -0,0 +1,116 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+const char* profilePhaseName(ProfilePhase phase) {
+    switch (phase) {
+    case PHASE_INPUT: return "input";
+    case PHASE_UPDATE: return "update";
+    case PHASE_RENDER: return "render";
+    case PHASE_SHOW: return "imshow";
+    case PHASE_MENU: return "menu";
+    case PHASE_FRAME: return "frame";
+    case PHASE_COUNT: break;
+    }
+    return "?";
+}
+
+FrameProfiler::FrameProfiler() : trace(TRACE_CAPACITY), traceCount(0), tracing(false), overlayVisible(false), origin(Clock::now()) {
+    reset();
+}
+
+void FrameProfiler::reset() {
+    for (LatencyHistogram& histogram : histograms) histogram.reset();
+    for (TripleBuffer<LatencyHistogram>& snapshot : snapshots) {
+        for (int i = 0; i < 3; ++i) snapshot.slotAt(i).reset();
+    }
+    traceCount = 0;
+}
+
+void FrameProfiler::record(ProfilePhase phase, int64_t startNs, int64_t endNs) {
+    int64_t ns = endNs - startNs;
+    histograms[phase].record(ns);
+    // A new copy once the overlay has taken the last one: at most one per overlay refresh
+    TripleBuffer<LatencyHistogram>& snapshot = snapshots[phase];
+    if (!snapshot.isFresh()) {
+        snapshot.writeSlot() = histograms[phase];
+        snapshot.publish();
+    }
+    if (tracing) {
+        TraceEvent& event = trace[traceCount.fetch_add(1, std::memory_order_relaxed) % TRACE_CAPACITY];
+        event.startNs = startNs;
+        event.durationNs = ns;
+        event.phase = phase;
+    }
+}
+
+FrameProfiler::PhaseStats FrameProfiler::getStats(ProfilePhase phase) const {
+    const LatencyHistogram& histogram = histograms[phase];
+    PhaseStats stats;
+    stats.count = histogram.getCount();
+    stats.meanUs = histogram.meanUs();
+    stats.p50Us = histogram.percentileUs(0.50);
+    stats.p99Us = histogram.percentileUs(0.99);
+    stats.maxUs = histogram.maxUs();
+    return stats;
+}
+
+bool FrameProfiler::exportCsv(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) return false;
+    file << "phase,lower_us,upper_us,count\n";
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        for (int b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+            uint64_t count = histograms[p].getBucket(b);
+            if (count == 0) continue;
+            file << profilePhaseName((ProfilePhase)p) << ',' << LatencyHistogram::bucketLowerNs(b) / 1000.0 << ',' << LatencyHistogram::bucketUpperNs(b) / 1000.0 << ',' << count << '\n';
+        }
+    }
+    return true;
+}
+
+bool FrameProfiler::exportChromeTrace(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) return false;
+    // Complete ("X") events in microseconds, one track per thread: the frame phase has its own
+    // track so the main loop phases nest under it; update and render run on their own threads
+    static const int tracks[PHASE_COUNT] = { 2, 3, 4, 2, 2, 1 };
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t recorded = traceCount.load();
+    size_t first = recorded > TRACE_CAPACITY ? recorded - TRACE_CAPACITY : 0;
+    file << std::fixed << std::setprecision(3);
+    for (size_t i = first; i < recorded; ++i) {
+        const TraceEvent& event = trace[i % TRACE_CAPACITY];
+        file << (i == first ? "" : ",\n")
+            << "{\"name\":\"" << profilePhaseName((ProfilePhase)event.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tracks[event.phase]
+            << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+    }
+    file << "\n]}\n";
+    return true;
+}
+
+void FrameProfiler::printSummary(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        PhaseStats stats = getStats((ProfilePhase)p);
+        if (stats.count == 0) continue;
+        out << std::setw(7) << profilePhaseName((ProfilePhase)p) << ": " << stats.count << " x"
+            << "  mean " << stats.meanUs << " us  p50 " << stats.p50Us << " us  p99 " << stats.p99Us << " us  max " << stats.maxUs << " us" << std::endl;
+    }
+}
+
+void FrameProfiler::drawOverlay(cv::Mat& frame) {
+    static const ProfilePhase shown[] = { PHASE_FRAME, PHASE_INPUT, PHASE_UPDATE, PHASE_RENDER, PHASE_SHOW, PHASE_MENU };
+    int y = frame.rows - 12 - 16 * (int)(sizeof(shown) / sizeof(shown[0]) - 1);
+    cv::rectangle(frame, cv::Rect(frame.cols - 250, y - 16, 250, frame.rows - y + 16), cv::Scalar(0, 0, 0), cv::FILLED);
+    for (ProfilePhase phase : shown) {
+        snapshots[phase].take();
+        const LatencyHistogram& histogram = snapshots[phase].readSlot();
+        char line[64];
+        snprintf(line, sizeof(line), "%-7s p50 %6.2f  p99 %6.2f ms", profilePhaseName(phase), histogram.percentileUs(0.50) / 1000.0, histogram.percentileUs(0.99) / 1000.0);
+        putText(frame, line, cv::Point(frame.cols - 245, y), cv::FONT_HERSHEY_PLAIN, 0.9, cv::Scalar(255, 255, 255), 1);
+        y += 16;
+    }
+}
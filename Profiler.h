@@ -0,0 +1,97 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "LatencyHistogram.h"
+#include "TripleBuffer.h"
+
+const std::string PROFILE_CSV_FILE = "profile.csv";
+const std::string PROFILE_TRACE_FILE = "profile_trace.json";
+
+// Stages of one pass of the main loop
+enum ProfilePhase { PHASE_INPUT, PHASE_UPDATE, PHASE_RENDER, PHASE_SHOW, PHASE_MENU, PHASE_FRAME, PHASE_COUNT };
+
+// Per-phase timing of the main loop.
+// Every measurement goes into a LatencyHistogram and, while tracing, into a
+// fixed ring of the most recent events for a Chrome trace. Recording is two clock
+// reads and a few array writes, plus a histogram copy per overlay refresh; nothing
+// is allocated after construction.
+// Phases may be timed on different threads, as long as each phase stays on one.
+// The overlay, drawn while they record, reads copies of the histograms each phase's
+// thread publishes through a TripleBuffer; the stats, summary and exports read the
+// histograms themselves and are for when the other threads have stopped.
+class FrameProfiler
+{
+public:
+    static const size_t TRACE_CAPACITY = 1 << 16;
+
+    struct PhaseStats {
+        int64_t count;
+        double meanUs;
+        double p50Us;
+        double p99Us;
+        double maxUs;
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct TraceEvent {
+        int64_t startNs;
+        int64_t durationNs;
+        int phase;
+    };
+
+    std::array<LatencyHistogram, PHASE_COUNT> histograms;      // written by the thread timing the phase only
+    std::array<TripleBuffer<LatencyHistogram>, PHASE_COUNT> snapshots;     // copies for the overlay
+    std::vector<TraceEvent> trace;      // ring buffer, TRACE_CAPACITY events
+    std::atomic<size_t> traceCount;     // events recorded; the ring holds the last TRACE_CAPACITY
+    bool tracing;
+    bool overlayVisible;
+    Clock::time_point origin;
+
+public:
+    FrameProfiler();
+
+    int64_t now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count(); }
+    void record(ProfilePhase phase, int64_t startNs, int64_t endNs);
+
+    PhaseStats getStats(ProfilePhase phase) const;
+    // While nothing is recording
+    void reset();
+
+    void setTracing(bool enabled) { tracing = enabled; }
+    bool isTracing() const { return tracing; }
+
+    // Histograms as "phase,lower_us,upper_us,count" rows (non-empty buckets only)
+    bool exportCsv(const std::string& fileName) const;
+    // Recorded events in the Chrome trace-event format (chrome://tracing, Perfetto)
+    bool exportChromeTrace(const std::string& fileName) const;
+    void printSummary(std::ostream& out) const;
+
+    void toggleOverlay() { overlayVisible = !overlayVisible; }
+    bool isOverlayVisible() const { return overlayVisible; }
+    void drawOverlay(cv::Mat& frame);
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+// Times the enclosing block as one phase
+class ProfileScope
+{
+private:
+    FrameProfiler& profiler;
+    ProfilePhase phase;
+    int64_t start;
+
+public:
+    ProfileScope(FrameProfiler& profiler, ProfilePhase phase) : profiler(profiler), phase(phase), start(profiler.now()) {}
+    ~ProfileScope() { profiler.record(phase, start, profiler.now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
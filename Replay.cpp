@@ -0,0 +1,231 @@
+#include "Replay.h"
+#include "GameLoop.h"
+#include "WorkStealingPool.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+// FNV-1a over the obstacle cells: identifies the map a game was played on
+uint64_t mapContentHash(const Map& map) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char cell : map.getMap()) {
+        hash = (hash ^ cell) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static inline uint64_t mixHash(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+// O(1) per tick: the rng state covers every random draw, the rest covers what the player sees
+uint32_t replayStateHash(const SnakeCore& game) {
+    SnakePoint head = game.getSnake().front();
+    uint64_t hash = game.getRngState();
+    hash = mixHash(hash, ((uint64_t)(uint32_t)head.x << 32) | (uint32_t)head.y);
+    hash = mixHash(hash, game.getSnake().size());
+    hash = mixHash(hash, ((uint64_t)game.getDirection() << 32) | (uint32_t)game.getHearts());
+    hash = mixHash(hash, ((uint64_t)(uint32_t)game.getApple().x << 32) | (uint32_t)game.getApple().y);
+    hash = mixHash(hash, ((uint64_t)(uint32_t)game.getSpecialApple().x << 32) | (uint32_t)game.getSpecialApple().y);
+    hash = mixHash(hash, ((uint64_t)(uint32_t)game.getPinkApple().x << 32) | (uint32_t)game.getPinkApple().y);
+    hash = mixHash(hash, (game.isGameOver() ? 2 : 0) | (game.isSnakeInvincible() ? 1 : 0));
+    if (game.isSnakeInvincible()) {
+        hash = mixHash(hash, (uint64_t)(game.getInvincibilityEndTime() - game.now()));
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+ReplayRecording::ReplayRecording() : mapHash(0), rows(0), cols(0), seed(0), startTime(0), lastTime(0), lastStep(0), score(0) {}
+
+void ReplayRecording::begin(const SnakeCore& game) {
+    mapFile = game.map.getMapFile();
+    mapHash = mapContentHash(game.map);
+    rows = game.map.getRows();
+    cols = game.map.getCols();
+    seed = game.getSeed();
+    startTime = game.now();
+    lastTime = startTime;
+    lastStep = 0;
+    score = 0;
+    events.clear();
+    hashes.clear();
+}
+
+void ReplayRecording::addEvent(ReplayEventType type, uint32_t value) {
+    ReplayEvent event;
+    event.tick = (uint32_t)hashes.size();
+    event.value = value;
+    event.type = (uint8_t)type;
+    events.push_back(event);
+}
+
+void ReplayRecording::beforeUpdate(const SnakeCore& game) {
+    // The tick length only changes with the speed, so it is stored as an event, not per tick
+    int64_t time = game.now();
+    if (time - lastTime != lastStep) {
+        lastStep = time - lastTime;
+        addEvent(REPLAY_STEP, (uint32_t)lastStep);
+    }
+    lastTime = time;
+}
+
+void ReplayRecording::afterUpdate(const SnakeCore& game) {
+    hashes.push_back(replayStateHash(game));
+    score = game.getScore();
+}
+
+std::string ReplayRecording::serialize() const {
+    ReplayHeader header;
+    memcpy(header.magic, SREC_MAGIC, 4);
+    header.version = SREC_VERSION;
+    header.headerSize = sizeof(ReplayHeader);
+    header.seed = seed;
+    header.startTime = startTime;
+    header.mapHash = mapHash;
+    header.rows = (uint32_t)rows;
+    header.cols = (uint32_t)cols;
+    header.mapNameLength = (uint32_t)mapFile.size();
+    header.eventCount = (uint32_t)events.size();
+    header.tickCount = (uint32_t)hashes.size();
+    header.score = (uint32_t)score;
+
+    std::string data;
+    data.reserve(sizeof(header) + mapFile.size() + events.size() * sizeof(ReplayEvent) + hashes.size() * sizeof(uint32_t));
+    data.append((const char*)&header, sizeof(header));
+    data.append(mapFile);
+    data.append((const char*)events.data(), events.size() * sizeof(ReplayEvent));
+    data.append((const char*)hashes.data(), hashes.size() * sizeof(uint32_t));
+    return data;
+}
+
+bool ReplayRecording::load(const std::string& fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ReplayHeader header;
+    if (data.size() < sizeof(header)) return false;
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, SREC_MAGIC, 4) != 0 || header.version != SREC_VERSION || header.headerSize < sizeof(header)) {
+        return false;
+    }
+    size_t eventBytes = (size_t)header.eventCount * sizeof(ReplayEvent);
+    size_t hashBytes = (size_t)header.tickCount * sizeof(uint32_t);
+    if (data.size() < header.headerSize + header.mapNameLength + eventBytes + hashBytes) return false;
+
+    const char* p = data.data() + header.headerSize;
+    mapFile.assign(p, header.mapNameLength);
+    p += header.mapNameLength;
+    events.resize(header.eventCount);
+    memcpy(events.data(), p, eventBytes);
+    p += eventBytes;
+    hashes.resize(header.tickCount);
+    memcpy(hashes.data(), p, hashBytes);
+
+    seed = header.seed;
+    startTime = header.startTime;
+    mapHash = header.mapHash;
+    rows = (int)header.rows;
+    cols = (int)header.cols;
+    score = header.score;
+    lastTime = startTime;
+    lastStep = 0;
+    return true;
+}
+
+ReplayResult replayGame(const ReplayRecording& recording, const Map& map, std::function<void(SnakeCore&)> onTick) {
+    ReplayResult result;
+    result.loaded = true;
+    result.mapMatches = map.getRows() == recording.getRows() && map.getCols() == recording.getCols() && mapContentHash(map) == recording.getMapHash();
+    result.ticks = 0;
+    result.firstMismatch = -1;
+    result.score = 0;
+    result.seconds = 0;
+    if (!result.mapMatches) return result;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Same clock as the game loop: it moves by one recorded step before each update
+    int64_t time = recording.getStartTime();
+    int64_t step = 0;
+    SnakeCore game(map, recording.getSeed());
+    game.setTickSource([&time]() { return time; }, (double)FixedStepClock::TIME_FREQUENCY);
+    game.newGame(recording.getSeed());
+
+    const std::vector<ReplayEvent>& events = recording.getEvents();
+    const std::vector<uint32_t>& hashes = recording.getHashes();
+    size_t nextEvent = 0;
+    for (size_t tick = 0; tick < hashes.size(); ++tick) {
+        for (; nextEvent < events.size() && events[nextEvent].tick == tick; ++nextEvent) {
+            const ReplayEvent& event = events[nextEvent];
+            switch (event.type) {
+            case REPLAY_KEY: game.changeDirection((int)event.value); break;
+            case REPLAY_STEP: step = event.value; break;
+            case REPLAY_SUPERPOWER: game.activateSuperPower(); break;
+            }
+        }
+        time += step;
+        game.update();
+        result.ticks++;
+        if (onTick) onTick(game);
+        if (replayStateHash(game) != hashes[tick]) {
+            result.firstMismatch = (int64_t)tick;
+            break;
+        }
+    }
+
+    result.score = game.getScore();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+ReplayResult replayFile(const std::string& fileName) {
+    ReplayRecording recording;
+    ReplayResult result;
+    if (!recording.load(fileName)) {
+        result.loaded = false;
+        result.mapMatches = false;
+        result.ticks = 0;
+        result.firstMismatch = -1;
+        result.score = 0;
+        result.seconds = 0;
+    }
+    else {
+        Map map(recording.getRows(), recording.getCols(), recording.getMapFile());
+        map.load();
+        result = replayGame(recording, map);
+    }
+    result.fileName = fileName;
+    return result;
+}
+
+int replayFiles(const std::vector<std::string>& fileNames, int threads, std::ostream& out) {
+    std::vector<ReplayResult> results(fileNames.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads > 0 ? (size_t)threads : 0);
+        pool.parallelFor(fileNames.size(), [&](size_t i) {
+            results[i] = replayFile(fileNames[i]);
+        });
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    int64_t totalTicks = 0;
+    for (const ReplayResult& r : results) {
+        totalTicks += r.ticks;
+        out << r.fileName << ": ";
+        if (!r.loaded) out << "FAILED (not a recording)";
+        else if (!r.mapMatches) out << "FAILED (map changed)";
+        else if (r.firstMismatch != -1) out << "FAILED (state differs at tick " << r.firstMismatch << ")";
+        else out << "ok, " << r.ticks << " ticks, score " << r.score;
+        out << std::endl;
+        if (!r.passed()) failed++;
+    }
+    out << results.size() - failed << "/" << results.size() << " replays passed"
+        << "  wall: " << std::fixed << std::setprecision(2) << wallSeconds << " s"
+        << "  ticks/s: " << std::setprecision(0) << (wallSeconds > 0 ? totalTicks / wallSeconds : 0.0) << std::endl;
+    return failed;
+}
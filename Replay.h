@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Map.h"
+#include "SnakeCore.h"
+
+// Recorded game file (.srec), little-endian:
+//   ReplayHeader, map file name, events, then one 32-bit state hash per tick
+#define SREC_MAGIC "SNKR"
+#define SREC_VERSION 3    // 2: apples are placed by row-major free-cell rank, 3: only in the spawn region
+
+enum ReplayEventType { REPLAY_KEY, REPLAY_STEP, REPLAY_SUPERPOWER };
+
+#pragma pack(push, 1)
+struct ReplayHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t seed;
+    int64_t startTime;      // tick source time when the game started
+    uint64_t mapHash;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t mapNameLength;
+    uint32_t eventCount;
+    uint32_t tickCount;
+    uint32_t score;
+};
+
+// Happens before update number `tick` of the game (0 = before the first one)
+struct ReplayEvent {
+    uint32_t tick;
+    uint32_t value;     // key for REPLAY_KEY, tick source time per tick for REPLAY_STEP
+    uint8_t type;
+};
+#pragma pack(pop)
+
+uint64_t mapContentHash(const Map& map);
+uint32_t replayStateHash(const SnakeCore& game);
+
+// Everything needed to play a game again: the seed, the map, and the inputs.
+// Recording costs a push_back per tick; inputs and speed changes are rare.
+class ReplayRecording {
+private:
+    std::string mapFile;
+    uint64_t mapHash;
+    int rows, cols;
+    uint64_t seed;
+    int64_t startTime;
+    int64_t lastTime;
+    int64_t lastStep;
+    size_t score;
+    std::vector<ReplayEvent> events;
+    std::vector<uint32_t> hashes;
+
+    void addEvent(ReplayEventType type, uint32_t value);
+
+public:
+    ReplayRecording();
+
+    // Call after game.newGame(seed), before its first update
+    void begin(const SnakeCore& game);
+    void recordKey(int key) { addEvent(REPLAY_KEY, (uint32_t)key); }
+    void recordSuperPower() { addEvent(REPLAY_SUPERPOWER, 0); }
+    void beforeUpdate(const SnakeCore& game);   // after the tick source moved for this tick
+    void afterUpdate(const SnakeCore& game);
+
+    bool empty() const { return hashes.empty(); }
+    size_t getTickCount() const { return hashes.size(); }
+    const std::string& getMapFile() const { return mapFile; }
+    uint64_t getMapHash() const { return mapHash; }
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+    uint64_t getSeed() const { return seed; }
+    int64_t getStartTime() const { return startTime; }
+    size_t getScore() const { return score; }
+    const std::vector<ReplayEvent>& getEvents() const { return events; }
+    const std::vector<uint32_t>& getHashes() const { return hashes; }
+
+    std::string serialize() const;
+    bool load(const std::string& fileName);
+};
+
+struct ReplayResult {
+    std::string fileName;
+    bool loaded;
+    bool mapMatches;
+    int64_t ticks;              // ticks replayed
+    int64_t firstMismatch;      // first tick whose state hash differs, -1 if none
+    size_t score;
+    double seconds;
+
+    bool passed() const { return loaded && mapMatches && firstMismatch == -1; }
+};
+
+// Plays the recording headless, as fast as the core goes, checking every tick; onTick sees the game after each update
+ReplayResult replayGame(const ReplayRecording& recording, const Map& map, std::function<void(SnakeCore&)> onTick = nullptr);
+ReplayResult replayFile(const std::string& fileName);
+
+// Regression suite: every file replayed in parallel; returns the number that failed
+int replayFiles(const std::vector<std::string>& fileNames, int threads, std::ostream& out);
@@ -0,0 +1,130 @@
+#include "ScoreStore.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+bool Leaderboard::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    // One read of the whole file, then parse from memory
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    boards.clear();
+
+    std::istringstream lines(contents);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        ScoreEntry entry;
+        std::istringstream fields(line.substr(tab + 1));
+        if (fields >> entry.score >> entry.length >> entry.ticks >> entry.timestamp >> entry.seed) {
+            submit(line.substr(0, tab), entry);
+        }
+    }
+    return true;
+}
+
+std::string Leaderboard::serialize() const {
+    std::ostringstream out;
+    for (const auto& board : boards) {
+        for (const ScoreEntry& e : board.second) {
+            out << board.first << '\t' << e.score << '\t' << e.length << '\t' << e.ticks << '\t' << e.timestamp << '\t' << e.seed << '\n';
+        }
+    }
+    return out.str();
+}
+
+int Leaderboard::submit(const std::string& mapName, const ScoreEntry& entry) {
+    std::vector<ScoreEntry>& board = boards[mapName];
+    auto position = std::upper_bound(board.begin(), board.end(), entry,
+        [](const ScoreEntry& a, const ScoreEntry& b) { return a.score > b.score; });
+    size_t rank = position - board.begin();
+    if (rank >= capacity) return -1;
+    board.insert(position, entry);
+    if (board.size() > capacity) board.pop_back();
+    return (int)rank;
+}
+
+size_t Leaderboard::best(const std::string& mapName) const {
+    auto board = boards.find(mapName);
+    return board == boards.end() || board->second.empty() ? 0 : board->second.front().score;
+}
+
+const std::vector<ScoreEntry>& Leaderboard::entries(const std::string& mapName) const {
+    static const std::vector<ScoreEntry> none;
+    auto board = boards.find(mapName);
+    return board == boards.end() ? none : board->second;
+}
+
+bool writeFileAtomically(const std::string& path, const std::string& contents) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(contents.data(), contents.size());
+        file.flush();
+        if (!file) return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+}
+
+FileWriter::FileWriter(const std::string& path) : path(path), hasPending(false), writing(false), stopping(false) {
+    worker = std::thread(&FileWriter::run, this);
+}
+
+FileWriter::~FileWriter() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    worker.join();
+}
+
+void FileWriter::post(const std::string& contents) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = contents; // Replaces anything not written yet
+        hasPending = true;
+    }
+    wakeUp.notify_one();
+}
+
+void FileWriter::flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [&] { return !hasPending && !writing; });
+}
+
+void FileWriter::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wakeUp.wait(guard, [&] { return hasPending || stopping; });
+        if (hasPending) {
+            std::string contents;
+            contents.swap(pending);
+            hasPending = false;
+            writing = true;
+            guard.unlock();
+            if (!writeFileAtomically(path, contents)) {
+                std::cerr << "Could not save " << path << std::endl;
+            }
+            guard.lock();
+            writing = false;
+        }
+        idle.notify_all();
+        if (stopping && !hasPending) return;
+    }
+}
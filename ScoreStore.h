@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ScoreEntry {
+    size_t score;
+    size_t length;
+    int64_t ticks;
+    int64_t timestamp;  // unix time the game ended
+    uint64_t seed;
+};
+
+// Top-N scores per map, kept sorted best first.
+// Stored as text, one "map<TAB>score<TAB>length<TAB>ticks<TAB>timestamp<TAB>seed" line per entry.
+class Leaderboard {
+private:
+    std::map<std::string, std::vector<ScoreEntry>> boards;
+    size_t capacity;
+
+public:
+    Leaderboard(size_t capacity = 10) : capacity(capacity) {}
+
+    // Whole file in one read; false if it does not exist
+    bool load(const std::string& path);
+    std::string serialize() const;
+
+    // Returns the rank (0 = best) the entry got, or -1 if it did not make the top N
+    int submit(const std::string& mapName, const ScoreEntry& entry);
+
+    size_t best(const std::string& mapName) const;
+    const std::vector<ScoreEntry>& entries(const std::string& mapName) const;
+    bool empty() const { return boards.empty(); }
+};
+
+// Write-behind file writer. post() only hands the new contents to a background
+// thread and returns; posts that arrive before the thread gets to them are
+// coalesced, so only the latest contents are written. Every write goes to a
+// temporary file that is then renamed over the target, so the file is never
+// seen half-written.
+class FileWriter {
+private:
+    std::string path;
+    std::string pending;
+    bool hasPending;
+    bool writing;
+    bool stopping;
+    std::mutex lock;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+    std::thread worker;
+
+    void run();
+
+public:
+    explicit FileWriter(const std::string& path);
+    ~FileWriter();      // writes whatever is still pending
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    void post(const std::string& contents);
+    void flush();       // wait until everything posted so far is on disk
+};
+
+bool writeFileAtomically(const std::string& path, const std::string& contents);
@@ -1,109 +1,61 @@
 #include "Snake.h"
+#include <ctime>
 
 int SnakeGame::getWindowWidth() {
-    return this->map.getCols() * this->cell_size;
+    return std::min(this->map.getCols(), MAX_VIEW_COLS) * this->cell_size;
 }
 int SnakeGame::getWindowHeigth() {
-    return this->map.getRows() * this->cell_size;
+    return std::min(this->map.getRows(), MAX_VIEW_ROWS) * this->cell_size;
 }
 
-SnakeGame::SnakeGame() : dir(RIGHT), gameOver(false), gameScore(0), highScore(0), isPaused(false), numHearts(1), normalSpeed(100), map(this->map_height, this->mao_width, std::string("map.txt"))
-{
+static Map loadGameMap() {
+    Map map(mapHeight, mapWidth, mapFileName);
     map.load();
-    snake.push_back(SnakePoint(this->map.getCols() / 2,  this->map.getRows() / 2));
-    srand((unsigned)time(0));
-    placeApple();
-    specialApple = SnakePoint(-1, -1);
-    pinkApple = SnakePoint(-1, -1);
+    return map;
+}
+
+SnakeGame::SnakeGame() : SnakeCore(loadGameMap(), (uint64_t)time(0)), normalSpeed(10), superPowerActive(false), renderer(CELL_SIZE), leaderboard(LEADERBOARD_SIZE), scoreWriter(LEADERBOARD_FILE), replayWriter(LAST_GAME_FILE), streamWriter(LAST_STREAM_FILE), autopilotEnabled(false)
+{
+    setTickSource([]() { return (int64_t)cv::getTickCount(); }, cv::getTickFrequency());
     loadHighScore();
 }
 
 SnakeGame::~SnakeGame() {}
 
-void SnakeGame::update(int& snakeSpeed) {
+void SnakeGame::update(int& ticksPerSecond) {
     if (gameOver) return;
 
-    if (cv::getTickCount() > invincibilityEndTime) {
-        snakeSpeed = this->normalSpeed; // Reset speed back to normal after superpower ends
-    }
-
-    if (isInvincible && cv::getTickCount() > invincibilityEndTime) {
-        isInvincible = false;
-    }
-
-    // The next head position (direction) based on the pressed key
-    SnakePoint head = snake.front();
-    switch (dir) {
-    case UP: head.y -= 1; break;
-    case DOWN: head.y += 1; break;
-    case LEFT: head.x -= 1; break;
-    case RIGHT: head.x += 1; break;
-    }
-
-    if (isInvincible) {
-        if (head.x < 0) {
-            head.x = this->map.getCols() - 1; // Teleport to the right
-        }
-        else if (head.x >= this->map.getCols()) {
-            head.x = 0; // Teleport to the left
-        }
-       
-        if (head.y < 0) {
-            head.y =  this->map.getRows() - 1; // Teleport to the bottom
-        }
-        else if (head.y >=  this->map.getRows()) {
-            head.y = 0; // Teleport to the top
-        }
-    }
-    else if (isCollision(head)) {
-        loseHeart();
-        return;
+    if (superPowerActive && now() > invincibilityEndTime) {
+        ticksPerSecond = this->normalSpeed; // Reset speed back to normal after superpower ends
+        superPowerActive = false;
     }
 
-    snake.push_front(head);
-
-    if (head.x == apple.x && head.y == apple.y) {
-        placeApple();
-        //gameScore++;
-
-        if (specialApple.x == -1 && specialApple.y == -1) {
-            placeSpecialApple();
-        }
-        if (pinkApple.x == -1 && pinkApple.y == -1) {
-            placePinkApple();
-        }
-    }
-    else if (head.x == specialApple.x && head.y == specialApple.y) {
-        //gameScore++;
-        isInvincible = true;
-        invincibilityEndTime = cv::getTickCount() + INVINCIBILITY_DURATION * cv::getTickFrequency();
-        placeSpecialApple();
-    }
-    else if (head.x == pinkApple.x && head.y == pinkApple.y) {
-        //gameScore++;
-        if (numHearts < MAX_HARTS) {
-            numHearts++;
-        }
-        placePinkApple();
+    int key;
+    if (autopilotEnabled) {
+        turns.clear(); // the planner steers
+        key = autopilot.plan(*this);
     }
     else {
-        snake.pop_back();
+        key = turns.next(dir);
     }
+    if (key != -1) changeDirection(key);
 
-    gameScore = (int)snake.size() - (int)1;
-    if (gameScore > highScore) {
-        highScore = gameScore;
-        saveHighScore();
+    recording.beforeUpdate(*this);
+    SnakeCore::update();
+    recording.afterUpdate(*this);
+    stateStream.encode(*this);
+    if (gameOver) {
+        saveHighScore(); // Once per game, and the file is written by the background writer
+        replayWriter.post(recording.serialize());
+        streamWriter.post(stateStream.serialize());
     }
-
 }
 
 void SnakeGame::changeDirection(int key) {
-    switch (tolower(key)) {
-    case 'w': if (dir != DOWN) dir = UP; break;
-    case 'a': if (dir != RIGHT) dir = LEFT; break;
-    case 's': if (dir != UP) dir = DOWN; break;
-    case 'd': if (dir != LEFT) dir = RIGHT; break;
+    Direction previous = dir;
+    SnakeCore::changeDirection(key);
+    if (dir != previous) {
+        recording.recordKey(key);
     }
 }
 
@@ -112,108 +64,71 @@ void SnakeGame::drawCell(cv::Mat& frame, int x, int y, cv::Scalar color) {
 }
 
 void SnakeGame::render(cv::Mat& frame) {
-    frame = cv::Scalar(0, 0, 0);
-    cv::Scalar snakeColor = isInvincible ? cv::Scalar(0, 255, 255) : cv::Scalar(0, 255, 0);
+    renderState(renderer, *this, frame, autopilotEnabled ? (int)autopilot.getStats().lastUs : -1);
+}
 
-    this->map.draw(frame, cv::Scalar(50, 75, 0), this->cell_size);
-    if (gameOver) {
-        putText(frame, "Game Over", cv::Point(windowWidth / 3, windowHeight / 2), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+// Reads the state only: the game's invincibility ends on its own clock, not when the counter shows 0
+void SnakeGame::renderState(SnakeRenderer& renderer, SnakeCore& state, cv::Mat& frame, int autopilotUs) {
+    if (state.isGameOver()) {
+        renderer.renderBackground(state.map, frame);
+        putText(frame, state.isBoardFull() ? "Board Full!" : "Game Over", cv::Point(windowWidth / 3, windowHeight / 2), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 0, 255), 2);
         return;
     }
 
-    // "Drawing" the snake body
-    for (auto& segment : snake) {
-        this->drawCell(frame, segment.x, segment.y, snakeColor);
-        //rectangle(frame, cv::Rect(segment.x, segment.y, CELL_SIZE, CELL_SIZE), snakeColor, cv::FILLED);
-    }
-
-    // "Drawing" the red apple
-    this->drawCell(frame, apple.x, apple.y, cv::Scalar(0, 0, 255));
-    //rectangle(frame, cv::Rect(apple.x, apple.y, CELL_SIZE, CELL_SIZE), cv::Scalar(0, 0, 255), cv::FILLED);
-
-    // "Drawing" the golden apple
-    if (specialApple.x != -1 && specialApple.y != -1) {
-        this->drawCell(frame, specialApple.x, specialApple.y, cv::Scalar(0, 255, 255));
-        //rectangle(frame, cv::Rect(specialApple.x, specialApple.y, CELL_SIZE, CELL_SIZE), cv::Scalar(0, 255, 255), cv::FILLED);
-    }
-
-    // "Drawing" the pink apple
-    if (pinkApple.x != -1 && pinkApple.y != -1) {
-        this->drawCell(frame, pinkApple.x, pinkApple.y, cv::Scalar(255, 105, 180));
-        //rectangle(frame, cv::Rect(pinkApple.x, pinkApple.y, CELL_SIZE, CELL_SIZE), cv::Scalar(255, 105, 180), cv::FILLED);
-    }
+    // Snake, apples and obstacles: only the cells that changed since the last frame are repainted
+    renderer.render(state, frame);
 
     // Drawing hearts
-    for (int i = 0; i < numHearts; i++) {
+    for (int i = 0; i < state.getHearts(); i++) {
         cv::Point heartPos(10 + i * 30, 50);
         drawHeart(frame, heartPos);
     }
 
-    putText(frame, ("Score: " + std::to_string(gameScore)), cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    putText(frame, ("HighScore: " + std::to_string(highScore)), cv::Point(windowWidth - 160, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 255, 255), 2);
+    putText(frame, ("Score: " + std::to_string(state.getScore())), cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
+    putText(frame, ("HighScore: " + std::to_string(state.getHighScore())), cv::Point(windowWidth - 160, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 255, 255), 2);
+
+    if (autopilotUs >= 0) {
+        putText(frame, "Autopilot " + std::to_string(autopilotUs) + " us", cv::Point(windowWidth - 200, windowHeight - 30), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+    }
 
-    if (isInvincible) {
-        int remainingTime = static_cast<int>((invincibilityEndTime - cv::getTickCount()) / cv::getTickFrequency());
+    if (state.isSnakeInvincible()) {
+        int remainingTime = static_cast<int>((state.getInvincibilityEndTime() - state.now()) / state.getTickFrequency());
         if (remainingTime > 0) {
             putText(frame, "Invincible: " + std::to_string(remainingTime) + "s",
                 cv::Point(10, windowHeight - 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 255), 2);
         }
-        else {
-            isInvincible = false; // Deactivate the shown time
-        }
     }
-
 }
 
 void SnakeGame::resetGame() {
-    snake.clear();
-    snake.push_back(SnakePoint(this->map.getCols() / 2,  this->map.getRows() / 2));
-    gameOver = false;
-    gameScore = 0;
-    dir = RIGHT;
-    numHearts = MAX_HARTS;
-    isInvincible = false;
+    superPowerActive = false;
     this->map.load();
-    placeApple();
+    newGame(rng.next()); // Every game gets its own seed, so it can be recorded and replayed
+    recording.begin(*this);
+    stateStream.begin(*this);
+    turns.clear();
+    autopilot.reset();
 }
 
 void SnakeGame::loadHighScore() {
-    std::ifstream file(HIGH_SCORE_FILE);
-    if (file.is_open()) {
-        if (!(file >> highScore)) { // load the highscore value in the program
-            highScore = 0;
-        }
-        else {
-            std::cout << "Error HIGH_SCORE_FILE" << std::endl;
+    if (!leaderboard.load(LEADERBOARD_FILE)) {
+        // First start with the leaderboard: the old high score goes to the current map
+        std::ifstream file(HIGH_SCORE_FILE);
+        size_t oldHighScore;
+        if (file.is_open() && file >> oldHighScore && oldHighScore > 0) {
+            ScoreEntry entry = { oldHighScore, oldHighScore + 1, 0, 0, 0 };
+            leaderboard.submit(this->map.getMapFile(), entry);
+            scoreWriter.post(leaderboard.serialize());
         }
     }
-
+    highScore = leaderboard.best(this->map.getMapFile());
 }
 
+// Adds the finished game to the leaderboard of its map; does not wait for the disk
 void SnakeGame::saveHighScore() {
-    std::ofstream file(HIGH_SCORE_FILE);
-
-    if (file.is_open()) {
-        file << highScore; // save the highscore in the text file
-        file.close();
-    }
-    else {
-        std::cout << "\nNu s-a putut deschide fisierulul pentru SALVARE!" << std::endl;
-    }
-}
-
-void SnakeGame::loseHeart() {
-    if (isInvincible) {
-        return; // not losing hearts
-    }
-
-    numHearts--;
-    if (numHearts <= 0) {
-        gameOver = true;
-    }
-    else {
-        isInvincible = true;
-        invincibilityEndTime = cv::getTickCount() + INVINCIBILITY_DURATION * cv::getTickFrequency();
+    ScoreEntry entry = { gameScore, snake.size(), tickCount, (int64_t)time(0), seed };
+    if (leaderboard.submit(this->map.getMapFile(), entry) >= 0) {
+        scoreWriter.post(leaderboard.serialize());
     }
 }
 
@@ -225,88 +140,11 @@ void SnakeGame::drawHeart(cv::Mat& frame, cv::Point position) {
     polylines(frame, heart, true, cv::Scalar(255, 105, 180), 2);
 }
 
-bool SnakeGame::isAppleOnSnake(int x, int y) {
-    for (auto segment : snake) {
-        if (segment.x == x && segment.y == y) {
-            return true;
-        }
-    }
-    return false;
-}
-
-void SnakeGame::buyLife() {
-    if (highScore >= 5 && numHearts < MAX_HARTS) {
-        numHearts++;
-        highScore -= 5;
-    }
-}
-
-void SnakeGame::buySuperPower(int& snakeSpeed) {
-    if (numHearts > SUPERPOWER_HARTS_PRICE) {
-        snakeSpeed = snakeSpeed - (int)((float)snakeSpeed * 0.3f);
-        isInvincible = true;
-        invincibilityEndTime = cv::getTickCount() + SUPERPOWER_DURATION * cv::getTickFrequency();
-        numHearts -= SUPERPOWER_HARTS_PRICE;
-    }
-}
-
-
-
-
-void SnakeGame::placeApple() {
-    srand(time(0));
-    int x, y;
-    do {
-        x = (rand() % this->map.getCols());
-        y = (rand() % this->map.getRows());
-    } while (this->isCollision(SnakePoint{ x, y }) || (x == apple.x && y == apple.y) || (x == pinkApple.x && y == pinkApple.y));
-    apple.x = x;
-    apple.y = y;
-}
-
-void SnakeGame::placeSpecialApple() {
-    if (rand() % 100 >= 50) { // 50% to respawn
-        specialApple.x = -1;
-        specialApple.y = -1;
-        return;
+void SnakeGame::buySuperPower(int& ticksPerSecond) {
+    if (activateSuperPower()) {
+        recording.recordSuperPower();
+        this->normalSpeed = ticksPerSecond;
+        ticksPerSecond = (int)((float)ticksPerSecond / 0.7f); // 30% shorter ticks
+        superPowerActive = true;
     }
-
-    int x, y;
-    do {
-        x = (rand() % this->map.getCols());
-        y = (rand() %  this->map.getRows());
-    } while (this->isCollision(SnakePoint{ x, y }) || (x == apple.x && y == apple.y) || (x == pinkApple.x && y == pinkApple.y));
-    specialApple.x = x;
-    specialApple.y = y;
 }
-
-void SnakeGame::placePinkApple() {
-    if (rand() % 100 >= 20) { // 20% to respawn
-        pinkApple.x = -1;
-        pinkApple.y = -1;
-        return;
-    }
-
-    int x, y;
-    do {
-        x = (rand() % this->map.getCols());
-        y = (rand() %  this->map.getRows());
-    } while (this->isCollision(SnakePoint{ x, y }) || (x == apple.x && y == apple.y) || (x == specialApple.x && y == specialApple.y));
-
-    pinkApple.x = x;
-    pinkApple.y = y;
-}
-
-bool SnakeGame::isCollision(SnakePoint pt) {
-    if (pt.x < 0 || pt.x >= this->map.getCols() || pt.y < 0 || pt.y >=  this->map.getRows())
-        return true;
-    for (auto& segment : snake) {
-        if (segment.x == pt.x && segment.y == pt.y)
-            return true;
-    }
-    if (this->map.isObstacle(pt.x, pt.y)) {
-        return true;
-    }
-    return false;
-}
-
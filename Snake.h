@@ -1,76 +1,65 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
-#include <deque>
 #include <string>
 #include <fstream>
 #include "Glob.h"
 #include "Map.h"
+#include "SnakeCore.h"
+#include "SnakeRenderer.h"
+#include "ScoreStore.h"
+#include "Replay.h"
+#include "StateStream.h"
+#include "Autopilot.h"
+#include "TurnQueue.h"
 
-const std::string HIGH_SCORE_FILE = "highscore.txt";
-
-#define MAX_HARTS 3
-#define SUPERPOWER_HARTS_PRICE 1
-
-enum Direction { UP, DOWN, LEFT, RIGHT };
+const std::string HIGH_SCORE_FILE = "highscore.txt";     // old single-number format, migrated on first start
+const std::string LEADERBOARD_FILE = "leaderboard.txt";
+#define LEADERBOARD_SIZE 10
+const std::string LAST_GAME_FILE = "last_game.srec";   // recording of the last finished game, see Replay.h
+const std::string LAST_STREAM_FILE = "last_game.sstm"; // its state, tick by tick, see StateStream.h
 
 enum GameStates { MENU, PLAYING, OPTIONS, EXIT, GAME_OVER };
 
-struct SnakePoint {
-    int x, y;
-    SnakePoint(int x = 0, int y = 0) : x(x), y(y) {}
-};
-
-class SnakeGame
+// OpenCV front end on top of SnakeCore: wall-clock timing, rendering and the leaderboard
+class SnakeGame : public SnakeCore
 {
 private:
-    std::deque<SnakePoint> snake;
-    SnakePoint apple;
-    SnakePoint specialApple;
-    SnakePoint pinkApple;
-    int numHearts;
-    Direction dir;
-    bool gameOver;
-    size_t gameScore;
-    size_t highScore;
-    bool isPaused;
-    bool isInvincible;
-    int64_t invincibilityEndTime;
-    const int INVINCIBILITY_DURATION = 10;
-    const int SUPERPOWER_DURATION = 20;
-    int normalSpeed;
-
-
-    void placeApple();
-    void placeSpecialApple();
-    void placePinkApple();
-    bool isCollision(SnakePoint pt);
-
+    int normalSpeed;            // ticks per second to go back to when the superpower ends
+    bool superPowerActive;
+    SnakeRenderer renderer;
+    Leaderboard leaderboard;    // top scores per map, saved in the background by scoreWriter
+    FileWriter scoreWriter;
+    ReplayRecording recording;  // inputs of the current game
+    FileWriter replayWriter;
+    StateStreamEncoder stateStream; // what the game looked like at every tick, for spectators and logs
+    FileWriter streamWriter;
+    TurnQueue turns;            // keys pressed since the last tick, one turn per tick
+    Autopilot autopilot;
+    bool autopilotEnabled;      // the planner steers instead of the keyboard
 
 public:
-    int mao_width = MAP_WIDTH;
-    int map_height = MAP_HEIGHT;
     int cell_size = CELL_SIZE;
-    Map map;
 
     SnakeGame();
     ~SnakeGame();
-    void update(int& snakeSpeed);
+    void update(int& ticksPerSecond);
     void changeDirection(int key);
+    // Key pressed while playing: turns the snake on the next tick that is free for it (see TurnQueue)
+    void queueKey(int key) { turns.push(key); }
     void render(cv::Mat& frame);
-    bool isGameOver() const { return gameOver; }
+    // Board and HUD of any game state (this game, or a copy of it on the render thread); autopilotUs < 0 hides the planner time
+    static void renderState(SnakeRenderer& renderer, SnakeCore& state, cv::Mat& frame, int autopilotUs);
     void resetGame();
     void loadHighScore();
     void saveHighScore();
-    void loseHeart();
-    void drawHeart(cv::Mat& frame, cv::Point position);
+    static void drawHeart(cv::Mat& frame, cv::Point position);
     void drawCell(cv::Mat& frame, int x, int y, cv::Scalar color);
 
-    bool isGamePaused() const { return isPaused; }
-    void togglePause() { isPaused = !isPaused; }
-    bool isAppleOnSnake(int x, int y);
-    void buyLife();
-    void buySuperPower(int& snakeSpeed);
+    void buySuperPower(int& ticksPerSecond);
+    void setAutopilot(bool enabled) { autopilotEnabled = enabled; }
+    bool isAutopilot() const { return autopilotEnabled; }
+    Autopilot& getAutopilot() { return autopilot; }
     int getWindowWidth();
     int getWindowHeigth();
     
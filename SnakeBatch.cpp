@@ -0,0 +1,305 @@
+#include "SnakeBatch.h"
+#include <cctype>
+#include <chrono>
+
+// Durations in seconds, as in SnakeCore
+#define BATCH_INVINCIBILITY_DURATION 10
+
+SnakeBatch::SnakeBatch(const Map& map, int gameCount, uint64_t baseSeed, double tickFrequency)
+    : rows(map.getRows()), cols(map.getCols()), cellCount(map.getRows() * map.getCols()), gameCount(gameCount),
+      tickFrequency(tickFrequency), obstacles(map.getMap()), totalSteps(0), totalSeconds(0.0)
+{
+    regions.analyze(map);
+    spawnCell = regions.getSpawnCell();
+    if (spawnCell < 0) spawnCell = (rows / 2) * cols + cols / 2;
+
+    // Room for twice the board; only a body overlapping itself while invincible gets longer than
+    // the board, and growBodies() makes room for it
+    bodyCapacity = 1;
+    while (bodyCapacity < 2 * cellCount + 1) bodyCapacity <<= 1;
+
+    headX.assign(gameCount, 0); headY.assign(gameCount, 0);
+    nextX.assign(gameCount, 0); nextY.assign(gameCount, 0);
+    dir.assign(gameCount, RIGHT);
+    length.assign(gameCount, 0);
+    headSlot.assign(gameCount, 0);
+    apple.assign(gameCount, -1); specialApple.assign(gameCount, -1); pinkApple.assign(gameCount, -1);
+    hearts.assign(gameCount, 1);
+    score.assign(gameCount, 0); highScore.assign(gameCount, 0);
+    tick.assign(gameCount, 0);
+    invincibilityEnd.assign(gameCount, 0);
+    invincible.assign(gameCount, 0);
+    gameOver.assign(gameCount, 0);
+    boardFull.assign(gameCount, 0);
+    lastCollision.assign(gameCount, NO_DEATH);
+    rng.assign(gameCount, GameRng());
+
+    body.assign((size_t)gameCount * bodyCapacity, 0);
+    occupancy.assign((size_t)gameCount * cellCount, 0);
+    freeCells.assign(gameCount, FreeCellIndex());
+
+    for (int g = 0; g < gameCount; ++g) {
+        initGame(g, baseSeed + (uint64_t)g);
+    }
+}
+
+void SnakeBatch::initGame(int game, uint64_t seed) {
+    rng[game].seed(seed);
+    dir[game] = RIGHT;
+    hearts[game] = 1;
+    score[game] = 0;
+    highScore[game] = 0;
+    tick[game] = 0;
+    invincibilityEnd[game] = 0;
+    invincible[game] = 0;
+    gameOver[game] = 0;
+    boardFull[game] = 0;
+    lastCollision[game] = NO_DEATH;
+    apple[game] = -1;
+    specialApple[game] = -1;
+    pinkApple[game] = -1;
+    resetSnake(game);
+    placeApple(game);
+}
+
+void SnakeBatch::resetGame(int game) {
+    apple[game] = -1;
+    specialApple[game] = -1;
+    pinkApple[game] = -1;
+    resetSnake(game);
+    gameOver[game] = 0;
+    boardFull[game] = 0;
+    lastCollision[game] = NO_DEATH;
+    score[game] = 0;
+    dir[game] = RIGHT;
+    hearts[game] = MAX_HARTS;
+    invincible[game] = 0;
+    placeApple(game);
+}
+
+void SnakeBatch::resetAll() {
+    for (int g = 0; g < gameCount; ++g) {
+        resetGame(g);
+    }
+}
+
+bool SnakeBatch::isItemAt(int game, int cell) const {
+    return cell == apple[game] || cell == specialApple[game] || cell == pinkApple[game];
+}
+
+void SnakeBatch::releaseItem(int game, int32_t item) {
+    if (item >= 0 && occupancy[(size_t)game * cellCount + item] == 0 && regions.isReachable(item)) {
+        freeCells[game].insert(item);
+    }
+}
+
+bool SnakeBatch::placeItem(int game, int32_t& item) {
+    releaseItem(game, item);
+    if (freeCells[game].empty()) {
+        item = -1;
+        return false;
+    }
+    int cell = freeCells[game].at((int)rng[game].nextBelow((uint32_t)freeCells[game].size()));
+    freeCells[game].remove(cell);
+    item = cell;
+    return true;
+}
+
+void SnakeBatch::placeApple(int game) {
+    if (!placeItem(game, apple[game])) {
+        boardFull[game] = 1;
+        gameOver[game] = 1;
+    }
+}
+
+void SnakeBatch::placeSpecialApple(int game) {
+    if (rng[game].nextBelow(100) >= 50) { // 50% to respawn
+        releaseItem(game, specialApple[game]);
+        specialApple[game] = -1;
+        return;
+    }
+    placeItem(game, specialApple[game]);
+}
+
+void SnakeBatch::placePinkApple(int game) {
+    if (rng[game].nextBelow(100) >= 20) { // 20% to respawn
+        releaseItem(game, pinkApple[game]);
+        pinkApple[game] = -1;
+        return;
+    }
+    placeItem(game, pinkApple[game]);
+}
+
+// A body running over itself while invincible can outgrow every ring: double them all,
+// each body moved to the start of its new ring
+void SnakeBatch::growBodies() {
+    int larger = bodyCapacity * 2;
+    std::vector<int32_t> moved((size_t)gameCount * larger);
+    for (int g = 0; g < gameCount; ++g) {
+        for (int i = 0; i < length[g]; ++i) {
+            int slot = (headSlot[g] - length[g] + 1 + i) & (bodyCapacity - 1);
+            moved[(size_t)g * larger + i] = body[(size_t)g * bodyCapacity + slot];
+        }
+        headSlot[g] = (length[g] - 1) & (larger - 1);
+    }
+    body.swap(moved);
+    bodyCapacity = larger;
+}
+
+void SnakeBatch::pushHead(int game, int cell) {
+    if (length[game] == bodyCapacity) growBodies();
+    headSlot[game] = (headSlot[game] + 1) & (bodyCapacity - 1);
+    body[(size_t)game * bodyCapacity + headSlot[game]] = cell;
+    length[game]++;
+    headX[game] = cell % cols;
+    headY[game] = cell / cols;
+    occupancy[(size_t)game * cellCount + cell]++;
+    freeCells[game].remove(cell);
+}
+
+void SnakeBatch::popTail(int game) {
+    int slot = (headSlot[game] - length[game] + 1) & (bodyCapacity - 1);
+    int cell = body[(size_t)game * bodyCapacity + slot];
+    length[game]--;
+    if (--occupancy[(size_t)game * cellCount + cell] == 0 && regions.isReachable(cell) && !isItemAt(game, cell)) {
+        freeCells[game].insert(cell);
+    }
+}
+
+void SnakeBatch::resetSnake(int game) {
+    uint16_t* occ = &occupancy[(size_t)game * cellCount];
+    for (int c = 0; c < cellCount; ++c) {
+        occ[c] = obstacles[c] == 1 ? OccupancyGrid::OBSTACLE_BIT : 0;
+    }
+    // Apples still on the board are not free
+    freeCells[game].assign(cellCount, [&](int c) { return occ[c] == 0 && regions.isReachable(c) && !isItemAt(game, c); });
+
+    length[game] = 0;
+    headSlot[game] = 0;
+    pushHead(game, spawnCell);
+}
+
+void SnakeBatch::changeDirection(int game, int key) {
+    int32_t d = dir[game];
+    switch (tolower(key)) {
+    case 'w': if (d != DOWN) dir[game] = UP; break;
+    case 'a': if (d != RIGHT) dir[game] = LEFT; break;
+    case 's': if (d != UP) dir[game] = DOWN; break;
+    case 'd': if (d != LEFT) dir[game] = RIGHT; break;
+    }
+}
+
+void SnakeBatch::changeDirections(const int* keys) {
+    for (int g = 0; g < gameCount; ++g) {
+        if (keys[g] != -1) changeDirection(g, keys[g]);
+    }
+}
+
+// Collision, eating and tail of one game, after the batched head move
+void SnakeBatch::stepGame(int game) {
+    int x = nextX[game];
+    int y = nextY[game];
+
+    if (!invincible[game]) {
+        if (x < 0 || x >= cols || y < 0 || y >= rows || occupancy[(size_t)game * cellCount + y * cols + x] != 0) {
+            // loseHeart()
+            if (x < 0 || x >= cols || y < 0 || y >= rows) lastCollision[game] = HIT_WALL;
+            else if (obstacles[y * cols + x] == 1) lastCollision[game] = HIT_OBSTACLE;
+            else lastCollision[game] = HIT_SELF;
+            hearts[game]--;
+            if (hearts[game] <= 0) {
+                gameOver[game] = 1;
+            }
+            else {
+                invincible[game] = 1;
+                invincibilityEnd[game] = tick[game] + (int64_t)(BATCH_INVINCIBILITY_DURATION * tickFrequency);
+            }
+            return;
+        }
+    }
+
+    int cell = y * cols + x;
+    pushHead(game, cell);
+
+    if (cell == apple[game]) {
+        placeApple(game);
+        if (specialApple[game] == -1) placeSpecialApple(game);
+        if (pinkApple[game] == -1) placePinkApple(game);
+    }
+    else if (cell == specialApple[game]) {
+        invincible[game] = 1;
+        invincibilityEnd[game] = tick[game] + (int64_t)(BATCH_INVINCIBILITY_DURATION * tickFrequency);
+        placeSpecialApple(game);
+    }
+    else if (cell == pinkApple[game]) {
+        if (hearts[game] < MAX_HARTS) hearts[game]++;
+        placePinkApple(game);
+    }
+    else {
+        popTail(game);
+    }
+
+    score[game] = length[game] - 1;
+    if (score[game] > highScore[game]) highScore[game] = score[game];
+}
+
+void SnakeBatch::step() {
+    auto start = std::chrono::steady_clock::now();
+    const int n = gameCount;
+    const int32_t lastCol = cols - 1, lastRow = rows - 1;
+
+    // Batched phase: tick, timer expiry and next head for every game.
+    // Plain arrays and selects only, so these loops vectorize.
+    int64_t* ticks = tick.data();
+    const int64_t* invEnd = invincibilityEnd.data();
+    uint8_t* inv = invincible.data();
+    const uint8_t* over = gameOver.data();
+    for (int g = 0; g < n; ++g) {
+        int64_t t = ticks[g] + (over[g] ? 0 : 1);
+        ticks[g] = t;
+        inv[g] = (uint8_t)(inv[g] & (t <= invEnd[g] || over[g] ? 1 : 0));
+    }
+
+    const int32_t* hx = headX.data();
+    const int32_t* hy = headY.data();
+    const int32_t* d = dir.data();
+    int32_t* nx = nextX.data();
+    int32_t* ny = nextY.data();
+    for (int g = 0; g < n; ++g) {
+        int32_t x = hx[g] + (d[g] == LEFT ? -1 : (d[g] == RIGHT ? 1 : 0));
+        int32_t y = hy[g] + (d[g] == UP ? -1 : (d[g] == DOWN ? 1 : 0));
+        // Invincible snakes wrap around the board edges
+        int32_t wx = x < 0 ? lastCol : (x > lastCol ? 0 : x);
+        int32_t wy = y < 0 ? lastRow : (y > lastRow ? 0 : y);
+        nx[g] = inv[g] ? wx : x;
+        ny[g] = inv[g] ? wy : y;
+    }
+
+    // Per-game phase: everything that touches the board
+    int64_t stepped = 0;
+    for (int g = 0; g < n; ++g) {
+        if (over[g]) continue;
+        stepGame(g);
+        stepped++;
+    }
+
+    totalSteps += stepped;
+    totalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int SnakeBatch::getAliveCount() const {
+    int alive = 0;
+    for (int g = 0; g < gameCount; ++g) {
+        alive += gameOver[g] ? 0 : 1;
+    }
+    return alive;
+}
+
+SnakePoint SnakeBatch::getApple(int game) const {
+    if (apple[game] < 0) return SnakePoint(-1, -1);
+    return SnakePoint(apple[game] % cols, apple[game] / cols);
+}
+
+double SnakeBatch::getStepsPerSecond() const {
+    return totalSeconds > 0.0 ? (double)totalSteps / totalSeconds : 0.0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+#include "SnakeCore.h"
+#include "FreeCellIndex.h"
+#include "MapRegions.h"
+
+// Many independent games on the same map, stepped in lockstep.
+// State is kept as structure-of-arrays (one array per field, indexed by game),
+// so the per-tick head movement and timer checks run as flat loops the compiler
+// can vectorize; only the occupancy lookups and item placement are per game.
+// Each game follows SnakeCore's rules with its default tick clock: a game built
+// with seed S gives the same results as SnakeCore(map, S) fed the same keys.
+class SnakeBatch
+{
+private:
+    int rows;
+    int cols;
+    int cellCount;
+    int gameCount;
+    int bodyCapacity;           // ring buffer slots per game (power of two), doubled if a body outgrows it
+    double tickFrequency;
+    std::vector<unsigned char> obstacles;
+    MapRegions regions;         // shared by every game: the map does not change
+    int spawnCell;
+
+    // Per game
+    std::vector<int32_t> headX, headY;
+    std::vector<int32_t> nextX, nextY;
+    std::vector<int32_t> dir;
+    std::vector<int32_t> length;
+    std::vector<int32_t> headSlot;      // ring index of the head; the tail is headSlot - length + 1
+    std::vector<int32_t> apple, specialApple, pinkApple;   // cell index, -1 = none
+    std::vector<int32_t> hearts;
+    std::vector<int32_t> score, highScore;
+    std::vector<int64_t> tick;
+    std::vector<int64_t> invincibilityEnd;
+    std::vector<uint8_t> invincible;
+    std::vector<uint8_t> gameOver;
+    std::vector<uint8_t> boardFull;
+    std::vector<uint8_t> lastCollision; // DeathCause of the last lost heart
+    std::vector<GameRng> rng;
+    std::vector<FreeCellIndex> freeCells;   // reachable cells with no obstacle, snake or apple
+
+    // Per game x per cell (game-major)
+    std::vector<int32_t> body;          // ring buffer of cell indices, head at headSlot
+    std::vector<uint16_t> occupancy;    // snake segment count | OccupancyGrid::OBSTACLE_BIT
+
+    int64_t totalSteps;
+    double totalSeconds;
+
+    bool isItemAt(int game, int cell) const;
+    void releaseItem(int game, int32_t item);
+    bool placeItem(int game, int32_t& item);
+    void placeApple(int game);
+    void placeSpecialApple(int game);
+    void placePinkApple(int game);
+    void growBodies();
+    void pushHead(int game, int cell);
+    void popTail(int game);
+    void resetSnake(int game);
+    void stepGame(int game);
+
+public:
+    SnakeBatch(const Map& map, int gameCount, uint64_t baseSeed, double tickFrequency = 10.0);
+
+    // Same as constructing SnakeCore(map, seed) for one game
+    void initGame(int game, uint64_t seed);
+    void resetGame(int game);
+    void resetAll();
+
+    void changeDirection(int game, int key);
+    void changeDirections(const int* keys); // one key per game, -1 = none
+
+    // Advance every game that is not over by one tick
+    void step();
+
+    int getGameCount() const { return gameCount; }
+    int getAliveCount() const;
+    bool isGameOver(int game) const { return gameOver[game] != 0; }
+    bool isBoardFull(int game) const { return boardFull[game] != 0; }
+    DeathCause getDeathCause(int game) const { return boardFull[game] ? BOARD_FULL : (gameOver[game] ? (DeathCause)lastCollision[game] : NO_DEATH); }
+    SnakePoint getHead(int game) const { return SnakePoint(headX[game], headY[game]); }
+    SnakePoint getApple(int game) const;
+    int getLength(int game) const { return length[game]; }
+    int getHearts(int game) const { return hearts[game]; }
+    size_t getScore(int game) const { return (size_t)score[game]; }
+    size_t getHighScore(int game) const { return (size_t)highScore[game]; }
+    bool isInvincible(int game) const { return invincible[game] != 0; }
+    int64_t getTickCount(int game) const { return tick[game]; }
+
+    // Game steps (one game, one tick) per second of wall time spent in step()
+    double getStepsPerSecond() const;
+    int64_t getTotalSteps() const { return totalSteps; }
+};
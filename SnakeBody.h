@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+struct SnakePoint {
+    int x, y;
+    SnakePoint(int x = 0, int y = 0) : x(x), y(y) {}
+};
+
+// Snake body as one contiguous ring of compact (int16) points, head first.
+// The ring is sized once per board (a body never covers more cells than the
+// board has), so pushFront/popBack never allocate while playing; only an
+// invincible snake running over itself could outgrow it, and then it doubles.
+// Capacity is a power of two, so a slot is a mask away from its index.
+// Coordinates are stored as int16, so no side of a board may be longer than
+// MAX_BOARD_SIDE (Map.h) cells; larger maps are refused when they are loaded.
+class SnakeBody {
+private:
+    struct Cell { int16_t x, y; };
+
+    std::vector<Cell> ring;
+    size_t mask;
+    size_t head;    // slot of the head; the body continues at head + 1, head + 2, ...
+    size_t count;
+
+    void grow(size_t capacity) {
+        size_t slots = 1;
+        while (slots < capacity) slots <<= 1;
+        std::vector<Cell> larger(slots);
+        for (size_t i = 0; i < count; ++i) larger[i] = ring[(head + i) & mask];
+        ring.swap(larger);
+        mask = slots - 1;
+        head = 0;
+    }
+
+public:
+    class const_iterator {
+    private:
+        const SnakeBody* body;
+        size_t index;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef SnakePoint value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const SnakePoint* pointer;
+        typedef SnakePoint reference;   // points are unpacked on the fly
+
+        const_iterator(const SnakeBody* body, size_t index) : body(body), index(index) {}
+        SnakePoint operator*() const { return (*body)[index]; }
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index; return old; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    };
+
+    SnakeBody() : ring(1), mask(0), head(0), count(0) {}
+
+    // Room for `capacity` segments; keeps the current body
+    void reserve(size_t capacity) {
+        if (capacity > ring.size()) grow(capacity);
+    }
+
+    void clear() { head = 0; count = 0; }
+
+    void pushFront(SnakePoint pt) {
+        if (count == ring.size()) grow(ring.size() * 2);
+        head = (head - 1) & mask;
+        ring[head].x = (int16_t)pt.x;
+        ring[head].y = (int16_t)pt.y;
+        count++;
+    }
+
+    void popBack() { count--; }
+
+    // i-th segment from the head
+    SnakePoint operator[](size_t i) const {
+        const Cell& cell = ring[(head + i) & mask];
+        return SnakePoint(cell.x, cell.y);
+    }
+
+    SnakePoint front() const { return (*this)[0]; }
+    SnakePoint back() const { return (*this)[count - 1]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    // Body from points head first
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        clear();
+        size_t length = (size_t)std::distance(first, last);
+        reserve(length);
+        for (size_t i = 0; first != last; ++first, ++i) {
+            ring[i].x = (int16_t)first->x;
+            ring[i].y = (int16_t)first->y;
+        }
+        count = length;
+    }
+};
@@ -0,0 +1,346 @@
+#include "SnakeCore.h"
+#include <cctype>
+
+// Updates per second when no clock is injected (the default 100 ms snake speed)
+#define DEFAULT_TICK_FREQUENCY 10.0
+
+SnakeCore::SnakeCore(const Map& map, uint64_t seed) : rng(seed), seed(seed), numHearts(1), dir(RIGHT), gameOver(false), boardFull(false), lastCollision(NO_DEATH), gameScore(0), highScore(0), isPaused(false), isInvincible(false), invincibilityEndTime(0), allDirty(true), tickCount(0), tickFrequency(DEFAULT_TICK_FREQUENCY), map(map)
+{
+    apple = SnakePoint(-1, -1);
+    specialApple = SnakePoint(-1, -1);
+    pinkApple = SnakePoint(-1, -1);
+    resetSnake();
+    placeApple();
+}
+
+void SnakeCore::setSeed(uint64_t seed) {
+    this->seed = seed;
+    rng.seed(seed);
+}
+
+void SnakeCore::setTickSource(std::function<int64_t()> counter, double frequency) {
+    tickCounter = counter;
+    tickFrequency = counter ? frequency : DEFAULT_TICK_FREQUENCY;
+}
+
+void SnakeCore::update() {
+    if (gameOver) return;
+    tickCount++;
+
+    if (isInvincible && now() > invincibilityEndTime) {
+        isInvincible = false;
+    }
+
+    // The next head position (direction) based on the pressed key
+    SnakePoint head = snake.front();
+    switch (dir) {
+    case UP: head.y -= 1; break;
+    case DOWN: head.y += 1; break;
+    case LEFT: head.x -= 1; break;
+    case RIGHT: head.x += 1; break;
+    }
+
+    if (isInvincible) {
+        if (head.x < 0) {
+            head.x = this->map.getCols() - 1; // Teleport to the right
+        }
+        else if (head.x >= this->map.getCols()) {
+            head.x = 0; // Teleport to the left
+        }
+
+        if (head.y < 0) {
+            head.y = this->map.getRows() - 1; // Teleport to the bottom
+        }
+        else if (head.y >= this->map.getRows()) {
+            head.y = 0; // Teleport to the top
+        }
+    }
+    else if (isCollision(head)) {
+        lastCollision = collisionCause(head);
+        loseHeart();
+        return;
+    }
+
+    pushHead(head);
+
+    if (head.x == apple.x && head.y == apple.y) {
+        placeApple();
+
+        if (specialApple.x == -1 && specialApple.y == -1) {
+            placeSpecialApple();
+        }
+        if (pinkApple.x == -1 && pinkApple.y == -1) {
+            placePinkApple();
+        }
+    }
+    else if (head.x == specialApple.x && head.y == specialApple.y) {
+        isInvincible = true;
+        invincibilityEndTime = now() + (int64_t)(INVINCIBILITY_DURATION * tickFrequency);
+        placeSpecialApple();
+    }
+    else if (head.x == pinkApple.x && head.y == pinkApple.y) {
+        if (numHearts < MAX_HARTS) {
+            numHearts++;
+        }
+        placePinkApple();
+    }
+    else {
+        popTail();
+    }
+
+    gameScore = (int)snake.size() - (int)1;
+    if (gameScore > highScore) {
+        highScore = gameScore;
+    }
+}
+
+void SnakeCore::changeDirection(int key) {
+    switch (tolower(key)) {
+    case 'w': if (dir != DOWN) dir = UP; break;
+    case 'a': if (dir != RIGHT) dir = LEFT; break;
+    case 's': if (dir != UP) dir = DOWN; break;
+    case 'd': if (dir != LEFT) dir = RIGHT; break;
+    }
+}
+
+void SnakeCore::markDirty(int x, int y) {
+    if (allDirty || !occupancy.inBounds(x, y)) return;
+    if (dirtyCells.size() >= 64) { // Nobody is consuming them (headless), stop tracking
+        dirtyCells.clear();
+        allDirty = true;
+        return;
+    }
+    dirtyCells.push_back(y * this->map.getCols() + x);
+}
+
+void SnakeCore::pushHead(SnakePoint pt) {
+    markDirty(pt.x, pt.y);
+    snake.pushFront(pt);
+    occupancy.addSnake(pt.x, pt.y);
+    freeCells.remove(pt.y * this->map.getCols() + pt.x);
+}
+
+void SnakeCore::popTail() {
+    SnakePoint tail = snake.back();
+    snake.popBack();
+    occupancy.removeSnake(tail.x, tail.y);
+    markDirty(tail.x, tail.y);
+    if (isPlaceable(tail.x, tail.y) && !isItemAt(tail.x, tail.y)) {
+        freeCells.insert(tail.y * this->map.getCols() + tail.x);
+    }
+}
+
+bool SnakeCore::isItemAt(int x, int y) const {
+    return (x == apple.x && y == apple.y) || (x == specialApple.x && y == specialApple.y) || (x == pinkApple.x && y == pinkApple.y);
+}
+
+// Free and reachable from the spawn point: an invincible snake can leave cells behind in a pocket
+bool SnakeCore::isPlaceable(int x, int y) const {
+    return occupancy.isFree(x, y) && regions.isReachable(y * this->map.getCols() + x);
+}
+
+// Single segment at the center of the board (or the nearest cell of the largest region when the
+// center is walled in); also picks up obstacle changes of the map
+void SnakeCore::resetSnake() {
+    snake.clear();
+    snake.reserve((size_t)this->map.getRows() * this->map.getCols() + 1);
+    dirtyCells.clear();
+    allDirty = true;
+    occupancy.reset(this->map);
+    regions.analyze(this->map);
+
+    int cols = this->map.getCols();
+    // Apples still on the board are not free
+    int items[] = { apple.y * cols + apple.x, specialApple.y * cols + specialApple.x, pinkApple.y * cols + pinkApple.x };
+    freeCells.assign(this->map.getRows() * cols, [&](int cell) {
+        return occupancy.isFreeCell(cell) && regions.isReachable(cell) && cell != items[0] && cell != items[1] && cell != items[2];
+    });
+
+    int spawn = regions.getSpawnCell();
+    if (spawn < 0) spawn = (this->map.getRows() / 2) * cols + cols / 2; // no free cell at all
+    pushHead(SnakePoint(spawn % cols, spawn / cols));
+}
+
+// Apples left from the last game are dropped too, so the new game only depends on the map and the rng
+void SnakeCore::resetGame() {
+    apple = SnakePoint(-1, -1);
+    specialApple = SnakePoint(-1, -1);
+    pinkApple = SnakePoint(-1, -1);
+    resetSnake();
+    gameOver = false;
+    boardFull = false;
+    lastCollision = NO_DEATH;
+    gameScore = 0;
+    dir = RIGHT;
+    numHearts = MAX_HARTS;
+    isInvincible = false;
+    placeApple();
+}
+
+void SnakeCore::snapshot(SnakeSnapshot& out) const {
+    out.body.assign(snake.begin(), snake.end());
+    out.apple = apple;
+    out.specialApple = specialApple;
+    out.pinkApple = pinkApple;
+    out.rngState = rng.getState();
+    out.seed = seed;
+    out.tickCount = tickCount;
+    out.invincibilityLeft = invincibilityEndTime - now();
+    out.tickFrequency = tickFrequency;
+    out.gameScore = gameScore;
+    out.highScore = highScore;
+    out.rows = this->map.getRows();
+    out.cols = this->map.getCols();
+    out.numHearts = numHearts;
+    out.dir = dir;
+    out.lastCollision = lastCollision;
+    out.gameOver = gameOver;
+    out.boardFull = boardFull;
+    out.isPaused = isPaused;
+    out.isInvincible = isInvincible;
+}
+
+bool SnakeCore::restore(const SnakeSnapshot& in) {
+    if (in.rows != this->map.getRows() || in.cols != this->map.getCols()) return false;
+    int cols = this->map.getCols();
+
+    // Only cells under the old or new body or apples can change free/occupied
+    auto refresh = [&](const SnakePoint& pt) {
+        if (!occupancy.inBounds(pt.x, pt.y)) return;
+        if (isPlaceable(pt.x, pt.y) && !isItemAt(pt.x, pt.y)) freeCells.insert(pt.y * cols + pt.x);
+        else freeCells.remove(pt.y * cols + pt.x);
+    };
+
+    SnakePoint oldItems[] = { apple, specialApple, pinkApple };
+    for (const SnakePoint& pt : snake) occupancy.removeSnake(pt.x, pt.y);
+    for (const SnakePoint& pt : in.body) occupancy.addSnake(pt.x, pt.y);
+    apple = in.apple;
+    specialApple = in.specialApple;
+    pinkApple = in.pinkApple;
+    for (const SnakePoint& pt : snake) refresh(pt);
+    for (const SnakePoint& pt : oldItems) refresh(pt);
+    snake.assign(in.body.begin(), in.body.end());
+    for (const SnakePoint& pt : snake) refresh(pt);
+    refresh(apple);
+    refresh(specialApple);
+    refresh(pinkApple);
+
+    rng.seed(in.rngState);
+    seed = in.seed;
+    tickCount = in.tickCount;
+    gameScore = in.gameScore;
+    highScore = in.highScore;
+    numHearts = in.numHearts;
+    dir = in.dir;
+    lastCollision = in.lastCollision;
+    gameOver = in.gameOver;
+    boardFull = in.boardFull;
+    isPaused = in.isPaused;
+    isInvincible = in.isInvincible;
+    int64_t left = in.tickFrequency == tickFrequency ? in.invincibilityLeft : (int64_t)(in.invincibilityLeft * (tickFrequency / in.tickFrequency));
+    invincibilityEndTime = now() + left;
+
+    dirtyCells.clear();
+    allDirty = true;
+    return true;
+}
+
+void SnakeCore::newGame(uint64_t seed) {
+    setSeed(seed);
+    resetGame();
+}
+
+void SnakeCore::loseHeart() {
+    if (isInvincible) {
+        return; // not losing hearts
+    }
+
+    numHearts--;
+    if (numHearts <= 0) {
+        gameOver = true;
+    }
+    else {
+        isInvincible = true;
+        invincibilityEndTime = now() + (int64_t)(INVINCIBILITY_DURATION * tickFrequency);
+    }
+}
+
+bool SnakeCore::activateSuperPower() {
+    if (numHearts > SUPERPOWER_HARTS_PRICE) {
+        isInvincible = true;
+        invincibilityEndTime = now() + (int64_t)(SUPERPOWER_DURATION * tickFrequency);
+        numHearts -= SUPERPOWER_HARTS_PRICE;
+        return true;
+    }
+    return false;
+}
+
+void SnakeCore::buyLife() {
+    if (highScore >= 5 && numHearts < MAX_HARTS) {
+        numHearts++;
+        highScore -= 5;
+    }
+}
+
+bool SnakeCore::isAppleOnSnake(int x, int y) {
+    return occupancy.hasSnake(x, y);
+}
+
+// Give the cell of an apple that is moving away back to the free set (unless the snake is on it)
+void SnakeCore::releaseItem(const SnakePoint& item) {
+    markDirty(item.x, item.y);
+    if (isPlaceable(item.x, item.y)) {
+        freeCells.insert(item.y * this->map.getCols() + item.x);
+    }
+}
+
+// Move an item to a uniformly chosen free cell; (-1, -1) and false when the board is full
+bool SnakeCore::placeItem(SnakePoint& item) {
+    releaseItem(item);
+    if (freeCells.empty()) {
+        item = SnakePoint(-1, -1);
+        return false;
+    }
+    int cell = freeCells.at((int)rng.nextBelow((uint32_t)freeCells.size()));
+    freeCells.remove(cell);
+    item.x = cell % this->map.getCols();
+    item.y = cell / this->map.getCols();
+    markDirty(item.x, item.y);
+    return true;
+}
+
+void SnakeCore::placeApple() {
+    if (!placeItem(apple)) {
+        boardFull = true;
+        gameOver = true;
+    }
+}
+
+void SnakeCore::placeSpecialApple() {
+    if (rng.nextBelow(100) >= 50) { // 50% to respawn
+        releaseItem(specialApple);
+        specialApple = SnakePoint(-1, -1);
+        return;
+    }
+    placeItem(specialApple);
+}
+
+void SnakeCore::placePinkApple() {
+    if (rng.nextBelow(100) >= 20) { // 20% to respawn
+        releaseItem(pinkApple);
+        pinkApple = SnakePoint(-1, -1);
+        return;
+    }
+    placeItem(pinkApple);
+}
+
+// Wall, body or obstacle: one lookup in the occupancy grid
+bool SnakeCore::isCollision(SnakePoint pt) {
+    return occupancy.isBlocked(pt.x, pt.y);
+}
+
+DeathCause SnakeCore::collisionCause(SnakePoint pt) const {
+    if (!occupancy.inBounds(pt.x, pt.y)) return HIT_WALL;
+    if (occupancy.isObstacle(pt.x, pt.y)) return HIT_OBSTACLE;
+    return HIT_SELF;
+}
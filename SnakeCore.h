@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Map.h"
+#include "OccupancyGrid.h"
+#include "FreeCellIndex.h"
+#include "MapRegions.h"
+#include "GameRng.h"
+#include "SnakeBody.h"
+
+#define MAX_HARTS 3
+#define SUPERPOWER_HARTS_PRICE 1
+
+enum Direction { UP, DOWN, LEFT, RIGHT };
+
+// Why a game ended (or the last heart was lost); HIT_SNAKE is another snake's body or head (MultiSnakeCore)
+enum DeathCause { NO_DEATH, HIT_WALL, HIT_SELF, HIT_OBSTACLE, HIT_SNAKE, BOARD_FULL, TICK_LIMIT };
+
+// Mutable state of a game, without the map: what a search bot copies to fork a game.
+// Filled by SnakeCore::snapshot, which reuses the body buffer, so taking one allocates nothing once warm.
+struct SnakeSnapshot {
+    std::vector<SnakePoint> body;   // head first
+    SnakePoint apple;
+    SnakePoint specialApple;
+    SnakePoint pinkApple;
+    uint64_t rngState;
+    uint64_t seed;
+    int64_t tickCount;
+    int64_t invincibilityLeft;      // clock ticks until invincibility ends, at tickFrequency
+    double tickFrequency;
+    size_t gameScore;
+    size_t highScore;
+    int rows, cols;
+    int numHearts;
+    Direction dir;
+    DeathCause lastCollision;
+    bool gameOver;
+    bool boardFull;
+    bool isPaused;
+    bool isInvincible;
+};
+
+// Pure game logic: no OpenCV, no window, no wall clock.
+// Time is read from an injected tick counter; by default every update() is one tick.
+class SnakeCore
+{
+protected:
+    SnakeBody snake;            // head first, sized for the whole board
+    OccupancyGrid occupancy;    // obstacles + body, kept in sync with every push/pop of `snake`
+    FreeCellIndex freeCells;    // reachable cells with no obstacle, snake or apple; where items get placed
+    MapRegions regions;         // regions of the map, labelled on every reset
+    GameRng rng;
+    uint64_t seed;
+    SnakePoint apple;
+    SnakePoint specialApple;
+    SnakePoint pinkApple;
+    int numHearts;
+    Direction dir;
+    bool gameOver;
+    bool boardFull;             // no free cell was left for the apple
+    DeathCause lastCollision;   // what the snake hit when it last lost a heart
+    size_t gameScore;
+    size_t highScore;
+    bool isPaused;
+    bool isInvincible;
+    int64_t invincibilityEndTime;
+    const int INVINCIBILITY_DURATION = 10;
+    const int SUPERPOWER_DURATION = 20;
+
+    std::vector<int> dirtyCells;    // cells whose content changed since the renderer last looked
+    bool allDirty;                  // too many (or unknown) changes: redraw the whole board
+
+    int64_t tickCount;                      // updates done since construction
+    std::function<int64_t()> tickCounter;   // injected clock, empty = use tickCount
+    double tickFrequency;                   // ticks of the clock per second
+
+    bool placeItem(SnakePoint& item);
+    void releaseItem(const SnakePoint& item);
+    bool isItemAt(int x, int y) const;
+    bool isPlaceable(int x, int y) const;
+    void placeApple();
+    void placeSpecialApple();
+    void placePinkApple();
+    bool isCollision(SnakePoint pt);
+    DeathCause collisionCause(SnakePoint pt) const;
+    void pushHead(SnakePoint pt);
+    void popTail();
+    void resetSnake();
+    void markDirty(int x, int y);
+
+public:
+    Map map;
+
+    SnakeCore(const Map& map, uint64_t seed);
+    virtual ~SnakeCore() {}
+
+    void setTickSource(std::function<int64_t()> counter, double frequency);
+    int64_t now() const { return tickCounter ? tickCounter() : tickCount; }
+    double getTickFrequency() const { return tickFrequency; }
+
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const { return seed; }
+    uint64_t getRngState() const { return rng.getState(); }
+
+    void update();
+    void changeDirection(int key);
+    // Forking for lookahead: restore() puts a snapshot into any game on a map of the same size,
+    // updating only the cells the two bodies and the apples touch. The result plays exactly like
+    // the original; use a game without an injected clock so its timers follow its own updates.
+    void snapshot(SnakeSnapshot& out) const;
+    bool restore(const SnakeSnapshot& in);
+
+    void resetGame();
+    void newGame(uint64_t seed);    // resetGame from a fresh seed: same map + seed, same game
+    void loseHeart();
+    bool activateSuperPower();
+    void buyLife();
+
+    bool isGameOver() const { return gameOver; }
+    bool isBoardFull() const { return boardFull; }
+    DeathCause getDeathCause() const { return boardFull ? BOARD_FULL : (gameOver ? lastCollision : NO_DEATH); }
+    bool isGamePaused() const { return isPaused; }
+    void togglePause() { isPaused = !isPaused; }
+    bool isAppleOnSnake(int x, int y);
+    bool isSnakeAt(int x, int y) const { return occupancy.hasSnake(x, y); }
+    const MapRegions& getRegions() const { return regions; }
+
+    const SnakeBody& getSnake() const { return snake; }
+    SnakePoint getApple() const { return apple; }
+    SnakePoint getSpecialApple() const { return specialApple; }
+    SnakePoint getPinkApple() const { return pinkApple; }
+    Direction getDirection() const { return dir; }
+    int getHearts() const { return numHearts; }
+    size_t getScore() const { return gameScore; }
+    size_t getHighScore() const { return highScore; }
+    bool isSnakeInvincible() const { return isInvincible; }
+    int64_t getInvincibilityEndTime() const { return invincibilityEndTime; }
+    int64_t getTickCount() const { return tickCount; }
+
+    // Changed cells (row-major indices) for incremental drawing; see allDirty
+    const std::vector<int>& getDirtyCells() const { return dirtyCells; }
+    bool isAllDirty() const { return allDirty; }
+    void clearDirtyCells() { dirtyCells.clear(); allDirty = false; }
+    // Changes a copy of the game was told about (restore() alone marks everything)
+    void setDirtyCells(const std::vector<int>& cells, bool all) { dirtyCells.assign(cells.begin(), cells.end()); allDirty = all; }
+};
@@ -0,0 +1,258 @@
+#include "SnakeRenderer.h"
+#include "MapDraw.h"
+#include "MultiSnakeCore.h"
+#include <cstdlib>
+
+static const cv::Scalar BACKGROUND_COLOR(0, 0, 0);
+static const cv::Scalar OBSTACLE_COLOR(50, 75, 0);
+// One per snake (BGR), clear of the apple colors; invincible snakes turn a lighter shade
+static const cv::Scalar SNAKE_COLORS[MAX_SNAKES] = {
+    cv::Scalar(0, 255, 0), cv::Scalar(255, 144, 30), cv::Scalar(0, 140, 255), cv::Scalar(255, 0, 255),
+    cv::Scalar(255, 255, 0), cv::Scalar(0, 100, 0), cv::Scalar(128, 0, 128), cv::Scalar(200, 200, 200)
+};
+static const cv::Scalar INVINCIBLE_SNAKE_COLORS[MAX_SNAKES] = {
+    cv::Scalar(0, 255, 255), cv::Scalar(255, 200, 150), cv::Scalar(128, 200, 255), cv::Scalar(255, 150, 255),
+    cv::Scalar(255, 255, 180), cv::Scalar(100, 200, 100), cv::Scalar(200, 120, 200), cv::Scalar(255, 255, 255)
+};
+static const cv::Scalar APPLE_COLOR(0, 0, 255);
+static const cv::Scalar SPECIAL_APPLE_COLOR(0, 255, 255);
+static const cv::Scalar PINK_APPLE_COLOR(255, 105, 180);
+
+SnakeRenderer::SnakeRenderer(int cellSize) : cellSize(cellSize), drawnMap(nullptr), drawnRevision(0), drawnInvincible(0), viewValid(false) {}
+
+cv::Scalar SnakeRenderer::snakeColor(int index, bool invincible) {
+    return invincible ? INVINCIBLE_SNAKE_COLORS[index % MAX_SNAKES] : SNAKE_COLORS[index % MAX_SNAKES];
+}
+
+// What the renderer needs from a game, for one snake or several
+static bool focusOf(const SnakeCore& game, SnakePoint& head) {
+    head = game.getSnake().front();
+    return true;
+}
+
+static bool focusOf(const MultiSnakeCore& game, SnakePoint& head) {
+    for (int i = 0; i < game.getSnakeCount(); ++i) {
+        if (!game.getSnake(i).empty()) {
+            head = game.getSnake(i).front();
+            return true;
+        }
+    }
+    return false;
+}
+
+static int snakeAt(const SnakeCore& game, int x, int y) {
+    return game.isSnakeAt(x, y) ? 0 : -1;
+}
+
+static int snakeAt(const MultiSnakeCore& game, int x, int y) {
+    return game.snakeAt(x, y);
+}
+
+static uint32_t invincibleSnakes(const SnakeCore& game) {
+    return game.isSnakeInvincible() ? 1 : 0;
+}
+
+static uint32_t invincibleSnakes(const MultiSnakeCore& game) {
+    uint32_t mask = 0;
+    for (int i = 0; i < game.getSnakeCount(); ++i) {
+        if (game.getPlayer(i).invincible) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// As many whole cells as fit in the frame, never more than the board
+cv::Rect SnakeRenderer::viewFor(const Map& map, const cv::Mat& frame) const {
+    int cols = std::min(map.getCols(), frame.cols / cellSize);
+    int rows = std::min(map.getRows(), frame.rows / cellSize);
+    int x = viewValid ? std::min(std::max(view.x, 0), map.getCols() - cols) : 0;
+    int y = viewValid ? std::min(std::max(view.y, 0), map.getRows() - rows) : 0;
+    return cv::Rect(x, y, cols, rows);
+}
+
+// Keep the head at least a quarter of the viewport away from its edges
+template <typename Game>
+void SnakeRenderer::followHead(const Game& game) {
+    SnakePoint head;
+    if (!focusOf(game, head)) return;
+    int marginX = view.width / 4;
+    int marginY = view.height / 4;
+    int x = view.x;
+    int y = view.y;
+
+    if (head.x < x + marginX) x = head.x - marginX;
+    else if (head.x >= x + view.width - marginX) x = head.x - view.width + marginX + 1;
+    if (head.y < y + marginY) y = head.y - marginY;
+    else if (head.y >= y + view.height - marginY) y = head.y - view.height + marginY + 1;
+
+    x = std::min(std::max(x, 0), game.map.getCols() - view.width);
+    y = std::min(std::max(y, 0), game.map.getRows() - view.height);
+    if (x != view.x || y != view.y) {
+        scrollTo(game, x, y);
+    }
+}
+
+static void scrollLayer(cv::Mat& layer, cv::Mat& scratch, int dxPixels, int dyPixels) {
+    scratch.create(layer.rows, layer.cols, layer.type());
+    int width = layer.cols - std::abs(dxPixels);
+    int height = layer.rows - std::abs(dyPixels);
+    cv::Rect source(std::max(dxPixels, 0), std::max(dyPixels, 0), width, height);
+    cv::Rect target(std::max(-dxPixels, 0), std::max(-dyPixels, 0), width, height);
+    layer(source).copyTo(scratch(target));
+    cv::swap(layer, scratch);
+}
+
+template <typename Game>
+void SnakeRenderer::scrollTo(const Game& game, int x, int y) {
+    int dx = x - view.x;
+    int dy = y - view.y;
+    view.x = x;
+    view.y = y;
+
+    if (std::abs(dx) >= view.width || std::abs(dy) >= view.height) {
+        rebuildBackground(game.map); // Jumped (e.g. wrapped around): nothing to keep
+        repaintBoard(game);
+        return;
+    }
+
+    scrollLayer(background, scratch, dx * cellSize, dy * cellSize);
+    scrollLayer(board, scratch, dx * cellSize, dy * cellSize);
+
+    // Newly exposed columns and rows, in board cells
+    cv::Rect columns(dx > 0 ? view.x + view.width - dx : view.x, view.y, std::abs(dx), view.height);
+    cv::Rect rows(view.x, dy > 0 ? view.y + view.height - dy : view.y, view.width, std::abs(dy));
+    cv::Rect strips[] = { columns, rows };
+    for (const cv::Rect& strip : strips) {
+        for (int cy = strip.y; cy < strip.y + strip.height; ++cy) {
+            for (int cx = strip.x; cx < strip.x + strip.width; ++cx) {
+                paintBackgroundCell(game.map, cx, cy);
+            }
+        }
+        paintCells(game, strip);
+    }
+}
+
+void SnakeRenderer::rebuildBackground(const Map& map) {
+    background = cv::Mat(view.height * cellSize, view.width * cellSize, CV_8UC3, BACKGROUND_COLOR);
+    drawMap(map, background, OBSTACLE_COLOR, cellSize, view);
+    drawnMap = &map;
+    drawnRevision = map.getRevision();
+}
+
+void SnakeRenderer::paintBackgroundCell(const Map& map, int x, int y) {
+    cv::Rect cell((x - view.x) * cellSize, (y - view.y) * cellSize, cellSize, cellSize);
+    cv::rectangle(background, cell, map.isObstacle(x, y) ? OBSTACLE_COLOR : BACKGROUND_COLOR, cv::FILLED);
+}
+
+// Apples are drawn over the snake, as in the original full redraw
+template <typename Game>
+void SnakeRenderer::paintCell(const Game& game, int x, int y) {
+    if (!view.contains(cv::Point(x, y))) return;
+    cv::Rect cell((x - view.x) * cellSize, (y - view.y) * cellSize, cellSize, cellSize);
+    SnakePoint apple = game.getApple();
+    SnakePoint specialApple = game.getSpecialApple();
+    SnakePoint pinkApple = game.getPinkApple();
+
+    if (x == pinkApple.x && y == pinkApple.y) {
+        cv::rectangle(board, cell, PINK_APPLE_COLOR, cv::FILLED);
+    }
+    else if (x == specialApple.x && y == specialApple.y) {
+        cv::rectangle(board, cell, SPECIAL_APPLE_COLOR, cv::FILLED);
+    }
+    else if (x == apple.x && y == apple.y) {
+        cv::rectangle(board, cell, APPLE_COLOR, cv::FILLED);
+    }
+    else if (game.isSnakeAt(x, y)) {
+        int index = std::max(snakeAt(game, x, y), 0);
+        cv::rectangle(board, cell, snakeColor(index, ((drawnInvincible >> index) & 1) != 0), cv::FILLED);
+    }
+    else {
+        background(cell).copyTo(board(cell));
+    }
+}
+
+// Snake and apples inside a block of cells; the block must already show the background
+template <typename Game>
+void SnakeRenderer::paintCells(const Game& game, cv::Rect cells) {
+    background(cv::Rect((cells.x - view.x) * cellSize, (cells.y - view.y) * cellSize, cells.width * cellSize, cells.height * cellSize))
+        .copyTo(board(cv::Rect((cells.x - view.x) * cellSize, (cells.y - view.y) * cellSize, cells.width * cellSize, cells.height * cellSize)));
+    for (int y = cells.y; y < cells.y + cells.height; ++y) {
+        for (int x = cells.x; x < cells.x + cells.width; ++x) {
+            if (game.isSnakeAt(x, y)) paintCell(game, x, y);
+        }
+    }
+    SnakePoint items[] = { game.getApple(), game.getSpecialApple(), game.getPinkApple() };
+    for (const SnakePoint& item : items) {
+        if (cells.contains(cv::Point(item.x, item.y))) paintCell(game, item.x, item.y);
+    }
+}
+
+template <typename Game>
+void SnakeRenderer::repaintBoard(const Game& game) {
+    board.create(background.rows, background.cols, CV_8UC3);
+    paintCells(game, view);
+}
+
+void SnakeRenderer::present(const cv::Mat& layer, cv::Mat& frame) const {
+    if (frame.cols != layer.cols || frame.rows != layer.rows) {
+        frame = BACKGROUND_COLOR;
+    }
+    cv::Rect area(0, 0, std::min(frame.cols, layer.cols), std::min(frame.rows, layer.rows));
+    layer(area).copyTo(frame(area));
+}
+
+template <typename Game>
+void SnakeRenderer::renderGame(Game& game, cv::Mat& frame) {
+    bool fullRepaint = game.isAllDirty();
+
+    cv::Rect wanted = viewFor(game.map, frame);
+    if (!viewValid || wanted.width != view.width || wanted.height != view.height) {
+        view = wanted;
+        viewValid = true;
+        drawnMap = nullptr; // Different viewport size: start over
+    }
+    if (drawnMap != &game.map || drawnRevision != game.map.getRevision() || background.empty()) {
+        rebuildBackground(game.map);
+        fullRepaint = true;
+    }
+    uint32_t invincible = invincibleSnakes(game);
+    if (drawnInvincible != invincible) {
+        drawnInvincible = invincible;
+        fullRepaint = true; // Every visible segment of a snake changes color
+    }
+
+    if (fullRepaint || board.cols != background.cols || board.rows != background.rows) {
+        repaintBoard(game);
+    }
+    followHead(game);
+    if (!fullRepaint) {
+        int cols = game.map.getCols();
+        for (int cell : game.getDirtyCells()) {
+            paintCell(game, cell % cols, cell / cols);
+        }
+    }
+    game.clearDirtyCells();
+
+    present(board, frame);
+}
+
+void SnakeRenderer::render(SnakeCore& game, cv::Mat& frame) {
+    renderGame(game, frame);
+}
+
+void SnakeRenderer::render(MultiSnakeCore& game, cv::Mat& frame) {
+    renderGame(game, frame);
+}
+
+void SnakeRenderer::renderBackground(const Map& map, cv::Mat& frame) {
+    cv::Rect wanted = viewFor(map, frame);
+    if (!viewValid || wanted != view) {
+        view = wanted;
+        viewValid = true;
+        drawnMap = nullptr;
+    }
+    if (drawnMap != &map || drawnRevision != map.getRevision() || background.empty()) {
+        rebuildBackground(map);
+        board.release(); // The board is stale too
+    }
+    present(background, frame);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "SnakeCore.h"
+
+class MultiSnakeCore;
+
+// Retained board renderer with a scrolling camera.
+// Only the viewport (the part of the board that fits in the frame) is ever
+// rasterized. The obstacles of the viewport are kept pre-rasterized in a
+// background layer (rebuilt when the map revision changes), and a board image
+// on top of it is patched cell by cell from the game's dirty list. When the
+// camera follows the head, both layers are shifted and only the newly exposed
+// strip of cells is drawn, so frame time depends on the viewport size alone.
+// Draws a SnakeCore or a MultiSnakeCore (each snake in its own color; the camera
+// follows the first snake still on the board).
+class SnakeRenderer
+{
+private:
+    int cellSize;
+    cv::Mat background;     // black + obstacles of the viewport
+    cv::Mat board;          // background + snake + apples, as of the last frame
+    cv::Mat scratch;        // target when scrolling a layer
+    const Map* drawnMap;
+    unsigned drawnRevision;
+    uint32_t drawnInvincible;   // bit per snake
+    cv::Rect view;          // viewport in cells
+    bool viewValid;
+
+    cv::Rect viewFor(const Map& map, const cv::Mat& frame) const;
+    template <typename Game> void followHead(const Game& game);
+    template <typename Game> void scrollTo(const Game& game, int x, int y);
+    void rebuildBackground(const Map& map);
+    void paintBackgroundCell(const Map& map, int x, int y);
+    template <typename Game> void paintCell(const Game& game, int x, int y);
+    template <typename Game> void paintCells(const Game& game, cv::Rect cells);
+    template <typename Game> void repaintBoard(const Game& game);
+    template <typename Game> void renderGame(Game& game, cv::Mat& frame);
+    void present(const cv::Mat& layer, cv::Mat& frame) const;
+
+public:
+    SnakeRenderer(int cellSize);
+
+    // Bring the viewport up to date and copy it into the top-left of frame; consumes the game's dirty cells
+    void render(SnakeCore& game, cv::Mat& frame);
+    void render(MultiSnakeCore& game, cv::Mat& frame);
+
+    // Obstacles only, as shown behind the "Game Over" text
+    void renderBackground(const Map& map, cv::Mat& frame);
+
+    void invalidate() { drawnMap = nullptr; viewValid = false; }
+    cv::Rect getView() const { return view; }
+
+    // Color of snake `index` (0 is the single player's), for the HUD as well
+    static cv::Scalar snakeColor(int index, bool invincible = false);
+};
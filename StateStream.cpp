@@ -0,0 +1,578 @@
+#include "StateStream.h"
+#include "GameRng.h"
+#include "Replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+// Record layout, see StateStream.h
+#define HEAD_MASK 0x07
+#define HEAD_MOVED 5
+#define HEAD_KEYFRAME 7
+#define TAIL_POPPED 0x08
+#define ITEMS_MOVED 0x10
+#define STATUS_CHANGED 0x20
+#define SCORE_CHANGED 0x40
+#define TAIL_POPPED_MANY 0x80
+
+// Keyframe body encodings
+#define BODY_STEPS 0
+#define BODY_POINTS 1
+
+static void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static void writeSigned(std::vector<uint8_t>& out, int64_t value) {
+    writeVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void writePoint(std::vector<uint8_t>& out, SnakePoint pt) {
+    writeSigned(out, pt.x);
+    writeSigned(out, pt.y);
+}
+
+// Bounds-checked reads; running past the end sets `truncated` and reads zeros
+struct StreamReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    bool truncated;
+
+    StreamReader(const std::vector<uint8_t>& bytes, size_t offset) : data(bytes.data()), size(bytes.size()), offset(offset), truncated(false) {}
+
+    uint8_t byte() {
+        if (offset >= size) {
+            truncated = true;
+            return 0;
+        }
+        return data[offset++];
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        return value;
+    }
+
+    int64_t signedVarint() {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    SnakePoint point() {
+        int x = (int)signedVarint();
+        int y = (int)signedVarint();
+        return SnakePoint(x, y);
+    }
+
+    void skip(size_t count) {
+        if (size - offset < count) {
+            truncated = true;
+            offset = size;
+        }
+        else offset += count;
+    }
+};
+
+static bool samePoint(SnakePoint a, SnakePoint b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// One cell in `dir`, across the edge of the board: how an invincible snake moves, and the same
+// as a plain step everywhere else
+static SnakePoint stepFrom(SnakePoint pt, int dir, int rows, int cols) {
+    switch (dir) {
+    case UP: pt.y = pt.y > 0 ? pt.y - 1 : rows - 1; break;
+    case DOWN: pt.y = pt.y < rows - 1 ? pt.y + 1 : 0; break;
+    case LEFT: pt.x = pt.x > 0 ? pt.x - 1 : cols - 1; break;
+    case RIGHT: pt.x = pt.x < cols - 1 ? pt.x + 1 : 0; break;
+    }
+    return pt;
+}
+
+// Direction of the step from `from` to `to`, -1 if they are not neighbours
+static int stepBetween(SnakePoint from, SnakePoint to, int rows, int cols) {
+    if (from.x == to.x) {
+        if (to.y == (from.y > 0 ? from.y - 1 : rows - 1)) return UP;
+        if (to.y == (from.y < rows - 1 ? from.y + 1 : 0)) return DOWN;
+    }
+    else if (from.y == to.y) {
+        if (to.x == (from.x > 0 ? from.x - 1 : cols - 1)) return LEFT;
+        if (to.x == (from.x < cols - 1 ? from.x + 1 : 0)) return RIGHT;
+    }
+    return -1;
+}
+
+static uint8_t packStatus(Direction dir, bool invincible, bool gameOver, bool boardFull, DeathCause cause) {
+    return (uint8_t)(dir | (invincible ? 0x04 : 0) | (gameOver ? 0x08 : 0) | (boardFull ? 0x10 : 0) | (cause << 5));
+}
+
+static void unpackStatus(uint8_t status, StreamState& state) {
+    state.dir = (Direction)(status & 0x03);
+    state.invincible = (status & 0x04) != 0;
+    state.gameOver = (status & 0x08) != 0;
+    state.boardFull = (status & 0x10) != 0;
+    state.deathCause = (DeathCause)(status >> 5);
+}
+
+StreamState::StreamState() : tick(0), hearts(0), score(0), dir(UP), invincible(false), gameOver(false), boardFull(false), deathCause(NO_DEATH) {}
+
+void StreamState::capture(const SnakeCore& game, int64_t tick) {
+    this->tick = tick;
+    body.clear();
+    body.reserve(game.getSnake().size());
+    const SnakeBody& snake = game.getSnake();
+    for (size_t i = snake.size(); i-- > 0; ) body.pushFront(snake[i]);
+    apple = game.getApple();
+    specialApple = game.getSpecialApple();
+    pinkApple = game.getPinkApple();
+    hearts = game.getHearts();
+    score = game.getScore();
+    dir = game.getDirection();
+    invincible = game.isSnakeInvincible();
+    gameOver = game.isGameOver();
+    boardFull = game.isBoardFull();
+    deathCause = game.getDeathCause();
+}
+
+StateStreamEncoder::StateStreamEncoder() : rows(0), cols(0), lastTick(0), records(0), keyframes(0), hearts(0), status(0), score(0) {}
+
+void StateStreamEncoder::begin(const SnakeCore& game) {
+    rows = game.map.getRows();
+    cols = game.map.getCols();
+    records = 0;
+    keyframes = 0;
+
+    StateStreamHeader header;
+    memcpy(header.magic, STATE_STREAM_MAGIC, 4);
+    header.version = STATE_STREAM_VERSION;
+    header.headerSize = sizeof(StateStreamHeader);
+    header.seed = game.getSeed();
+    header.mapHash = mapContentHash(game.map);
+    header.rows = (uint32_t)rows;
+    header.cols = (uint32_t)cols;
+    header.keyframeInterval = STATE_KEYFRAME_INTERVAL;
+    header.mapNameLength = (uint32_t)game.map.getMapFile().size();
+
+    bytes.clear();
+    bytes.insert(bytes.end(), (const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+    bytes.insert(bytes.end(), game.map.getMapFile().begin(), game.map.getMapFile().end());
+    lastTick = game.getTickCount();
+    writeKeyframe(game);
+}
+
+void StateStreamEncoder::remember(const SnakeCore& game) {
+    items[0] = game.getApple();
+    items[1] = game.getSpecialApple();
+    items[2] = game.getPinkApple();
+    hearts = game.getHearts();
+    status = packStatus(game.getDirection(), game.isSnakeInvincible(), game.isGameOver(), game.isBoardFull(), game.getDeathCause());
+    score = game.getScore();
+    records++;
+}
+
+void StateStreamEncoder::writeKeyframe(const SnakeCore& game) {
+    const SnakeBody& snake = game.getSnake();
+    bytes.push_back(HEAD_KEYFRAME);
+    writeVarint(bytes, (uint64_t)records);
+    writeVarint(bytes, snake.size());
+
+    // Steps between neighbouring segments, four to a byte; points if the body is not connected
+    bool connected = true;
+    for (size_t i = 1; i < snake.size() && connected; ++i) {
+        connected = stepBetween(snake[i - 1], snake[i], rows, cols) >= 0;
+    }
+    bytes.push_back(connected ? BODY_STEPS : BODY_POINTS);
+    if (!snake.empty()) writePoint(bytes, snake.front());
+    if (connected) {
+        uint8_t packed = 0;
+        for (size_t i = 1; i < snake.size(); ++i) {
+            packed |= (uint8_t)(stepBetween(snake[i - 1], snake[i], rows, cols) << ((i - 1) % 4 * 2));
+            if ((i - 1) % 4 == 3 || i == snake.size() - 1) {
+                bytes.push_back(packed);
+                packed = 0;
+            }
+        }
+    }
+    else {
+        for (size_t i = 1; i < snake.size(); ++i) writePoint(bytes, snake[i]);
+    }
+
+    writePoint(bytes, game.getApple());
+    writePoint(bytes, game.getSpecialApple());
+    writePoint(bytes, game.getPinkApple());
+    writeSigned(bytes, game.getHearts());
+    bytes.push_back(packStatus(game.getDirection(), game.isSnakeInvincible(), game.isGameOver(), game.isBoardFull(), game.getDeathCause()));
+    writeVarint(bytes, game.getScore());
+
+    body.clear();
+    body.reserve(snake.size() + 1);     // and the next head
+    for (size_t i = snake.size(); i-- > 0; ) body.pushFront(snake[i]);
+    keyframes++;
+    remember(game);
+}
+
+void StateStreamEncoder::encode(const SnakeCore& game) {
+    if (bytes.empty()) {
+        begin(game);
+        return;
+    }
+    int64_t tick = game.getTickCount();
+    if (tick == lastTick) return;
+    bool jumped = tick != lastTick + 1;
+    lastTick = tick;
+
+    // A delta holds if the body is the last one with at most a new head and some tail cut off;
+    // anything else (a new game, a restored snapshot) is a keyframe
+    const SnakeBody& snake = game.getSnake();
+    size_t length = body.size();
+    bool pushed = !snake.empty() && !body.empty() && !samePoint(snake.front(), body.front());
+    size_t pops = length + (pushed ? 1 : 0) - snake.size();
+    bool fits = !jumped && records % STATE_KEYFRAME_INTERVAL != 0 && !snake.empty() && !body.empty()
+        && snake.size() <= length + (pushed ? 1 : 0) && pops <= length;
+    if (fits && pops < length) fits = samePoint(snake.back(), body[length - 1 - pops]);
+    if (fits && pushed && snake.size() > 1) fits = samePoint(snake[1], body.front());
+    if (!fits) {
+        writeKeyframe(game);
+        return;
+    }
+
+    SnakePoint head = snake.front();
+    int step = pushed ? stepBetween(body.front(), head, rows, cols) : -1;
+    uint8_t flags = !pushed ? 0 : (step >= 0 ? (uint8_t)(step + 1) : (uint8_t)HEAD_MOVED);
+    if (pops == 1) flags |= TAIL_POPPED;
+    else if (pops > 1) flags |= TAIL_POPPED_MANY;
+
+    SnakePoint now[3] = { game.getApple(), game.getSpecialApple(), game.getPinkApple() };
+    uint8_t moved = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (!samePoint(now[i], items[i])) moved |= (uint8_t)(1 << i);
+    }
+    if (moved) flags |= ITEMS_MOVED;
+    // A one-cell step also tells the direction, so turning costs no status bytes
+    uint8_t nowStatus = packStatus(game.getDirection(), game.isSnakeInvincible(), game.isGameOver(), game.isBoardFull(), game.getDeathCause());
+    uint8_t impliedStatus = step >= 0 ? (uint8_t)((status & ~0x03) | step) : status;
+    if (game.getHearts() != hearts || nowStatus != impliedStatus) flags |= STATUS_CHANGED;
+    if (game.getScore() != score) flags |= SCORE_CHANGED;
+
+    bytes.push_back(flags);
+    if ((flags & HEAD_MASK) == HEAD_MOVED) writePoint(bytes, head);
+    if (flags & TAIL_POPPED_MANY) writeVarint(bytes, pops);
+    if (moved) {
+        bytes.push_back(moved);
+        for (int i = 0; i < 3; ++i) {
+            if (moved & (1 << i)) writePoint(bytes, now[i]);
+        }
+    }
+    if (flags & STATUS_CHANGED) {
+        writeSigned(bytes, game.getHearts());
+        bytes.push_back(nowStatus);
+    }
+    if (flags & SCORE_CHANGED) writeVarint(bytes, game.getScore());
+
+    for (size_t i = 0; i < pops; ++i) body.popBack();
+    if (pushed) body.pushFront(head);
+    remember(game);
+}
+
+StateStreamDecoder::StateStreamDecoder() : hasHeader(false), corrupt(false), scanned(0), ticks(0), cursorOffset(0), cursorValid(false) {
+    memset(&header, 0, sizeof(header));
+}
+
+bool StateStreamDecoder::load(const std::string& fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    *this = StateStreamDecoder();
+    append(data.data(), data.size());
+    return isValid();
+}
+
+void StateStreamDecoder::append(const uint8_t* data, size_t size) {
+    bytes.insert(bytes.end(), data, data + size);
+    scan();
+}
+
+// Indexes the records that have arrived in full
+void StateStreamDecoder::scan() {
+    if (corrupt) return;
+    if (!hasHeader) {
+        if (bytes.size() < sizeof(StateStreamHeader)) return;
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, STATE_STREAM_MAGIC, 4) != 0 || header.version != STATE_STREAM_VERSION || header.headerSize < sizeof(header)
+            || header.rows == 0 || header.cols == 0 || header.rows > 32767 || header.cols > 32767) {
+            corrupt = true;
+            return;
+        }
+        if (bytes.size() < (size_t)header.headerSize + header.mapNameLength) return;
+        mapFile.assign((const char*)bytes.data() + header.headerSize, header.mapNameLength);
+        scanned = header.headerSize + header.mapNameLength;
+        hasHeader = true;
+    }
+
+    while (scanned < bytes.size()) {
+        size_t offset = scanned;
+        int64_t keyframeTick = -1;
+        bool truncated = false;
+        if (!readRecord(offset, nullptr, keyframeTick, truncated)) {
+            corrupt = !truncated;
+            return;
+        }
+        if (keyframeTick >= 0) {
+            if (keyframeTick != ticks) {
+                corrupt = true;
+                return;
+            }
+            Keyframe keyframe;
+            keyframe.tick = ticks;
+            keyframe.offset = scanned;
+            keyframes.push_back(keyframe);
+        }
+        else if (ticks == 0) {
+            corrupt = true; // nothing to apply the first delta to
+            return;
+        }
+        ticks++;
+        scanned = offset;
+    }
+}
+
+bool StateStreamDecoder::readRecord(size_t& offset, StreamState* state, int64_t& keyframeTick, bool& truncated) {
+    int rows = (int)header.rows, cols = (int)header.cols;
+    StreamReader reader(bytes, offset);
+    uint8_t flags = reader.byte();
+    int headCode = flags & HEAD_MASK;
+    keyframeTick = -1;
+
+    if (headCode == HEAD_KEYFRAME) {
+        keyframeTick = (int64_t)reader.varint();
+        uint64_t length = reader.varint();
+        uint8_t mode = reader.byte();
+        if (reader.truncated || mode > BODY_POINTS) {
+            truncated = reader.truncated;
+            return false;
+        }
+        // An invincible snake running over itself can be longer than the board has cells, so the
+        // length is only bounded by the bytes it takes: at least a quarter byte per segment
+        if (length > 0 && (length - 1) / 4 > reader.size - reader.offset) {
+            truncated = true;
+            return false;
+        }
+        if (state) segments.clear();
+        if (length > 0) {
+            SnakePoint pt = reader.point();
+            if (state) segments.push_back(pt);
+            if (mode == BODY_STEPS && !state) reader.skip((size_t)(length - 1 + 3) / 4);
+            else if (mode == BODY_STEPS) {
+                uint8_t packed = 0;
+                for (uint64_t i = 1; i < length; ++i) {
+                    if ((i - 1) % 4 == 0) packed = reader.byte();
+                    pt = stepFrom(pt, (packed >> ((i - 1) % 4 * 2)) & 0x03, rows, cols);
+                    segments.push_back(pt);
+                }
+            }
+            else {
+                for (uint64_t i = 1; i < length; ++i) {
+                    pt = reader.point();
+                    if (state) segments.push_back(pt);
+                }
+            }
+        }
+        SnakePoint apple = reader.point();
+        SnakePoint specialApple = reader.point();
+        SnakePoint pinkApple = reader.point();
+        int hearts = (int)reader.signedVarint();
+        uint8_t status = reader.byte();
+        size_t score = (size_t)reader.varint();
+        if (reader.truncated) {
+            truncated = true;
+            return false;
+        }
+        if (state) {
+            state->tick = keyframeTick;
+            state->body.clear();
+            state->body.reserve(segments.size() + 1);
+            for (size_t i = segments.size(); i-- > 0; ) state->body.pushFront(segments[i]);
+            state->apple = apple;
+            state->specialApple = specialApple;
+            state->pinkApple = pinkApple;
+            state->hearts = hearts;
+            unpackStatus(status, *state);
+            state->score = score;
+        }
+        offset = reader.offset;
+        return true;
+    }
+
+    if (headCode > HEAD_MOVED) return false;
+    SnakePoint head;
+    if (headCode == HEAD_MOVED) head = reader.point();
+    uint64_t pops = (flags & TAIL_POPPED) ? 1 : 0;
+    if (flags & TAIL_POPPED_MANY) pops = reader.varint();
+    uint8_t moved = (flags & ITEMS_MOVED) ? reader.byte() : 0;
+    SnakePoint items[3];
+    for (int i = 0; i < 3; ++i) {
+        if (moved & (1 << i)) items[i] = reader.point();
+    }
+    int hearts = 0;
+    uint8_t status = 0;
+    if (flags & STATUS_CHANGED) {
+        hearts = (int)reader.signedVarint();
+        status = reader.byte();
+    }
+    size_t score = (flags & SCORE_CHANGED) ? (size_t)reader.varint() : 0;
+    if (reader.truncated) {
+        truncated = true;
+        return false;
+    }
+
+    if (state) {
+        SnakeBody& body = state->body;
+        if (body.empty() || pops > body.size()) return false;
+        if (headCode >= 1 && headCode <= 4) {
+            head = stepFrom(body.front(), headCode - 1, rows, cols);
+            state->dir = (Direction)(headCode - 1);
+        }
+        for (uint64_t i = 0; i < pops; ++i) body.popBack();
+        if (headCode != 0) body.pushFront(head);
+        if (moved & 1) state->apple = items[0];
+        if (moved & 2) state->specialApple = items[1];
+        if (moved & 4) state->pinkApple = items[2];
+        if (flags & STATUS_CHANGED) {
+            state->hearts = hearts;
+            unpackStatus(status, *state);
+        }
+        if (flags & SCORE_CHANGED) state->score = score;
+        state->tick++;
+    }
+    offset = reader.offset;
+    return true;
+}
+
+bool StateStreamDecoder::seek(int64_t tick) {
+    if (!isValid() || tick < 0 || tick >= ticks) return false;
+
+    // Nearest keyframe at or before the tick; the last decoded state instead if it lies in between
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), tick, [](int64_t t, const Keyframe& k) { return t < k.tick; });
+    const Keyframe& keyframe = *(next - 1);
+    if (!cursorValid || cursor.tick > tick || cursor.tick < keyframe.tick) {
+        size_t offset = keyframe.offset;
+        int64_t keyframeTick;
+        bool truncated = false;
+        cursorValid = readRecord(offset, &cursor, keyframeTick, truncated);
+        if (!cursorValid) return false;
+        cursorOffset = offset;
+    }
+    while (cursor.tick < tick) {
+        int64_t keyframeTick;
+        bool truncated = false;
+        if (!readRecord(cursorOffset, &cursor, keyframeTick, truncated)) {
+            cursorValid = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a over everything a spectator sees
+static uint64_t streamStateHash(const StreamState& state) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](uint64_t value) { hash = (hash ^ value) * 0x100000001b3ULL; };
+    auto mixPoint = [&mix](SnakePoint pt) { mix(((uint64_t)(uint32_t)pt.x << 32) | (uint32_t)pt.y); };
+    mix((uint64_t)state.tick);
+    mix(state.body.size());
+    for (SnakePoint pt : state.body) mixPoint(pt);
+    mixPoint(state.apple);
+    mixPoint(state.specialApple);
+    mixPoint(state.pinkApple);
+    mix((uint64_t)state.hearts);
+    mix(state.score);
+    mix(packStatus(state.dir, state.invincible, state.gameOver, state.boardFull, state.deathCause));
+    return hash;
+}
+
+bool checkStateStream(const std::string& replayFile, std::ostream& out) {
+    typedef std::chrono::steady_clock Clock;
+    out << replayFile << ": ";
+    ReplayRecording recording;
+    if (!recording.load(replayFile)) {
+        out << "FAILED (not a recording)" << std::endl;
+        return false;
+    }
+    Map map(recording.getRows(), recording.getCols(), recording.getMapFile());
+    map.load();
+
+    // Tick 0 is the game as it starts, before its first update, as SnakeGame streams it
+    SnakeCore start(map, recording.getSeed());
+    start.newGame(recording.getSeed());
+    StateStreamEncoder encoder;
+    encoder.begin(start);
+    StreamState state;
+    state.capture(start, 0);
+    std::vector<uint64_t> expected(1, streamStateHash(state));
+
+    Clock::duration encodeTime = Clock::duration::zero();
+    ReplayResult result = replayGame(recording, map, [&](SnakeCore& game) {
+        Clock::time_point before = Clock::now();
+        encoder.encode(game);
+        encodeTime += Clock::now() - before;
+        state.capture(game, (int64_t)expected.size());
+        expected.push_back(streamStateHash(state));
+    });
+    if (!result.passed()) {
+        out << "FAILED (the recording does not replay)" << std::endl;
+        return false;
+    }
+
+    // Forward, as a spectator watches, with the bytes arriving a few at a time
+    StateStreamDecoder decoder;
+    const std::vector<uint8_t>& bytes = encoder.getBytes();
+    const size_t CHUNK = 61;
+    int64_t firstMismatch = -1;
+    int64_t decoded = 0;
+    Clock::time_point forwardStart = Clock::now();
+    for (size_t offset = 0; offset < bytes.size() && firstMismatch < 0; offset += CHUNK) {
+        decoder.append(bytes.data() + offset, std::min(CHUNK, bytes.size() - offset));
+        for (; decoded < decoder.getTickCount(); ++decoded) {
+            if (!decoder.seek(decoded) || streamStateHash(decoder.getState()) != expected[decoded]) {
+                firstMismatch = decoded;
+                break;
+            }
+        }
+    }
+    double forwardSeconds = std::chrono::duration<double>(Clock::now() - forwardStart).count();
+    if (firstMismatch < 0 && (!decoder.isValid() || decoder.getTickCount() != (int64_t)expected.size())) firstMismatch = decoder.getTickCount();
+
+    // Scrubbing: jumps to random ticks
+    const int SEEKS = 1000;
+    GameRng rng(recording.getSeed());
+    Clock::time_point seekStart = Clock::now();
+    for (int i = 0; i < SEEKS && firstMismatch < 0; ++i) {
+        int64_t tick = (int64_t)rng.nextBelow((uint32_t)expected.size());
+        if (!decoder.seek(tick) || streamStateHash(decoder.getState()) != expected[tick]) firstMismatch = tick;
+    }
+    double seekSeconds = std::chrono::duration<double>(Clock::now() - seekStart).count();
+
+    if (firstMismatch >= 0) {
+        out << "FAILED (decoded state differs at tick " << firstMismatch << ")" << std::endl;
+        return false;
+    }
+    double ticks = (double)expected.size();
+    out << "ok, " << expected.size() << " ticks, " << bytes.size() << " bytes (" << std::fixed << std::setprecision(2)
+        << bytes.size() / ticks << " per tick, " << encoder.getKeyframeCount() << " keyframes)" << std::setprecision(0)
+        << "  encode: " << std::chrono::duration<double, std::nano>(encodeTime).count() / ticks << " ns/tick"
+        << "  decode: " << forwardSeconds * 1e9 / ticks << " ns/tick"
+        << "  seek: " << std::setprecision(1) << seekSeconds * 1e6 / SEEKS << " us" << std::endl;
+    return true;
+}
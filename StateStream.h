@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SnakeBody.h"
+#include "SnakeCore.h"
+
+// Per-tick game state stream (.sstm): a StateStreamHeader, then one record per tick.
+// Most ticks change a head, a tail and nothing else, so a delta record is one flags byte:
+//   bits 0-2   head: 0 unchanged, 1-4 one step UP/DOWN/LEFT/RIGHT (across the edge when
+//              invincible), which is the snake's direction from then on, 5 moved elsewhere
+//              (x, y follow); 7 marks a keyframe record
+//   bit 3      one tail segment removed
+//   bit 4      items moved: a byte follows (bit 0 apple, 1 special apple, 2 pink apple),
+//              then x, y of each of them
+//   bit 5      hearts and status changed: hearts, status byte follow
+//   bit 6      score changed: the score follows
+//   bit 7      more tail segments removed: their number follows
+// A keyframe holds the whole state: tick, body (head, then 2-bit steps to each next segment),
+// items, hearts, status and score. One is written at the start and every
+// STATE_KEYFRAME_INTERVAL ticks, so any tick is at most that many deltas from a keyframe.
+// Numbers are LEB128 varints, signed ones zigzag-coded.
+#define STATE_STREAM_MAGIC "SNKS"
+#define STATE_STREAM_VERSION 1
+#define STATE_KEYFRAME_INTERVAL 256
+
+#pragma pack(push, 1)
+struct StateStreamHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t seed;
+    uint64_t mapHash;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t keyframeInterval;
+    uint32_t mapNameLength;     // the map file name follows the header
+};
+#pragma pack(pop)
+
+// The game as a spectator sees it at one tick
+struct StreamState {
+    int64_t tick;               // records since the stream began: one per update
+    SnakeBody body;             // head first
+    SnakePoint apple;
+    SnakePoint specialApple;
+    SnakePoint pinkApple;
+    int hearts;
+    size_t score;
+    Direction dir;
+    bool invincible;
+    bool gameOver;
+    bool boardFull;
+    DeathCause deathCause;
+
+    StreamState();
+    void capture(const SnakeCore& game, int64_t tick);
+};
+
+// Appends a record to the stream after every update: a few compares against the last
+// state seen and one to three bytes on a typical tick.
+class StateStreamEncoder
+{
+private:
+    std::vector<uint8_t> bytes;
+    int rows, cols;
+    int64_t lastTick;           // game tick count at the last record
+    int64_t records;
+    size_t keyframes;
+    // The state as of the last record; the body is followed with one push and pop per tick
+    SnakeBody body;
+    SnakePoint items[3];
+    int hearts;
+    uint8_t status;
+    size_t score;
+
+    void remember(const SnakeCore& game);
+    void writeKeyframe(const SnakeCore& game);
+
+public:
+    StateStreamEncoder();
+
+    // Call after game.newGame(seed) or restore(); starts a new stream with a keyframe
+    void begin(const SnakeCore& game);
+    // Call after every update (begins the stream if begin() was not called); nothing when the
+    // game did not tick, a keyframe when its tick count did not move on by exactly one
+    void encode(const SnakeCore& game);
+
+    const std::vector<uint8_t>& getBytes() const { return bytes; }
+    int64_t getTickCount() const { return records; }
+    size_t getKeyframeCount() const { return keyframes; }
+    std::string serialize() const { return std::string(bytes.begin(), bytes.end()); }
+};
+
+// Rebuilds the state at any tick from a stream, a file or bytes as they arrive (spectators).
+// Keyframes are indexed as records come in; seek() starts from the nearest keyframe at or
+// before the tick, or goes on from the last decoded state when that is closer, so playing
+// forward costs one delta per tick and a jump at most STATE_KEYFRAME_INTERVAL deltas.
+class StateStreamDecoder
+{
+private:
+    struct Keyframe {
+        int64_t tick;
+        size_t offset;
+    };
+
+    std::vector<uint8_t> bytes;
+    StateStreamHeader header;
+    std::string mapFile;
+    bool hasHeader;
+    bool corrupt;
+    size_t scanned;             // end of the last complete record
+    int64_t ticks;              // records indexed
+    std::vector<Keyframe> keyframes;
+
+    StreamState cursor;         // last decoded state
+    size_t cursorOffset;        // record after it
+    bool cursorValid;
+    std::vector<SnakePoint> segments;   // keyframe body, head first
+
+    void scan();
+    // Reads the record at offset into state (or only skips it when state is null); false when
+    // the record is cut off (truncated) or malformed
+    bool readRecord(size_t& offset, StreamState* state, int64_t& keyframeTick, bool& truncated);
+
+public:
+    StateStreamDecoder();
+
+    bool load(const std::string& fileName);
+    // Adds stream bytes (a spectator reading a live stream); records become seekable once complete
+    void append(const uint8_t* data, size_t size);
+
+    bool isValid() const { return hasHeader && !corrupt; }
+    const StateStreamHeader& getHeader() const { return header; }
+    const std::string& getMapFile() const { return mapFile; }
+    int64_t getTickCount() const { return ticks; }        // ticks 0 .. getTickCount() - 1 can be sought
+    size_t getKeyframeCount() const { return keyframes.size(); }
+    size_t getByteCount() const { return bytes.size(); }
+
+    // Decodes the state at `tick` (see getState); false if the stream does not reach it
+    bool seek(int64_t tick);
+    const StreamState& getState() const { return cursor; }
+};
+
+// Replays a recorded game (.srec) with the encoder attached, then checks that the decoded
+// stream matches the game at every tick, played forward and sought at random.
+bool checkStateStream(const std::string& replayFile, std::ostream& out);
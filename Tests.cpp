@@ -0,0 +1,493 @@
+// Regression tests for the game core (no OpenCV, no window).
+// Usage: snake_tests
+// Prints every failed check and exits with 1 if there was one.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include "Map.h"
+#include "BinaryMap.h"
+#include "SnakeCore.h"
+#include "MultiSnakeCore.h"
+#include "SnakeBatch.h"
+#include "GameRng.h"
+#include "FreeCellIndex.h"
+#include "MapRegions.h"
+#include "MapGenerator.h"
+#include "GameServer.h"
+#include "GameLoop.h"
+#include "Replay.h"
+#include "StateStream.h"
+
+static int failures = 0;
+
+// Every allocation of the program, on any thread
+static std::atomic<int64_t> allocations(0);
+
+// GCC takes the free() in a replaced operator delete for a mismatch with operator new; both
+// are replaced here as a malloc/free pair, so the warning does not apply
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cout << "FAIL " << what << std::endl;
+    failures++;
+}
+
+static bool samePoint(SnakePoint a, SnakePoint b) { return a.x == b.x && a.y == b.y; }
+
+// A board with a wall across part of it and a block left of the center, so the snake
+// spawns right of the center and steering is not trivial
+static Map testMap(int rows, int cols) {
+    Map map(rows, cols, "");
+    std::vector<int> wall;
+    for (int x = cols / 4; x < cols * 3 / 4; ++x) wall.push_back((rows / 3) * cols + x);
+    for (int y = rows / 2 - 3; y <= rows / 2 + 3; ++y) {
+        for (int x = cols / 2 - 3; x <= cols / 2; ++x) wall.push_back(y * cols + x);
+    }
+    map.setCells(wall, 1);
+    return map;
+}
+
+// One snake on MultiSnakeCore must play the same game as SnakeCore with the same map, seed and keys
+static void testSingleSnakeMatchesSnakeCore() {
+    Map map = testMap(20, 30);
+    for (uint64_t seed = 1; seed <= 20; ++seed) {
+        SnakeCore single(map, seed);
+        MultiSnakeCore multi(map, 1, seed);
+        single.newGame(seed);
+        multi.newGame(seed);
+        GameRng keys(seed);
+        std::string name = "single snake, seed " + std::to_string(seed);
+
+        check(single.getDirection() == multi.getPlayer(0).dir, name + ": starting direction");
+        for (int tick = 0; tick < 3000 && !single.isGameOver(); ++tick) {
+            int key = greedyMultiBot(multi, 0);
+            if (keys.next() % 8 == 0) key = "wasd"[keys.next() % 4];   // wander now and then, into walls too
+            if (key != -1) {
+                single.changeDirection(key);
+                multi.changeDirection(0, key);
+            }
+            single.update();
+            multi.update();
+
+            std::string at = name + ", tick " + std::to_string(tick);
+            const SnakePlayer& player = multi.getPlayer(0);
+            check(single.isGameOver() == multi.isGameOver(), at + ": game over");
+            check(single.getScore() == player.score, at + ": score");
+            check(single.getHearts() == player.hearts, at + ": hearts");
+            check(samePoint(single.getApple(), multi.getApple()), at + ": apple");
+            check(samePoint(single.getSpecialApple(), multi.getSpecialApple()), at + ": special apple");
+            check(samePoint(single.getPinkApple(), multi.getPinkApple()), at + ": pink apple");
+            // A snake that is out leaves MultiSnakeCore's board; SnakeCore keeps the last body
+            if (!multi.isGameOver()) {
+                check(single.getSnake().size() == player.body.size() && samePoint(single.getSnake().front(), player.body.front()), at + ": body");
+            }
+            if (failures > 0) return;
+        }
+    }
+}
+
+// Once running, the server's ticks (bots only, so no client traffic) must not allocate,
+// including the ticks that end a game and start the next one
+static void testServerTicksDoNotAllocate() {
+    Map map = testMap(12, 16);
+    ServerConfig config;
+    config.endpoint = "17779";
+    config.matches = 16;
+    config.playersPerMatch = 0;
+    config.snakesPerMatch = 4;
+    config.ticksPerSecond = 1000;
+    config.threads = 2;
+    config.seed = 7;
+    GameServer server(map, config);
+    if (!server.start()) {
+        check(false, "server: cannot listen on " + config.endpoint);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));    // the first games size their buffers
+    int64_t before = allocations.load();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    int64_t during = allocations.load() - before;
+    server.stop();
+
+    GameServer::ServerStats stats = server.getStats();
+    check(stats.ticks >= 300, "server: only " + std::to_string(stats.ticks) + " ticks");
+    check(during == 0, "server: " + std::to_string(during) + " allocations in 1 s of ticks");
+}
+
+// An invincible snake may run over itself and grow longer than the board has cells; the state
+// stream must still round-trip it, in keyframes and in deltas
+static void testStreamOfSnakeLongerThanBoard() {
+    Map map(4, 4, "");
+    SnakeCore game(map, 3);
+    game.newGame(3);
+    SnakeSnapshot snapshot;
+    game.snapshot(snapshot);
+    snapshot.body.clear();
+    for (int i = 0; i < 25; ++i) {
+        int x = i % 6 < 4 ? i % 6 : 6 - i % 6;     // back and forth along row 1: 0 1 2 3 2 1 0 1 ...
+        snapshot.body.push_back(SnakePoint(x, 1));
+    }
+    snapshot.dir = LEFT;
+    snapshot.isInvincible = true;
+    snapshot.invincibilityLeft = 1000000;
+    check(game.restore(snapshot), "long snake: restore");
+
+    StateStreamEncoder encoder;
+    encoder.begin(game);
+    std::vector<StreamState> expected(1);
+    expected[0].capture(game, 0);
+    GameRng keys(3);
+    for (int tick = 1; tick < 2 * STATE_KEYFRAME_INTERVAL && !game.isGameOver(); ++tick) {
+        if (keys.next() % 3 == 0) game.changeDirection("wasd"[keys.next() % 4]);
+        game.update();
+        encoder.encode(game);
+        expected.push_back(StreamState());
+        expected.back().capture(game, tick);
+    }
+    check(expected.back().body.size() > 17, "long snake: only " + std::to_string(expected.back().body.size()) + " segments");
+
+    StateStreamDecoder decoder;
+    decoder.append(encoder.getBytes().data(), encoder.getBytes().size());
+    check(decoder.isValid() && decoder.getTickCount() == (int64_t)expected.size(),
+        "long snake: " + std::to_string(decoder.getTickCount()) + " of " + std::to_string(expected.size()) + " ticks decoded");
+    for (int64_t tick = 0; tick < decoder.getTickCount(); ++tick) {
+        std::string at = "long snake, tick " + std::to_string(tick);
+        if (!decoder.seek(tick)) {
+            check(false, at + ": seek");
+            return;
+        }
+        const StreamState& state = decoder.getState();
+        const StreamState& want = expected[(size_t)tick];
+        bool sameBody = state.body.size() == want.body.size();
+        for (size_t i = 0; sameBody && i < want.body.size(); ++i) sameBody = samePoint(state.body[i], want.body[i]);
+        check(sameBody, at + ": body");
+        check(samePoint(state.apple, want.apple) && state.score == want.score && state.hearts == want.hearts
+            && state.dir == want.dir && state.invincible == want.invincible, at + ": items and status");
+        if (failures > 0) return;
+    }
+}
+
+// Every game of a SnakeBatch must play as SnakeCore with the same seed and keys; on a tiny board
+// invincible snakes run over themselves, so bodies outgrow the board and the batch's rings
+static void testBatchMatchesSnakeCore() {
+    const int GAMES = 64;
+    Map maps[] = { testMap(20, 30), Map(3, 4, "") };
+    for (Map& map : maps) {
+        SnakeBatch batch(map, GAMES, 100);
+        std::vector<SnakeCore> cores;
+        for (int g = 0; g < GAMES; ++g) cores.emplace_back(map, 100 + g);
+        batch.resetAll();
+        for (SnakeCore& core : cores) core.resetGame();
+        GameRng keys(5);
+        int longest = 0;
+        std::string name = "batch " + std::to_string(map.getRows()) + "x" + std::to_string(map.getCols());
+
+        for (int tick = 0; tick < 5000 && batch.getAliveCount() > 0; ++tick) {
+            for (int g = 0; g < GAMES; ++g) {
+                if (keys.next() % 4 != 0) continue;
+                int key = "wasd"[keys.next() % 4];
+                batch.changeDirection(g, key);
+                cores[g].changeDirection(key);
+            }
+            batch.step();
+            for (int g = 0; g < GAMES; ++g) {
+                cores[g].update();
+                std::string at = name + ", game " + std::to_string(g) + ", tick " + std::to_string(tick);
+                check(batch.getScore(g) == cores[g].getScore(), at + ": score");
+                check(batch.getLength(g) == (int)cores[g].getSnake().size(), at + ": length");
+                check(samePoint(batch.getHead(g), cores[g].getSnake().front()), at + ": head");
+                check(batch.getHearts(g) == cores[g].getHearts(), at + ": hearts");
+                check(batch.getDeathCause(g) == cores[g].getDeathCause(), at + ": death cause");
+                longest = std::max(longest, batch.getLength(g));
+                if (failures > 0) return;
+            }
+        }
+        if (map.getRows() == 3) {
+            check(longest > 32, name + ": longest body " + std::to_string(longest) + " did not outgrow the first ring (32 slots)");
+        }
+    }
+}
+
+// FreeCellIndex against a plain array: membership, size and the i-th member after random edits
+// across several 4096-cell blocks, and the same picks however the set was built
+static void testFreeCellIndex() {
+    const int CELLS = 10000;
+    FreeCellIndex index, rebuilt;
+    index.reset(CELLS);
+    std::vector<unsigned char> reference(CELLS, 0);
+    GameRng rng(11);
+    for (int round = 0; round < 20; ++round) {
+        for (int edit = 0; edit < 2000; ++edit) {
+            int cell = (int)rng.nextBelow(CELLS);
+            bool add = rng.nextBelow(3) != 0;
+            if (add) index.insert(cell);
+            else index.remove(cell);
+            reference[cell] = add ? 1 : 0;
+        }
+        std::vector<int> members;
+        for (int cell = 0; cell < CELLS; ++cell) {
+            if (reference[cell]) members.push_back(cell);
+        }
+        std::string at = "free cells, round " + std::to_string(round);
+        check(index.size() == (int)members.size(), at + ": size");
+        bool same = true;
+        for (int cell = 0; cell < CELLS && same; ++cell) same = index.contains(cell) == (reference[cell] != 0);
+        for (size_t i = 0; i < members.size() && same; ++i) same = index.at((int)i) == members[i];
+        check(same, at + ": members in row-major order");
+
+        rebuilt.assign(CELLS, [&](int cell) { return reference[cell] != 0; });
+        same = rebuilt.size() == index.size();
+        for (int i = 0; i < index.size() && same; ++i) same = rebuilt.at(i) == index.at(i);
+        check(same, at + ": assigned set picks the same cells");
+        if (failures > 0) return;
+    }
+}
+
+// A map saved as .smap loads back cell for cell (a width that is not a multiple of 8 included),
+// and so does one converted to text and back
+static void testBinaryMapRoundTrip() {
+    const std::string binaryPath = "tests_roundtrip.smap", textPath = "tests_roundtrip.txt", againPath = "tests_roundtrip_again.smap";
+    Map map(13, 21, "");
+    std::vector<int> scattered = { 0, 7, 8, 20, 21 * 3 + 5, 21 * 3 + 6, 21 * 3 + 7, 21 * 12 + 20 };
+    map.setCells(scattered, 1);
+    map.setMapFile(binaryPath);
+    check(map.save(), "smap: save");
+
+    Map loaded(0, 0, binaryPath);
+    check(loaded.load() && loaded.getRows() == 13 && loaded.getCols() == 21 && loaded.getMap() == map.getMap(), "smap: load");
+    check(convertBinaryMapToText(binaryPath, textPath) && convertTextMapToBinary(textPath, againPath), "smap: convert to text and back");
+    Map again(0, 0, againPath);
+    check(again.load() && again.getMap() == map.getMap(), "smap: text round trip");
+
+
+    // An empty board is rejected, not mapped
+    BinaryMapHeader header = {};
+    std::memcpy(header.magic, SMAP_MAGIC, 4);
+    header.version = SMAP_VERSION;
+    header.headerSize = sizeof(BinaryMapHeader);
+    std::ofstream(binaryPath, std::ios::binary).write(reinterpret_cast<const char*>(&header), sizeof(header));
+    {
+        BinaryMapView view;     // closed before the file is removed
+        check(!view.open(binaryPath), "smap: 0x0 map rejected");
+    }
+
+    std::remove(binaryPath.c_str());
+    std::remove(textPath.c_str());
+    std::remove(againPath.c_str());
+}
+
+// A recorded game replays to the same state hash at every tick, from memory and from its file,
+// with speed changes along the way; a changed hash is reported at its tick
+static void testReplayDeterminism() {
+    Map map = testMap(20, 30);
+    int64_t time = 0;
+    SnakeCore game(map, 21);
+    game.setTickSource([&time]() { return time; }, (double)FixedStepClock::TIME_FREQUENCY);
+    game.newGame(21);
+    ReplayRecording recording;
+    recording.begin(game);
+    GameRng keys(21);
+    int64_t step = FixedStepClock::TIME_FREQUENCY / 10;
+    for (int tick = 0; tick < 2000 && !game.isGameOver(); ++tick) {
+        // Towards the apple, with a random turn now and then
+        SnakePoint head = game.getSnake().front(), apple = game.getApple();
+        int key = apple.x != head.x ? (apple.x > head.x ? 'd' : 'a') : (apple.y > head.y ? 's' : 'w');
+        if (keys.next() % 8 == 0) key = "wasd"[keys.next() % 4];
+        recording.recordKey(key);
+        game.changeDirection(key);
+        if (tick % 50 == 49) step = FixedStepClock::TIME_FREQUENCY / (5 + keys.nextBelow(20));
+        time += step;
+        recording.beforeUpdate(game);
+        game.update();
+        recording.afterUpdate(game);
+    }
+
+    ReplayResult result = replayGame(recording, map);
+    check(result.passed() && result.ticks == (int64_t)recording.getTickCount() && result.score == game.getScore(),
+        "replay: from memory, first mismatch at tick " + std::to_string(result.firstMismatch));
+
+    const std::string fileName = "tests_replay.srec";
+    std::string data = recording.serialize();
+    std::ofstream(fileName, std::ios::binary).write(data.data(), data.size());
+    ReplayRecording loaded;
+    check(loaded.load(fileName) && replayGame(loaded, map).passed(), "replay: from file");
+
+    // Corrupt the hash of tick 10 (the hashes are the last tickCount * 4 bytes)
+    size_t hashAt = data.size() - recording.getTickCount() * sizeof(uint32_t) + 10 * sizeof(uint32_t);
+    data[hashAt] ^= 1;
+    std::ofstream(fileName, std::ios::binary).write(data.data(), data.size());
+    check(loaded.load(fileName) && replayGame(loaded, map).firstMismatch == 10, "replay: changed hash found at its tick");
+    std::remove(fileName.c_str());
+}
+
+// MapRegions against a flood fill on random maps: the same regions and sizes, the spawn in a
+// largest region (the center's when it is one of them) at the free cell nearest the center,
+// and only that region reachable
+static void testMapRegions() {
+    GameRng rng(31);
+    for (int round = 0; round < 40; ++round) {
+        int rows = 5 + (int)rng.nextBelow(30), cols = 5 + (int)rng.nextBelow(40);
+        int density = 10 + (int)rng.nextBelow(50);     // percent of obstacles
+        Map map(rows, cols, "");
+        std::vector<int> obstacles;
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if ((int)rng.nextBelow(100) < density) obstacles.push_back(cell);
+        }
+        map.setCells(obstacles, 1);
+        const std::vector<unsigned char>& grid = map.getMap();
+        MapRegions regions;
+        regions.analyze(map);
+
+        // Reference labels by flood fill
+        std::vector<int> label(rows * cols, -1), sizes;
+        for (int start = 0; start < rows * cols; ++start) {
+            if (grid[start] == 1 || label[start] >= 0) continue;
+            std::vector<int> stack(1, start);
+            label[start] = (int)sizes.size();
+            int size = 0;
+            while (!stack.empty()) {
+                int cell = stack.back();
+                stack.pop_back();
+                size++;
+                int x = cell % cols, y = cell / cols;
+                int next[] = { x > 0 ? cell - 1 : -1, x < cols - 1 ? cell + 1 : -1, y > 0 ? cell - cols : -1, y < rows - 1 ? cell + cols : -1 };
+                for (int n : next) {
+                    if (n < 0 || grid[n] == 1 || label[n] >= 0) continue;
+                    label[n] = label[start];
+                    stack.push_back(n);
+                }
+            }
+            sizes.push_back(size);
+        }
+
+        std::string at = "regions, round " + std::to_string(round);
+        check(regions.getRegionCount() == (int)sizes.size(), at + ": region count");
+        // Same partition: a one-to-one map between reference labels and regions
+        std::vector<int> toRegion(sizes.size(), -1);
+        bool same = true;
+        for (int cell = 0; cell < rows * cols && same; ++cell) {
+            int r = regions.regionAt(cell % cols, cell / cols);
+            if (label[cell] < 0) {
+                same = r == -1;
+                continue;
+            }
+            if (toRegion[label[cell]] < 0) toRegion[label[cell]] = r;
+            same = r >= 0 && toRegion[label[cell]] == r && regions.getRegionSize(r) == sizes[label[cell]];
+        }
+        check(same, at + ": cells labelled as by a flood fill");
+        if (failures > 0) return;
+        if (sizes.empty()) {
+            check(regions.getSpawnCell() == -1 && regions.getReachableCount() == 0, at + ": no spawn on a full board");
+            continue;
+        }
+
+        int largest = *std::max_element(sizes.begin(), sizes.end());
+        int spawn = regions.getSpawnCell(), center = (rows / 2) * cols + cols / 2;
+        check(spawn >= 0 && label[spawn] >= 0 && sizes[label[spawn]] == largest, at + ": spawn in a largest region");
+        if (label[center] >= 0 && sizes[label[center]] == largest) check(spawn == center, at + ": spawn at the center");
+        long long best = -1;
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (label[cell] != label[spawn]) continue;
+            long long dx = cell % cols - cols / 2, dy = cell / cols - rows / 2;
+            if (best < 0 || dx * dx + dy * dy < best) best = dx * dx + dy * dy;
+        }
+        long long sx = spawn % cols - cols / 2, sy = spawn / cols - rows / 2;
+        check(sx * sx + sy * sy == best, at + ": spawn nearest the center");
+        same = true;
+        for (int cell = 0; cell < rows * cols && same; ++cell) same = regions.isReachable(cell) == (label[cell] >= 0 && label[cell] == label[spawn]);
+        check(same && regions.getReachableCount() == largest, at + ": only the spawn region is reachable");
+        if (failures > 0) return;
+    }
+}
+
+// The same seed and parameters give the same map, also when maps are generated on several
+// threads at once; other seeds give other maps, and symmetric layouts stay symmetric
+static void testGeneratorDeterminism() {
+    std::vector<MapGenParams> variants(4);
+    variants[1].density = 0.25;
+    variants[1].symmetry = SYMMETRY_QUAD;
+    variants[2].rows = 31;
+    variants[2].cols = 41;
+    variants[2].roomCount = 5;
+    variants[3].symmetry = SYMMETRY_ROTATE;
+    const int SEEDS = 8;
+
+    for (size_t v = 0; v < variants.size(); ++v) {
+        const MapGenParams& params = variants[v];
+        std::string at = "generator, variant " + std::to_string(v);
+        std::vector<Map> first(SEEDS, Map(1, 1, "")), again(SEEDS, Map(1, 1, ""));
+        std::vector<char> made(SEEDS), remade(SEEDS);
+        for (int seed = 0; seed < SEEDS; ++seed) made[seed] = generateMap(params, 1000 + seed, first[seed]);
+        std::vector<std::thread> threads;
+        for (int seed = 0; seed < SEEDS; ++seed) {
+            threads.emplace_back([&, seed]() { remade[seed] = generateMap(params, 1000 + seed, again[seed]); });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        int distinct = 0;
+        for (int seed = 0; seed < SEEDS; ++seed) {
+            check(made[seed] && remade[seed], at + ": seed " + std::to_string(1000 + seed) + " generated");
+            if (!made[seed] || !remade[seed]) continue;
+            check(first[seed].getMap() == again[seed].getMap(), at + ": same seed, same map");
+            if (seed > 0 && first[seed].getMap() != first[seed - 1].getMap()) distinct++;
+        }
+        check(distinct > 0, at + ": other seeds give other maps");
+
+        if (params.symmetry == SYMMETRY_QUAD && made[0]) {
+            const std::vector<unsigned char>& cells = first[0].getMap();
+            int rows = params.rows, cols = params.cols;
+            bool mirrored = true;
+            for (int y = 0; y < rows; ++y) {
+                for (int x = 0; x < cols; ++x) {
+                    int cell = cells[(size_t)y * cols + x];
+                    mirrored = mirrored && cell == cells[(size_t)y * cols + (cols - 1 - x)] && cell == cells[(size_t)(rows - 1 - y) * cols + x];
+                }
+            }
+            check(mirrored, at + ": quad symmetry");
+        }
+    }
+}
+
+int main() {
+    testFreeCellIndex();
+    testBinaryMapRoundTrip();
+    testSingleSnakeMatchesSnakeCore();
+    testBatchMatchesSnakeCore();
+    testReplayDeterminism();
+    testMapRegions();
+    testGeneratorDeterminism();
+    testServerTicksDoNotAllocate();
+    testStreamOfSnakeLongerThanBoard();
+
+    if (failures > 0) {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "Tournament.h"
+#include "WorkStealingPool.h"
+#include "Autopilot.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+const char* deathCauseName(DeathCause cause) {
+    switch (cause) {
+    case NO_DEATH: return "alive";
+    case HIT_WALL: return "wall";
+    case HIT_SELF: return "self";
+    case HIT_OBSTACLE: return "obstacle";
+    case HIT_SNAKE: return "snake";
+    case BOARD_FULL: return "board full";
+    case TICK_LIMIT: return "tick limit";
+    }
+    return "?";
+}
+
+Tournament::Tournament(const std::vector<Map>& maps, const std::vector<SnakeBot>& bots, int64_t maxTicks)
+    : maps(maps), bots(bots), maxTicks(maxTicks) {}
+
+GameResult Tournament::playGame(size_t gameIndex, int mapIndex, int botIndex, uint64_t seed) const {
+    SnakeCore game(maps[mapIndex], seed);
+    game.resetGame();
+    const SnakeBot& bot = bots[botIndex];
+
+    while (!game.isGameOver() && game.getTickCount() < maxTicks) {
+        int key = bot(game);
+        if (key != -1) game.changeDirection(key);
+        game.update();
+    }
+
+    GameResult result;
+    result.gameIndex = gameIndex;
+    result.mapIndex = mapIndex;
+    result.botIndex = botIndex;
+    result.seed = seed;
+    result.score = game.getScore();
+    result.length = game.getSnake().size();
+    result.ticks = game.getTickCount();
+    result.cause = game.isGameOver() ? game.getDeathCause() : TICK_LIMIT;
+    return result;
+}
+
+TournamentSummary Tournament::run(int gamesPerPairing, uint64_t baseSeed, int threads) const {
+    size_t pairings = maps.size() * bots.size();
+    size_t gameCount = gamesPerPairing > 0 ? pairings * (size_t)gamesPerPairing : 0;
+
+    TournamentSummary summary;
+    summary.results.resize(gameCount);
+    summary.totalTicks = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads > 0 ? (size_t)threads : 0);
+        summary.threads = (int)pool.size();
+        pool.parallelFor(gameCount, [&](size_t i) {
+            size_t pairing = i / gamesPerPairing;
+            int mapIndex = (int)(pairing / bots.size());
+            int botIndex = (int)(pairing % bots.size());
+            uint64_t seed = baseSeed + (uint64_t)(i % gamesPerPairing);
+            summary.results[i] = playGame(i, mapIndex, botIndex, seed); // each task owns its slot
+        });
+    }
+    summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const GameResult& r : summary.results) {
+        summary.totalTicks += r.ticks;
+    }
+    return summary;
+}
+
+void TournamentSummary::print(std::ostream& out, const std::vector<std::string>& botNames) const {
+    out << "Games: " << results.size() << "  threads: " << threads
+        << "  wall: " << std::fixed << std::setprecision(2) << wallSeconds << " s"
+        << "  ticks/s: " << std::setprecision(0) << (wallSeconds > 0 ? totalTicks / wallSeconds : 0.0) << std::endl;
+
+    // Per map and bot: average score, length and ticks, plus how the games ended
+    struct Totals { size_t games = 0; double score = 0, length = 0, ticks = 0; size_t causes[TICK_LIMIT + 1] = {}; };
+    std::vector<std::vector<Totals>> totals;
+    for (const GameResult& r : results) {
+        if ((int)totals.size() <= r.mapIndex) totals.resize(r.mapIndex + 1);
+        if ((int)totals[r.mapIndex].size() <= r.botIndex) totals[r.mapIndex].resize(r.botIndex + 1);
+        Totals& t = totals[r.mapIndex][r.botIndex];
+        t.games++;
+        t.score += (double)r.score;
+        t.length += (double)r.length;
+        t.ticks += (double)r.ticks;
+        t.causes[r.cause]++;
+    }
+
+    for (size_t m = 0; m < totals.size(); ++m) {
+        for (size_t b = 0; b < totals[m].size(); ++b) {
+            const Totals& t = totals[m][b];
+            if (t.games == 0) continue;
+            std::string name = b < botNames.size() ? botNames[b] : "bot " + std::to_string(b);
+            out << "map " << m << "  " << name << ": " << t.games << " games"
+                << std::setprecision(1)
+                << "  avg score " << t.score / t.games
+                << "  avg length " << t.length / t.games
+                << "  avg ticks " << t.ticks / t.games << "  ends:";
+            for (int c = HIT_WALL; c <= TICK_LIMIT; ++c) {
+                if (t.causes[c] > 0) out << " " << deathCauseName((DeathCause)c) << "=" << t.causes[c];
+            }
+            out << std::endl;
+        }
+    }
+}
+
+int Tournament::greedyBot(const SnakeCore& game) {
+    static const int keys[4] = { 'w', 's', 'a', 'd' };   // UP, DOWN, LEFT, RIGHT
+    static const int dx[4] = { 0, 0, -1, 1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    static const Direction opposite[4] = { DOWN, UP, RIGHT, LEFT };
+
+    SnakePoint head = game.getSnake().front();
+    SnakePoint apple = game.getApple();
+    int best = -1;
+    int bestDistance = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (opposite[d] == game.getDirection()) continue; // changeDirection would ignore it
+        int x = head.x + dx[d];
+        int y = head.y + dy[d];
+        if (x < 0 || y < 0 || x >= game.map.getCols() || y >= game.map.getRows()) continue;
+        if (game.map.isObstacle(x, y) || game.isSnakeAt(x, y)) continue;
+        int distance = std::abs(x - apple.x) + std::abs(y - apple.y);
+        if (best == -1 || distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+        }
+    }
+    return best == -1 ? -1 : keys[best];
+}
+
+int Tournament::autopilotBot(const SnakeCore& game) {
+    // One planner per worker thread; its cached path and retry tick belong to the game it last
+    // played, so every game starts it afresh and the results do not depend on the scheduling
+    thread_local Autopilot pilot;
+    if (game.getTickCount() == 0) pilot.reset();
+    return pilot.plan(game);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Map.h"
+#include "SnakeCore.h"
+
+// A bot looks at the game and returns a key for changeDirection ('w', 'a', 's', 'd') or -1.
+// Bots are called from several threads at once and must not keep shared mutable state.
+typedef std::function<int(const SnakeCore&)> SnakeBot;
+
+struct GameResult {
+    size_t gameIndex;
+    int mapIndex;
+    int botIndex;
+    uint64_t seed;
+    size_t score;
+    size_t length;
+    int64_t ticks;
+    DeathCause cause;
+};
+
+struct TournamentSummary {
+    std::vector<GameResult> results;    // in game order, independent of scheduling
+    double wallSeconds;
+    int threads;
+    int64_t totalTicks;
+
+    void print(std::ostream& out, const std::vector<std::string>& botNames) const;
+};
+
+// Plays every (map, bot, seed) combination as an independent headless game,
+// spread over all cores with a work-stealing scheduler
+class Tournament
+{
+private:
+    std::vector<Map> maps;
+    std::vector<SnakeBot> bots;
+    int64_t maxTicks;
+
+    GameResult playGame(size_t gameIndex, int mapIndex, int botIndex, uint64_t seed) const;
+
+public:
+    Tournament(const std::vector<Map>& maps, const std::vector<SnakeBot>& bots, int64_t maxTicks = 100000);
+
+    // gamesPerPairing games for every map and bot, seeds baseSeed, baseSeed + 1, ... (none if it is below 1); threads 0 = one per core
+    TournamentSummary run(int gamesPerPairing, uint64_t baseSeed, int threads = 0) const;
+
+    // Heads for the apple, avoiding any move that collides right away
+    static int greedyBot(const SnakeCore& game);
+
+    // The game's Autopilot, one planner per worker thread
+    static int autopilotBot(const SnakeCore& game);
+};
+
+const char* deathCauseName(DeathCause cause);
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+
+// Lock-free hand-over of the newest value from one writer thread to one reader thread.
+// The writer fills writeSlot() and publishes it; the reader takes the newest
+// published slot and reads it at leisure. Each side owns one of the three slots
+// and the third is swapped atomically between them, so neither ever waits or
+// touches the slot the other holds. Values the reader was too slow for are skipped.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const int SLOT_MASK = 3;
+    static const int FRESH = 4;     // the middle slot was published and not taken yet
+
+    T slots[3];
+    std::atomic<int> middle;
+    int back;       // the writer's slot
+    int front;      // the reader's slot
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    // Writer side
+    T& writeSlot() { return slots[back]; }
+    void publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & SLOT_MASK; }
+
+    // Either side: is there a published value the reader has not taken
+    bool isFresh() const { return (middle.load(std::memory_order_acquire) & FRESH) != 0; }
+
+    // Reader side: false (and readSlot() unchanged) when nothing new was published
+    bool take() {
+        if (!isFresh()) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & SLOT_MASK;
+        return true;
+    }
+    const T& readSlot() const { return slots[front]; }
+
+    // Any slot, for setting up while neither side is running
+    T& slotAt(int i) { return slots[i]; }
+};
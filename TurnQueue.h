@@ -0,0 +1,48 @@
+#pragma once
+#include <cctype>
+#include "SnakeCore.h"
+
+#define TURN_QUEUE_SIZE 3
+
+// Direction keys pressed between ticks, turned into at most one turn per tick in the order
+// they were pressed. Up then left within one tick is two turns on two ticks, not a left turn
+// that sends the snake back into its own neck; a key that would reverse (or repeat) the
+// direction in effect when its tick comes is dropped. Keys beyond a full queue are dropped.
+class TurnQueue
+{
+private:
+    Direction turns[TURN_QUEUE_SIZE];
+    int count;
+
+    static Direction opposite(Direction dir) { return (Direction)(dir ^ 1); } // UP/DOWN, LEFT/RIGHT
+
+public:
+    TurnQueue() : count(0) {}
+
+    // 'w', 'a', 's', 'd' in either case; other keys are ignored
+    void push(int key) {
+        Direction turn;
+        switch (tolower(key)) {
+        case 'w': turn = UP; break;
+        case 's': turn = DOWN; break;
+        case 'a': turn = LEFT; break;
+        case 'd': turn = RIGHT; break;
+        default: return;
+        }
+        if (count < TURN_QUEUE_SIZE) turns[count++] = turn;
+    }
+
+    // Key for the turn to make before the next tick, given the direction of the last tick; -1 = none
+    int next(Direction current) {
+        while (count > 0) {
+            Direction turn = turns[0];
+            for (int i = 1; i < count; ++i) turns[i - 1] = turns[i];
+            count--;
+            if (turn != current && turn != opposite(current)) return "wsad"[turn];
+        }
+        return -1;
+    }
+
+    void clear() { count = 0; }
+    bool empty() const { return count == 0; }
+};
@@ -0,0 +1,124 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads, each with its own block of tasks.
+// A worker takes tasks from the start of its own block and, when that is empty,
+// steals from the end of another worker's block, so uneven tasks (long and
+// short games) still keep every core busy. A parallelFor allocates nothing: the
+// blocks are index ranges and the job is called through a pointer to the caller's.
+class WorkStealingPool {
+private:
+    struct Worker {
+        std::mutex lock;
+        size_t next;            // tasks [next, end) are not taken yet
+        size_t end;
+        Worker() : next(0), end(0) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    void (*job)(void*, size_t);     // job of the current parallelFor, called with jobContext
+    void* jobContext;
+    std::atomic<size_t> remaining;
+    std::mutex stateLock;
+    std::condition_variable wakeUp;
+    std::condition_variable done;
+    size_t generation;
+    bool stopping;
+
+    bool popLocal(size_t self, size_t& task) {
+        Worker& w = *workers[self];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if (w.next == w.end) return false;
+        task = w.next++;
+        return true;
+    }
+
+    bool steal(size_t self, size_t& task) {
+        for (size_t k = 1; k < workers.size(); ++k) {
+            Worker& victim = *workers[(self + k) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (victim.next != victim.end) {
+                task = --victim.end;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        size_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(stateLock);
+                wakeUp.wait(guard, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+            }
+            size_t task;
+            while (popLocal(self, task) || steal(self, task)) {
+                job(jobContext, task);
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> guard(stateLock);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t threadCount = 0) : job(nullptr), jobContext(nullptr), remaining(0), generation(0), stopping(false) {
+        if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(new Worker());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Run fn(i) for every i in [0, count) on the pool and wait for all of them
+    template <typename Fn>
+    void parallelFor(size_t count, Fn&& fn) {
+        if (count == 0) return;
+        typedef typename std::remove_reference<Fn>::type Job;
+        job = [](void* context, size_t i) { (*static_cast<Job*>(context))(i); };
+        jobContext = (void*)&fn;
+        remaining = count;
+        // Deal contiguous blocks so neighbouring tasks start on the same worker
+        size_t perWorker = (count + workers.size() - 1) / workers.size();
+        for (size_t k = 0; k < workers.size(); ++k) {
+            Worker& w = *workers[k];
+            std::lock_guard<std::mutex> guard(w.lock);
+            w.next = std::min(k * perWorker, count);
+            w.end = std::min(w.next + perWorker, count);
+        }
+        std::unique_lock<std::mutex> guard(stateLock);
+        generation++;
+        wakeUp.notify_all();
+        done.wait(guard, [&] { return remaining.load() == 0; });
+    }
+};
@@ -2,12 +2,28 @@
 #include <iostream>
 #include <ctime>
 #include <deque>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include "Snake.h"
 #include "Menu.h"
 #include "Glob.h"
 #include "MapEditor.h"
+#include "Tournament.h"
+#include "MapGenerator.h"
+#include "GameLoop.h"
+#include "Replay.h"
+#include "StateStream.h"
+#include "Profiler.h"
+#include "GamePipeline.h"
+#include "FrameCapture.h"
+#include "MultiSnakeCore.h"
+#include "TurnQueue.h"
+#include "GameServer.h"
+#include "LoopbackClients.h"
+#include "SnakeRenderer.h"
 
 
 // Globals to track the window size
@@ -19,34 +35,33 @@ int buttonPressed;
 // Mouse callback wrapper for MapEditor
 void mouseCallback(int event, int x, int y, int flags, void* userdata) {
     auto editor = reinterpret_cast<MapEditor*>(userdata);
-    editor->handleMouse(event, x, y);
+    editor->handleMouse(event, x, y, flags);
 }
 
 int map_editor_routine() {
-    const int rows = MAP_HEIGHT;       // Map rows
-    const int cols = MAP_WIDTH;       // Map columns
-    const std::string mapFile = "map.txt";
-
     // Initialize Map
-    Map mapHandler(rows, cols, mapFile);
+    Map mapHandler(mapHeight, mapWidth, mapFileName);
 
     // Load the map (or create a new one if not found)
     mapHandler.load();
+    const int rows = mapHandler.getRows();       // Map rows
+    const int cols = mapHandler.getCols();       // Map columns
 
     // Initialize MapEditor
     MapEditor editor(mapHandler, CELL_SIZE);
 
-    // Canvas for displaying the map
-    cv::Mat canvas(rows * CELL_SIZE, cols * CELL_SIZE, CV_8UC3);
+    // Canvas for displaying the map: the editor zooms and pans, so it never needs more than a screen
+    cv::Mat canvas(std::min(rows, MAX_VIEW_ROWS) * CELL_SIZE + MAP_EDITOR_STATUS_HEIGHT, std::min(cols, MAX_VIEW_COLS) * CELL_SIZE, CV_8UC3);
 
     // Create window and set mouse callback
     cv::namedWindow("Snake Game Map Editor");
     cv::setMouseCallback("Snake Game Map Editor", mouseCallback, &editor);
 
     while (true) {
-        // Render the map using the MapEditor
-        editor.render(canvas);
-        cv::imshow("Snake Game Map Editor", canvas);
+        // Render the map using the MapEditor: applies the edits made since the last frame, repaints only what changed
+        if (editor.render(canvas)) {
+            cv::imshow("Snake Game Map Editor", canvas);
+        }
 
         char key = cv::waitKey(10);
         if (key == 's') {
@@ -55,6 +70,9 @@ int map_editor_routine() {
         else if (key == 27) { // ESC to exit
             break;
         }
+        else {
+            editor.handleKey(key);
+        }
     }
     // Unset the mouse callback
     cv::setMouseCallback("Snake Game Map Editor", nullptr);
@@ -66,7 +84,266 @@ int map_editor_routine() {
 
 
 
-int main() {
+// Shows the frame, with the profiler overlay on a copy when it is on (the renderers keep drawing into `frame`)
+void showFrame(const cv::Mat& frame, cv::Mat& overlayFrame, FrameProfiler& profiler, int64_t& overlayShownAt) {
+    ProfileScope scope(profiler, PHASE_SHOW);
+    if (!profiler.isOverlayVisible()) {
+        imshow("Snake Game", frame);
+        return;
+    }
+    frame.copyTo(overlayFrame);
+    profiler.drawOverlay(overlayFrame);
+    imshow("Snake Game", overlayFrame);
+    overlayShownAt = profiler.now();
+}
+
+
+// Whole argument as a decimal int; false for anything else ("", "12x", out of range)
+static bool parseInt(const char* text, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = (int)parsed;
+    return true;
+}
+
+
+// Headless tournament: snake_game [--corpus dir] --tournament [games per map] [threads]
+int tournament_routine(int gamesPerMap, int threads, const std::string& corpusDirectory) {
+    std::vector<Map> maps;
+    if (!corpusDirectory.empty()) {
+        maps = loadMapCorpus(corpusDirectory);
+        if (maps.empty()) return 1;
+    }
+    else {
+        Map map(mapHeight, mapWidth, mapFileName);
+        map.load();
+        maps.push_back(map);
+    }
+
+    std::vector<SnakeBot> bots = { Tournament::greedyBot, Tournament::autopilotBot };
+    std::vector<std::string> botNames = { "greedy", "autopilot" };
+    Tournament tournament(maps, bots);
+    TournamentSummary summary = tournament.run(gamesPerMap, (uint64_t)time(0), threads);
+    summary.print(std::cout, botNames);
+    return 0;
+}
+
+
+// Shared board: snake_game --multi snakes [players]. Player 1 steers with WASD, player 2 with IJKL,
+// the other snakes are bots. ESC quits.
+int multi_routine(int snakeCount, int players) {
+    Map map(mapHeight, mapWidth, mapFileName);
+    map.load();
+    snakeCount = std::max(1, std::min(snakeCount, MAX_SNAKES));
+    players = std::max(0, std::min(players, std::min(snakeCount, 2)));  // two keyboards' worth of keys
+    MultiSnakeCore game(map, snakeCount, (uint64_t)time(0));
+
+    FixedStepClock loopClock(SPEED_NORMAL);
+    game.setTickSource([&loopClock]() { return loopClock.getSimTime(); }, (double)FixedStepClock::TIME_FREQUENCY);
+
+    SnakeRenderer renderer(CELL_SIZE);
+    cv::Mat frame(std::min(map.getRows(), MAX_VIEW_ROWS) * CELL_SIZE, std::min(map.getCols(), MAX_VIEW_COLS) * CELL_SIZE, CV_8UC3);
+    cv::namedWindow("Snake Game", cv::WINDOW_NORMAL);
+
+    // Keys of the human snakes, one turn per tick each; player 2's i/j/k/l are queued as w/a/s/d
+    TurnQueue turns[2];
+    loopClock.start();
+    bool redraw = true;
+    while (true) {
+        int key = cv::waitKey(std::max(1, loopClock.msUntilNextTick()));
+        if (key == 27) break;
+        if (key != -1 && players > 0) turns[0].push(key);
+        if (key != -1 && players > 1) {
+            const char* second = strchr("ijkl", tolower(key));
+            if (second) turns[1].push("wasd"[second - "ijkl"]);
+        }
+
+        for (int ticks = loopClock.advance(); ticks > 0 && !game.isGameOver(); --ticks) {
+            for (int i = 0; i < players; ++i) {
+                int turn = turns[i].next(game.getPlayer(i).dir);
+                if (turn != -1) game.changeDirection(i, turn);
+            }
+            for (int i = players; i < snakeCount; ++i) {
+                int move = greedyMultiBot(game, i);
+                if (move != -1) game.changeDirection(i, move);
+            }
+            game.update();
+            loopClock.tick();
+            redraw = true;
+        }
+        if (!redraw) continue;
+        redraw = false;
+
+        renderer.render(game, frame);
+        for (int i = 0; i < snakeCount; ++i) {
+            const SnakePlayer& player = game.getPlayer(i);
+            std::string label = (i < players ? "P" : "Bot") + std::to_string(i + 1) + ": " + std::to_string(player.score) + " x" + std::to_string(player.hearts);
+            putText(frame, label, cv::Point(10 + (i % 4) * 150, 25 + (i / 4) * 25), cv::FONT_HERSHEY_SIMPLEX, 0.6, SnakeRenderer::snakeColor(i), 2);
+        }
+        if (game.isGameOver()) {
+            putText(frame, game.isBoardFull() ? "Board Full!" : "Game Over", cv::Point(frame.cols / 3, frame.rows / 2), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(0, 0, 255), 2);
+            putText(frame, "Winner: " + std::to_string(game.getLeader() + 1), cv::Point(frame.cols / 3, frame.rows / 2 + 40), cv::FONT_HERSHEY_SIMPLEX, 0.8, SnakeRenderer::snakeColor(game.getLeader()), 2);
+            cv::imshow("Snake Game", frame);
+            cv::waitKey(0);
+            break;
+        }
+        cv::imshow("Snake Game", frame);
+    }
+    cv::destroyWindow("Snake Game");
+    return 0;
+}
+
+
+// Match server: snake_game --serve endpoint [matches] [seats] [snakes], until Enter is pressed.
+// With --serve-test, loopback clients take every seat for `seconds` instead.
+int server_routine(const ServerConfig& config, int testSeconds) {
+    Map map(mapHeight, mapWidth, mapFileName);
+    map.load();
+    if (testSeconds > 0) {
+        int clients = config.matches * config.playersPerMatch;
+        return runServerLoadTest(map, config, clients, testSeconds, std::cout) ? 0 : 1;
+    }
+
+    GameServer server(map, config);
+    server.setReport(&std::cout, 5);
+    if (!server.start()) return 1;
+    std::cout << "Serving " << config.matches << " matches on " << config.endpoint << ", press Enter to stop" << std::endl;
+    std::cin.get();
+    server.stop();
+    return 0;
+}
+
+
+int main(int argc, char** argv) {
+    // Board options: --board WxH, --map file, --profile, --capture file, --corpus dir (before any mode option)
+    bool profileExport = false;
+    std::string captureTarget;
+    std::string corpusDirectory;
+    while (argc > 1) {
+        std::string option = argv[1];
+        if (option == "--profile") {
+            profileExport = true;
+            argc -= 1;
+            argv += 1;
+            continue;
+        }
+        if (option == "--board") {
+            std::string size = argc > 2 ? argv[2] : "";
+            size_t times = size.find('x');
+            int width = 0, height = 0;
+            if (times == std::string::npos || !parseInt(size.substr(0, times).c_str(), width) || !parseInt(size.substr(times + 1).c_str(), height)
+                || !isValidBoardSize(height, width)) {
+                std::cerr << "Usage: snake_game --board WxH (each side 1 to " << MAX_BOARD_SIDE << " cells)" << std::endl;
+                return 1;
+            }
+            mapWidth = width;
+            mapHeight = height;
+        }
+        else if (argc < 3) break;
+        else if (option == "--map") mapFileName = argv[2];
+        else if (option == "--capture") captureTarget = argv[2];
+        else if (option == "--corpus") corpusDirectory = argv[2];
+        else break;
+        argc -= 2;
+        argv += 2;
+    }
+
+    // Map converter: snake_game --convert-map map.txt map.smap (or the other way round)
+    if (argc > 3 && std::string(argv[1]) == "--convert-map") {
+        std::string from = argv[2], to = argv[3];
+        bool converted = isBinaryMapFile(from) ? convertBinaryMapToText(from, to) : convertTextMapToBinary(from, to);
+        return converted ? 0 : 1;
+    }
+    // Replay check: snake_game --replay last_game.srec [more.srec ...]
+    if (argc > 2 && std::string(argv[1]) == "--replay") {
+        std::vector<std::string> files(argv + 2, argv + argc);
+        return replayFiles(files, 0, std::cout) == 0 ? 0 : 1;
+    }
+    // State stream check: snake_game --check-stream last_game.srec [more.srec ...]
+    if (argc > 2 && std::string(argv[1]) == "--check-stream") {
+        int failed = 0;
+        for (int i = 2; i < argc; ++i) {
+            if (!checkStateStream(argv[i], std::cout)) failed++;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+    // Headless capture: snake_game --render-replay last_game.srec clip.y4m (or .avi, .png, .bgr)
+    if (argc > 3 && std::string(argv[1]) == "--render-replay") {
+        return renderReplayToFile(argv[2], argv[3], std::cout) ? 0 : 1;
+    }
+    // Map corpus: snake_game --generate-maps dir count [seed] [size=WxH density=0.1 corridor=2 rooms=0 symmetry=none]
+    if (argc > 3 && std::string(argv[1]) == "--generate-maps") {
+        MapGenParams params;
+        params.cols = mapWidth;
+        params.rows = mapHeight;
+        uint64_t seed = (uint64_t)time(0);
+        int count = 0;
+        if (!parseInt(argv[3], count) || count < 1) {
+            std::cerr << "Usage: snake_game --generate-maps dir count [seed] [options] (count at least 1)" << std::endl;
+            return 1;
+        }
+        for (int i = 4; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i == 4 && arg.find('=') == std::string::npos) {
+                char* end = nullptr;
+                errno = 0;
+                seed = strtoull(argv[i], &end, 10);
+                if (end == argv[i] || *end != '\0' || errno == ERANGE || arg[0] == '-') {
+                    std::cerr << "Seed must be a non-negative integer: " << arg << std::endl;
+                    return 1;
+                }
+            }
+            else if (!parseMapGenParam(arg, params)) {
+                std::cerr << "Unknown generator option " << arg << std::endl;
+                return 1;
+            }
+        }
+        return generateMapCorpus(argv[2], count, seed, params, 0, std::cout) > 0 ? 0 : 1;
+    }
+    if (argc > 1 && (std::string(argv[1]) == "--serve" || std::string(argv[1]) == "--serve-test")) {
+        // --serve endpoint [matches] [seats] [snakes]; --serve-test [matches] [seats] [seconds] [endpoint]
+        bool test = std::string(argv[1]) == "--serve-test";
+        ServerConfig config;
+        config.seed = (uint64_t)time(0);
+        int next = 2;
+        int testSeconds = 10;
+        bool valid = true;
+        if (!test && argc > next) config.endpoint = argv[next++];
+        if (argc > next) valid = valid && parseInt(argv[next++], config.matches) && config.matches >= 1;
+        if (argc > next) valid = valid && parseInt(argv[next++], config.playersPerMatch) && config.playersPerMatch >= (test ? 1 : 0) && config.playersPerMatch <= MAX_SNAKES;
+        if (!test && argc > next) valid = valid && parseInt(argv[next++], config.snakesPerMatch) && config.snakesPerMatch >= 1 && config.snakesPerMatch <= MAX_SNAKES;
+        if (test && argc > next) valid = valid && parseInt(argv[next++], testSeconds) && testSeconds >= 1;
+        if (test && argc > next) config.endpoint = argv[next++];
+        if (!valid) {
+            std::cerr << "Usage: snake_game --serve endpoint [matches, at least 1] [seats, 0 to " << MAX_SNAKES << "] [snakes, 1 to " << MAX_SNAKES << "]" << std::endl;
+            std::cerr << "       snake_game --serve-test [matches, at least 1] [seats, 1 to " << MAX_SNAKES << "] [seconds, at least 1] [endpoint]" << std::endl;
+            return 1;
+        }
+        config.snakesPerMatch = std::max(config.snakesPerMatch, config.playersPerMatch);
+        return server_routine(config, test ? testSeconds : 0);
+    }
+    if (argc > 2 && std::string(argv[1]) == "--multi") {
+        int snakes = 0;
+        int players = 1;
+        if (!parseInt(argv[2], snakes) || snakes < 1 || snakes > MAX_SNAKES
+            || (argc > 3 && (!parseInt(argv[3], players) || players < 0 || players > std::min(snakes, 2)))) {
+            std::cerr << "Usage: snake_game --multi snakes [players] (snakes 1 to " << MAX_SNAKES << ", players 0 to 2 and at most the snakes)" << std::endl;
+            return 1;
+        }
+        return multi_routine(snakes, players);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--tournament") {
+        int games = 1000;
+        int threads = 0;    // one per core
+        if ((argc > 2 && (!parseInt(argv[2], games) || games < 1)) || (argc > 3 && (!parseInt(argv[3], threads) || threads < 0))) {
+            std::cerr << "Usage: snake_game [--corpus dir] --tournament [games per map, at least 1] [threads, 0 = one per core]" << std::endl;
+            return 1;
+        }
+        return tournament_routine(games, threads, corpusDirectory);
+    }
+
     SnakeGame game;
     windowWidth = game.getWindowWidth();
     windowHeight = game.getWindowHeigth();
@@ -75,81 +352,179 @@ int main() {
 
     GameStates currentState = MENU;
     int selectedOption = 0;
-    int snakeSpeed = 100;
+    int ticksPerSecond = SPEED_NORMAL;
     bool soundEnable = true;
 
+    // The simulation advances in fixed ticks; waitKey only polls input and paces the loop
+    FixedStepClock loopClock(ticksPerSecond);
+    game.setTickSource([&loopClock]() { return loopClock.getSimTime(); }, (double)FixedStepClock::TIME_FREQUENCY);
+
     int64_t gameOverTimeStamp = 0;
+    const int MENU_POLL_MS = 100;
+    const int FRAME_POLL_MS = 5;   // while playing: how late a finished frame can be shown
+
+    // Per-phase timings; 'o' shows them on screen, --profile also keeps a trace and exports both at exit
+    // (and prints the tick jitter of every game)
+    FrameProfiler profiler;
+    profiler.setTracing(profileExport);
+    cv::Mat overlayFrame;
+    int64_t overlayShownAt = 0;
+    const int64_t OVERLAY_REFRESH_NS = 250000000;
+
+    // 'r' records the game to a capture file (--capture: from the start); frames are dropped, not waited for.
+    // The video has a frame slot per tick at the speed of the moment; frames are placed by simulation time.
+    FrameCapture capture;
+    const std::string CAPTURE_EXTENSION = ".avi";
+
+    // While playing, ticks and rendering run on their own threads; this loop only shows frames
+    GamePipeline pipeline(game, loopClock, ticksPerSecond, profiler);
+    if (!captureTarget.empty() && capture.open(captureTarget, frame.size(), ticksPerSecond)) {
+        pipeline.setCapture(&capture);
+    }
+    cv::Mat shown = frame;  // what the window shows: `frame` (menus) or a frame of the pipeline
 
     while (currentState != EXIT) 
     {
-        int key = cv::waitKey(snakeSpeed);
+        ProfileScope frameScope(profiler, PHASE_FRAME);
 
+        // Input phase
+        bool simulating = currentState == PLAYING && !game.isGamePaused();
+        int key;
+        {
+            ProfileScope scope(profiler, PHASE_INPUT);
+            key = cv::waitKey(simulating ? FRAME_POLL_MS : MENU_POLL_MS);
+        }
+
+        // Static screens are not shown again, so the overlay is refreshed on its own timer
+        bool refreshOverlay = profiler.isOverlayVisible() && profiler.now() - overlayShownAt >= OVERLAY_REFRESH_NS;
+        if (key == 'o') {
+            profiler.toggleOverlay();
+            refreshOverlay = true;
+            key = -1;
+        }
+
+        if (key == 'r' && currentState == PLAYING) {
+            pipeline.stop(); // Picks up the capture when it starts again
+            if (capture.isOpen()) {
+                capture.close();
+                capture.printStats(std::cout);
+                pipeline.setCapture(nullptr);
+            }
+            else if (capture.open(captureFileName(CAPTURE_EXTENSION), frame.size(), ticksPerSecond)) {
+                std::cout << "Capturing to " << capture.getTarget() << std::endl;
+                pipeline.setCapture(&capture);
+            }
+            key = -1;
+        }
         if (key == 27 && currentState == PLAYING) { // SPACE for pause
+            pipeline.stop(); // Time spent paused is not simulated
             game.togglePause();
         }
 
+        bool frameChanged = false; // Static screens are not shown again, so idle menus cost almost nothing
+        bool pipelineFrame = false;
+
         if (game.isGamePaused()) {
-            frame = cv::Scalar(0, 0, 0);
-            putText(frame, "Pause", cv::Point(windowWidth / 3 + 20, windowHeight / 2), cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(255, 255, 255), 2);
-            putText(frame, "Press ESC to Resume", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 50), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
-            //putText(frame, "Press 1 to Buy a Life (5 points)", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 150), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
-            //putText(frame, "Press 2 to Buy a Super Power (15 points)", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 100), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
-            putText(frame, "Press 1 to enter map editor", cv::Point(windowWidth / 3 - 110, windowHeight / 2 + 150), cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 1.5);
+            {
+                ProfileScope scope(profiler, PHASE_MENU);
+                frameChanged = showPauseScreen(frame);
+            }
 
             //if (key == '1') {  // Check for key '1'
             //    game.buyLife();  // Call buyLife() function
             //}
             //if (key == '2') {  // Check for key '2'
-            //    game.buySuperPower(snakeSpeed);  // Call buySuperPower() function
+            //    game.buySuperPower(ticksPerSecond);  // Call buySuperPower() function
             //}
             if (key == '1') // map editor
             {
                 map_editor_routine();
                 game.resetGame();
+                invalidateScreen();
             }
 
-            imshow("Snake Game", frame); 
+            if (frameChanged) shown = frame;
+            if (frameChanged || refreshOverlay) showFrame(shown, overlayFrame, profiler, overlayShownAt);
             continue;
         }
 
         switch (currentState)
         {
-        case MENU:
-            showMenu(frame, selectedOption);
+        case MENU: {
+            ProfileScope scope(profiler, PHASE_MENU);
+            frameChanged = showMenu(frame, selectedOption);
             handleMenuInput(key, selectedOption, currentState, game);
             break;
+        }
 
-        case PLAYING:
-            if (key != -1) game.changeDirection(key);
-            game.update(snakeSpeed);
-            game.render(frame);
+        case PLAYING: {
+            // New game or resumed: the pipeline takes over the game until it ends or is paused
+            if (!pipeline.isRunning()) pipeline.start(frame.size());
+            if (key != -1) pipeline.pressKey(key);
 
-            if (game.isGameOver()) {
+            bool gameOver = pipeline.isGameOver();
+            if (gameOver) pipeline.stop(); // The renderer finishes the last state first
+
+            // Show phase: the newest finished frame, if there is one
+            if (pipeline.takeFrame()) {
+                shown = pipeline.getFrame();
+                invalidateScreen();
+                frameChanged = true;
+                pipelineFrame = true;
+            }
+
+            if (gameOver) {
                 currentState = GAME_OVER;
                 gameOverTimeStamp = cv::getTickCount();
                 selectedOption = 0;
+                if (profileExport) loopClock.printJitter(std::cout); // tick timing is a profiling report
+                loopClock.resetJitter();
+                if (game.isAutopilot()) {
+                    game.getAutopilot().printStats(std::cout);
+                    game.getAutopilot().resetStats();
+                }
             }
             break;
+        }
 
-        case OPTIONS:
-            showOptionsMenu(frame, selectedOption, snakeSpeed, soundEnable, windowWidth, windowHeight);
-            handleOptionsMenuInput(key, selectedOption, currentState, snakeSpeed, soundEnable, windowWidth, windowHeight, game, frame);
+        case OPTIONS: {
+            ProfileScope scope(profiler, PHASE_MENU);
+            frameChanged = showOptionsMenu(frame, selectedOption, ticksPerSecond, soundEnable, windowWidth, windowHeight);
+            handleOptionsMenuInput(key, selectedOption, currentState, ticksPerSecond, soundEnable, windowWidth, windowHeight, game, frame);
             break;
+        }
 
         case EXIT:
             break;
         
         case GAME_OVER:
-            game.render(frame);
             if ((cv::getTickCount() - gameOverTimeStamp) / cv::getTickFrequency() >= 3) {
-                showGameOverMenu(frame, selectedOption);
+                ProfileScope scope(profiler, PHASE_MENU);
+                frameChanged = showGameOverMenu(frame, selectedOption);
                 handleGameOverMenuInput(key, selectedOption, currentState, game);
             }
+            // The game over board does not change; it was shown by the last PLAYING frame
             break;
         
         }
 
-        imshow("Snake Game", frame);
+        if (frameChanged && !pipelineFrame) shown = frame;
+        if (frameChanged || refreshOverlay) showFrame(shown, overlayFrame, profiler, overlayShownAt);
+    }
+    pipeline.stop();
+    if (capture.isOpen()) {
+        capture.close();
+        capture.printStats(std::cout);
+    }
+
+    if (profileExport) {
+        profiler.printSummary(std::cout);
+        if (profiler.exportCsv(PROFILE_CSV_FILE) && profiler.exportChromeTrace(PROFILE_TRACE_FILE)) {
+            std::cout << "Profile written to " << PROFILE_CSV_FILE << " and " << PROFILE_TRACE_FILE << std::endl;
+        }
+        else {
+            std::cerr << "Could not write the profile" << std::endl;
+        }
     }
 
     return 0;